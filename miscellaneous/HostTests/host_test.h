@@ -0,0 +1,30 @@
+/*******************************************************************************
+  @file     host_test.h
+  @brief    Checks shared by the host tests of the firmware modules
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int hostTestFailures;
+
+// Records a failed check, with its location, and goes on with the test
+#define CHECK(cond, ...)                                                      \
+  do {                                                                        \
+    if (!(cond))                                                              \
+    {                                                                         \
+      hostTestFailures++;                                                     \
+      printf("  %s:%d: check failed: %s: ", __FILE__, __LINE__, #cond);      \
+      printf(__VA_ARGS__);                                                    \
+      printf("\n");                                                           \
+    }                                                                         \
+  } while (0)
+
+// Exit code of the test, reported by run_tests.sh
+#define HOST_TEST_RESULT()    (hostTestFailures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Builds and runs the host tests of the firmware modules. Each test_*.c includes
+# the source file under test, or links the ones listed after @sources in its
+# header, and is built against the host subset of CMSIS-DSP and the simulated
+# interrupt mask in stub/. Each sim_*.py is a model of a change checked against
+# its numbers.
+#
+# test_dsp_suite writes its JSON report to $DSP_REPORT, by default in the
+# build directory.
+#
+# Usage: ./run_tests.sh [name...]      e.g. ./run_tests.sh test_equaliser
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+FIRMWARE="$HERE/../../workspace/mp3_player_eq"
+OUT="${TMPDIR:-/tmp}/mp3_player_host_tests"
+CC="${CC:-cc}"
+CFLAGS="-std=gnu11 -O2 -Wall -Wno-unused-function -Wno-discarded-qualifiers -I$HERE -I$HERE/stub -I$FIRMWARE -I$FIRMWARE/source -I$FIRMWARE/startup"
+
+export DSP_REPORT="${DSP_REPORT:-$OUT/dsp_report.json}"
+
+mkdir -p "$OUT"
+failed=0
+
+WANTED="$*"
+
+selected() {
+  [ -z "$WANTED" ] && return 0
+  case " $WANTED " in
+    *" $1 "*) return 0 ;;
+  esac
+  return 1
+}
+
+for source in "$HERE"/test_*.c; do
+  name=$(basename "$source" .c)
+  selected "$name" || continue
+  sources=$(sed -n 's|^ *@sources *||p' "$source" | sed "s|[^ ][^ ]*|$FIRMWARE/&|g")
+  if ! $CC $CFLAGS "$source" $sources "$HERE/stub/arm_math.c" "$HERE/stub/hardware.c" -o "$OUT/$name" -lm -lpthread; then
+    echo "FAIL $name (build)"
+    failed=1
+  elif "$OUT/$name"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    failed=1
+  fi
+done
+
+for source in "$HERE"/sim_*.py; do
+  [ -e "$source" ] || continue
+  name=$(basename "$source" .py)
+  selected "$name" || continue
+  if python3 "$source"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    failed=1
+  fi
+done
+
+exit $failed
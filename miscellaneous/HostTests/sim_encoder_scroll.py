@@ -0,0 +1,175 @@
+"""
+Model of scrolling a 1000 entry directory with the left encoder while audio plays.
+
+Compares an event per detent, which the input ring used to hold, with the
+rotation coalesced into one event carrying the steps and the velocity, which
+the file system multiplies by the scroll gain. Reading the directory costs
+the FatFs window per entry plus a sector every few entries, and moving back
+rewinds the directory and reads it again up to the entry. The frame events
+are dispatched first, and each buffer must be refilled before the other one
+finishes playing. The ring size, the velocity estimate and the scroll gains
+are read from the firmware.
+
+Checks that the velocity estimate reads the rate of a steady rotation from
+its second detent, and that the coalesced rotation never drops a detent,
+reaches the end sooner than the detents from the fast scroll velocity on,
+reaches the top
+within the simulated time and misses fewer refills than the detents. Long
+backward jumps still miss some refills, since every step back reads the
+directory again.
+
+    python sim_encoder_scroll.py
+"""
+
+import os
+import random
+import re
+import sys
+
+FIRMWARE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'workspace', 'mp3_player_eq')
+DEFINE_RE = re.compile(r'^#define\s+(\w+)\s+\(?(\d+)\)?', re.M)
+
+SAMPLE_RATE = 44100
+REFILL_MS = (18.0, 30.0)        # Decoding, equalising and converting a frame
+READDIR_MS = 0.12               # Each f_readdir() from the FatFs window
+SECTOR_MS = 0.6                 # Each sector read, holding a few long name entries
+ENTRIES_PER_SECTOR = 5
+LCD_MS = 0.05                   # Formatting the entry shown
+DIRECTORY_SIZE = 1000
+TIMEOUT_MS = 120000.0
+
+
+def read_defines(*paths):
+    defines = {}
+    for path in paths:
+        with open(os.path.join(FIRMWARE, path), 'r') as f:
+            defines.update((name, int(value)) for name, value in DEFINE_RE.findall(f.read()))
+    return defines
+
+
+def readdir_ms(entries):
+    return entries * READDIR_MS + entries / ENTRIES_PER_SECTOR * SECTOR_MS
+
+
+def estimate(velocity, interval, sizes):
+    # Velocity of the encoder after a detent, as keypadRotate() updates it
+    if interval >= sizes['KEYPAD_VELOCITY_IDLE_MS']:
+        return 0.0
+    if velocity == 0.0:
+        return 1000.0 / interval
+    smoothing = sizes['KEYPAD_VELOCITY_SMOOTHING']
+    return (velocity * (smoothing - 1) + 1000.0 / interval) / smoothing
+
+
+def gain(velocity, sizes):
+    if velocity >= sizes['UI_SCROLL_FASTER_VELOCITY']:
+        return sizes['UI_SCROLL_FASTER_GAIN']
+    if velocity >= sizes['UI_SCROLL_FAST_VELOCITY']:
+        return sizes['UI_SCROLL_FAST_GAIN']
+    return 1
+
+
+def run(coalesced, rate, direction, sizes, seed=3):
+    # Returns the time to reach the last entry, or None, the detents, the dropped ones and the missed refills
+    rnd = random.Random(seed)
+    period = sizes['DAC_DMA_PPBUFFER_SIZE'] / SAMPLE_RATE * 1e3
+    index = 0 if direction > 0 else DIRECTORY_SIZE - 1
+    target = DIRECTORY_SIZE - 1 if direction > 0 else 0
+    now = next_detent = next_frame = 0.0
+    ring, frames = [], []
+    delta, pending = 0, False
+    velocity, last_detent = 0.0, -1e9
+    detents = dropped = underruns = 0
+
+    while now < TIMEOUT_MS:
+        # Interrupts raised while the last event was handled
+        while next_detent <= now:
+            detents += 1
+            velocity = estimate(velocity, next_detent - last_detent, sizes)
+            last_detent = next_detent
+            if coalesced:
+                delta += direction
+                if not pending:
+                    pending = True
+                    ring.append(None)
+            elif len(ring) < sizes['EVENTS_INPUT_RING_SIZE']:
+                ring.append(direction)
+            else:
+                dropped += 1
+            next_detent += 1000.0 / rate
+        while next_frame <= now:
+            frames.append(next_frame)
+            next_frame += period
+
+        # The frame events first
+        if frames:
+            raised = frames.pop(0)
+            now += rnd.uniform(*REFILL_MS)
+            underruns += now > raised + period
+            continue
+
+        if not ring:
+            now = min(next_detent, next_frame)
+            continue
+
+        ring.pop(0)
+        steps = 1
+        if coalesced:
+            pending = False
+            steps, delta = abs(delta) * gain(velocity, sizes), 0
+        if direction > 0:
+            moved = min(steps, DIRECTORY_SIZE - 1 - index)
+            now += readdir_ms(max(moved, 1))
+            index += moved
+        else:
+            index = max(index - steps, 0)
+            now += readdir_ms(index + 1)
+        now += LCD_MS
+        if index == target:
+            return now, detents, dropped, underruns
+
+    return None, detents, dropped, underruns
+
+
+def main():
+    sizes = read_defines('drivers/MCAL/dac_dma/dac_dma.h', 'source/events/events.c', 'source/ui/ui.c',
+                         'drivers/HAL/keypad/keypad.h')
+    failed = False
+
+    # The first detent after a pause has no interval, the next ones measure the rate
+    for rate in (10, 25, 40):
+        velocity, readings = 0.0, []
+        for interval in [sizes['KEYPAD_VELOCITY_IDLE_MS']] + [1000.0 / rate] * 3:
+            velocity = estimate(velocity, interval, sizes)
+            readings.append(velocity)
+        print(f"  {rate:2d} detents/s estimated as " + ", ".join(f"{reading:4.1f}" for reading in readings))
+        if any(abs(reading - rate) > rate * 0.01 for reading in readings[1:]):
+            print(f"  the velocity estimate does not read {rate} detents per second from the second detent")
+            failed = True
+
+    for direction, name in ((1, 'down'), (-1, 'up')):
+        for rate in (10, 20, 40):
+            results = {}
+            for coalesced in (False, True):
+                results[coalesced] = run(coalesced, rate, direction, sizes)
+                elapsed, detents, dropped, underruns = results[coalesced]
+                shown = f"{elapsed / 1000:6.2f} s" if elapsed else f"  >{TIMEOUT_MS / 1000:.0f} s"
+                print(f"  {name:4s} {rate:2d} detents/s {'coalesced' if coalesced else 'detent':9s}: {shown}, "
+                      f"{detents:4d} detents, {dropped:4d} dropped, {underruns:4d} refills missed")
+
+            detent, rotation = results[False], results[True]
+            if rotation[0] is None or rotation[2]:
+                print(f"  the coalesced rotation did not scroll {name} at {rate} detents per second")
+                failed = True
+            elif rate >= sizes['UI_SCROLL_FAST_VELOCITY'] and detent[0] is not None and rotation[0] >= detent[0]:
+                print(f"  the coalesced rotation is not faster scrolling {name} at {rate} detents per second")
+                failed = True
+            elif rotation[3] > detent[3]:
+                print(f"  the coalesced rotation misses more refills scrolling {name} at {rate} detents per second")
+                failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
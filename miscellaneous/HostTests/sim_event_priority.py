@@ -0,0 +1,122 @@
+"""
+Model of the main loop dispatching the events, with bursts of encoder rotation.
+
+Compares the single FIFO shared by every event, which the events module used
+before the priority classes, with the rings of each class, where the audio
+ring is always drained first. Each DAC buffer must be refilled before the
+other one finishes playing. Checks that the classes never miss a refill and
+never drop a frame event, even at 1000 detents per second, while the FIFO
+does. The sizes of the buffers and of the rings are read from the firmware.
+
+    python sim_event_priority.py
+"""
+
+import os
+import random
+import re
+import sys
+
+FIRMWARE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'workspace', 'mp3_player_eq')
+DEFINE_RE = re.compile(r'^#define\s+(\w+)\s+\(?(\d+)\)?', re.M)
+
+SAMPLE_RATE = 44100
+REFILL_MS = (18.0, 30.0)        # Decoding, equalising and converting a frame
+UI_MS = (1.5, 6.0)              # Handling an input event
+BURST_MS = 300                  # Encoder spinning, then idle for IDLE_MS
+IDLE_MS = 200
+DURATION_MS = 60000.0
+
+
+def read_defines(*paths):
+    defines = {}
+    for path in paths:
+        with open(os.path.join(FIRMWARE, path), 'r') as f:
+            defines.update((name, int(value)) for name, value in DEFINE_RE.findall(f.read()))
+    return defines
+
+
+def interrupts(rnd, period, encoder_hz):
+    # Frame events every buffer played, and bursts of detents, by time
+    raised = []
+    frame = 0
+    while frame * period < DURATION_MS:
+        raised.append((frame * period, 'frame'))
+        frame += 1
+    when = 0.0
+    while when < DURATION_MS:
+        burst_end = when + BURST_MS
+        while when < burst_end:
+            raised.append((when, 'input'))
+            when += rnd.expovariate(encoder_hz / 1000.0)
+        when += IDLE_MS
+    raised.sort()
+    return raised
+
+
+def run(classes, encoder_hz, sizes, seed=1):
+    rnd = random.Random(seed)
+    period = sizes['DAC_DMA_PPBUFFER_SIZE'] / SAMPLE_RATE * 1e3
+    raised = interrupts(rnd, period, encoder_hz)
+
+    # The FIFO keeps every event, the classes keep the frames and the input apart
+    capacity = {'frame': sizes['EVENTS_AUDIO_RING_SIZE'], 'input': sizes['EVENTS_INPUT_RING_SIZE']}
+    queues = {'frame': [], 'input': []} if classes else {'all': []}
+    dropped = {'frame': 0, 'input': 0}
+    underruns = 0
+    worst = 0.0
+    now = 0.0
+    i = 0
+
+    while i < len(raised) or any(queues.values()):
+        # Interrupts raised while the last event was handled
+        while i < len(raised) and raised[i][0] <= now:
+            when, kind = raised[i]
+            i += 1
+            queue = queues[kind] if classes else queues['all']
+            if len(queue) < (capacity[kind] if classes else sizes['QUEUE_STANDARD_MAX_SIZE']):
+                queue.append((when, kind))
+            else:
+                dropped[kind] += 1
+                underruns += kind == 'frame'
+
+        # The next event, the frames first when they have their own ring
+        queue = next((q for q in queues.values() if q), None)
+        if queue is None:
+            if i < len(raised):
+                now = raised[i][0]
+                continue
+            break
+        when, kind = queue.pop(0)
+        if kind == 'frame':
+            # The other buffer plays while this one is refilled
+            now += rnd.uniform(*REFILL_MS)
+            worst = max(worst, now - when)
+            underruns += now > when + period
+        else:
+            now += rnd.uniform(*UI_MS)
+
+    return underruns, dropped, worst, period
+
+
+def main():
+    sizes = read_defines('drivers/MCAL/dac_dma/dac_dma.h', 'source/events/events.c', 'lib/queue/queue.h')
+    failed = False
+
+    for encoder_hz in (100, 400, 1000):
+        for classes in (False, True):
+            underruns, dropped, worst, period = run(classes, encoder_hz, sizes)
+            print(f"  {'classes' if classes else 'fifo':7s} encoder {encoder_hz:4d}/s: {underruns:4d} underruns, "
+                  f"dropped {dropped['frame']:3d} frame and {dropped['input']:5d} input events, "
+                  f"worst refill {worst:5.1f} ms of {period:.1f} ms")
+            if classes and (underruns or dropped['frame'] or worst > period):
+                print(f"  the classes missed a refill at {encoder_hz} detents per second")
+                failed = True
+            if not classes and encoder_hz >= 400 and not underruns:
+                print(f"  the FIFO never missed a refill at {encoder_hz} detents per second, the model does not load it")
+                failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,23 @@
+/*******************************************************************************
+  @file     arm_const_structs.h
+  @brief    Host subset of CMSIS-DSP, the complex FFT instances of each length.
+            The reference FFT of arm_math.c only needs their length.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef STUB_ARM_CONST_STRUCTS_H_
+#define STUB_ARM_CONST_STRUCTS_H_
+
+#include "arm_math.h"
+
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len16;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len32;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len64;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len128;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len256;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len512;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len1024;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len2048;
+extern const arm_cfft_instance_f32 arm_cfft_sR_f32_len4096;
+
+#endif /* STUB_ARM_CONST_STRUCTS_H_ */
@@ -0,0 +1,442 @@
+/*******************************************************************************
+  @file     arm_math.c
+  @brief    Plain C reference implementations of the host subset of CMSIS-DSP.
+            They follow the documented behaviour of the CMSIS-DSP functions,
+            not their speed: coefficients in time reversed order, Q15 results
+            truncated and saturated as on the Cortex-M4.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "arm_math.h"
+#include "arm_const_structs.h"
+
+#include <stdlib.h>
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static void fft(const double* re, const double* im, double* outRe, double* outIm, uint32_t length, bool inverse);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len16 = { 16 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len32 = { 32 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len64 = { 64 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len128 = { 128 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len256 = { 256 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len512 = { 512 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len1024 = { 1024 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len2048 = { 2048 };
+const arm_cfft_instance_f32 arm_cfft_sR_f32_len4096 = { 4096 };
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void arm_fir_init_f32(arm_fir_instance_f32* S, uint16_t numTaps, const float32_t* pCoeffs, float32_t* pState, uint32_t blockSize)
+{
+  S->numTaps = numTaps;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  memset(pState, 0, (numTaps + blockSize - 1) * sizeof(float32_t));
+}
+
+arm_status arm_fir_init_q15(arm_fir_instance_q15* S, uint16_t numTaps, const q15_t* pCoeffs, q15_t* pState, uint32_t blockSize)
+{
+  if ((numTaps < 4) || (numTaps % 2))
+  {
+    return ARM_MATH_ARGUMENT_ERROR;
+  }
+  S->numTaps = numTaps;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+
+  // Unlike the other filters, the M3/M4 build clears numTaps + blockSize entries
+  memset(pState, 0, (numTaps + blockSize) * sizeof(q15_t));
+  return ARM_MATH_SUCCESS;
+}
+
+void arm_fir_f32(const arm_fir_instance_f32* S, const float32_t* pSrc, float32_t* pDst, uint32_t blockSize)
+{
+  uint32_t taps = S->numTaps;
+
+  // The state keeps the last taps - 1 inputs ahead of the block
+  memcpy(S->pState + taps - 1, pSrc, blockSize * sizeof(float32_t));
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    float32_t acc = 0.0f;
+    for (uint32_t k = 0; k < taps; k++)
+    {
+      acc += S->pState[n + k] * S->pCoeffs[k];
+    }
+    pDst[n] = acc;
+  }
+  memmove(S->pState, S->pState + blockSize, (taps - 1) * sizeof(float32_t));
+}
+
+void arm_fir_fast_q15(const arm_fir_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  uint32_t taps = S->numTaps;
+
+  memcpy(S->pState + taps - 1, pSrc, blockSize * sizeof(q15_t));
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    // The fast version accumulates in 32 bits, wrapping instead of saturating
+    uint32_t acc = 0;
+    for (uint32_t k = 0; k < taps; k++)
+    {
+      acc += (uint32_t)((q31_t)S->pState[n + k] * S->pCoeffs[k]);
+    }
+    pDst[n] = (q15_t)__SSAT((q31_t)acc >> 15, 16);
+  }
+  memmove(S->pState, S->pState + blockSize, (taps - 1) * sizeof(q15_t));
+}
+
+void arm_shift_q15(const q15_t* pSrc, int8_t shiftBits, q15_t* pDst, uint32_t blockSize)
+{
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    pDst[n] = (shiftBits >= 0) ? (q15_t)__SSAT((q31_t)pSrc[n] << shiftBits, 16)
+                               : (q15_t)(pSrc[n] >> -shiftBits);
+  }
+}
+
+arm_status arm_fir_decimate_init_q15(arm_fir_decimate_instance_q15* S, uint16_t numTaps, uint8_t M, const q15_t* pCoeffs, q15_t* pState, uint32_t blockSize)
+{
+  if (blockSize % M)
+  {
+    return ARM_MATH_LENGTH_ERROR;
+  }
+  S->M = M;
+  S->numTaps = numTaps;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  memset(pState, 0, (numTaps + blockSize - 1) * sizeof(q15_t));
+  return ARM_MATH_SUCCESS;
+}
+
+void arm_fir_decimate_fast_q15(const arm_fir_decimate_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  uint32_t taps = S->numTaps;
+
+  // Each output is aligned with the first of the M inputs it consumes
+  memcpy(S->pState + taps - 1, pSrc, blockSize * sizeof(q15_t));
+  for (uint32_t n = 0; n < blockSize / S->M; n++)
+  {
+    uint32_t acc = 0;
+    for (uint32_t k = 0; k < taps; k++)
+    {
+      acc += (uint32_t)((q31_t)S->pState[n * S->M + k] * S->pCoeffs[k]);
+    }
+    pDst[n] = (q15_t)__SSAT((q31_t)acc >> 15, 16);
+  }
+  memmove(S->pState, S->pState + blockSize, (taps - 1) * sizeof(q15_t));
+}
+
+void arm_biquad_cascade_df1_init_q15(arm_biquad_casd_df1_inst_q15* S, uint8_t numStages, const q15_t* pCoeffs, q15_t* pState, int8_t postShift)
+{
+  S->numStages = numStages;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  S->postShift = postShift;
+  memset(pState, 0, 4 * numStages * sizeof(q15_t));
+}
+
+void arm_biquad_cascade_df1_q15(const arm_biquad_casd_df1_inst_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  const q15_t* in = pSrc;
+
+  // Coefficients {b0, 0, b1, b2, a1, a2} and state {x[n-1], x[n-2], y[n-1], y[n-2]} per stage
+  for (int32_t stage = 0; stage < S->numStages; stage++)
+  {
+    const q15_t* b = S->pCoeffs + 6 * stage;
+    q15_t* state = S->pState + 4 * stage;
+    for (uint32_t n = 0; n < blockSize; n++)
+    {
+      q15_t x = in[n];
+      q63_t acc = (q63_t)b[0] * x + (q63_t)b[2] * state[0] + (q63_t)b[3] * state[1]
+                + (q63_t)b[4] * state[2] + (q63_t)b[5] * state[3];
+      q15_t y = (q15_t)__SSAT((q31_t)(acc >> (15 - S->postShift)), 16);
+      state[1] = state[0];
+      state[0] = x;
+      state[3] = state[2];
+      state[2] = y;
+      pDst[n] = y;
+    }
+    in = pDst;
+  }
+}
+
+void arm_biquad_cascade_df2T_init_f32(arm_biquad_cascade_df2T_instance_f32* S, uint8_t numStages, const float32_t* pCoeffs, float32_t* pState)
+{
+  S->numStages = numStages;
+  S->pCoeffs = pCoeffs;
+  S->pState = pState;
+  memset(pState, 0, 2 * numStages * sizeof(float32_t));
+}
+
+void arm_biquad_cascade_df2T_f32(const arm_biquad_cascade_df2T_instance_f32* S, const float32_t* pSrc, float32_t* pDst, uint32_t blockSize)
+{
+  const float32_t* in = pSrc;
+
+  // Coefficients {b0, b1, b2, a1, a2} and state {d1, d2} per stage, the feedback ones negated
+  for (uint32_t stage = 0; stage < S->numStages; stage++)
+  {
+    const float32_t* b = S->pCoeffs + 5 * stage;
+    float32_t* state = S->pState + 2 * stage;
+    for (uint32_t n = 0; n < blockSize; n++)
+    {
+      float32_t x = in[n];
+      float32_t y = b[0] * x + state[0];
+      state[0] = b[1] * x + b[3] * y + state[1];
+      state[1] = b[2] * x + b[4] * y;
+      pDst[n] = y;
+    }
+    in = pDst;
+  }
+}
+
+void arm_cfft_f32(const arm_cfft_instance_f32* S, float32_t* p1, uint8_t ifftFlag, uint8_t bitReverseFlag)
+{
+  uint32_t length = S->fftLen;
+  uint32_t bits = 31 - __CLZ(length);
+  double* buffer = calloc(4 * length, sizeof(double));
+  double* re = buffer;
+  double* im = buffer + length;
+
+  for (uint32_t k = 0; k < length; k++)
+  {
+    re[k] = p1[2 * k];
+    im[k] = p1[2 * k + 1];
+  }
+  fft(re, im, re + 2 * length, im + 2 * length, length, ifftFlag);
+
+  // Without the bit reversal the output is left in bit reversed order
+  for (uint32_t k = 0; k < length; k++)
+  {
+    uint32_t index = k;
+    if (!bitReverseFlag)
+    {
+      index = 0;
+      for (uint32_t bit = 0; bit < bits; bit++)
+      {
+        index |= ((k >> bit) & 1) << (bits - 1 - bit);
+      }
+    }
+    p1[2 * index] = (float32_t)(ifftFlag ? re[2 * length + k] / length : re[2 * length + k]);
+    p1[2 * index + 1] = (float32_t)(ifftFlag ? im[2 * length + k] / length : im[2 * length + k]);
+  }
+  free(buffer);
+}
+
+arm_status arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32* S, uint16_t fftLen)
+{
+  if ((fftLen < 32) || (fftLen > 4096) || (fftLen & (fftLen - 1)))
+  {
+    return ARM_MATH_ARGUMENT_ERROR;
+  }
+  S->fftLenRFFT = fftLen;
+  S->Sint.fftLen = fftLen / 2;
+  return ARM_MATH_SUCCESS;
+}
+
+void arm_rfft_fast_f32(const arm_rfft_fast_instance_f32* S, float32_t* p, float32_t* pOut, uint8_t ifftFlag)
+{
+  uint32_t length = S->fftLenRFFT;
+  double* buffer = calloc(4 * length, sizeof(double));
+  double* re = buffer;
+  double* im = buffer + length;
+
+  // The spectrum is packed as {X[0], X[N/2]} followed by the complex bins 1 to N/2 - 1
+  if (!ifftFlag)
+  {
+    for (uint32_t n = 0; n < length; n++)
+    {
+      re[n] = p[n];
+    }
+    fft(re, im, re + 2 * length, im + 2 * length, length, false);
+    pOut[0] = (float32_t)re[2 * length];
+    pOut[1] = (float32_t)re[2 * length + length / 2];
+    for (uint32_t k = 1; k < length / 2; k++)
+    {
+      pOut[2 * k] = (float32_t)re[2 * length + k];
+      pOut[2 * k + 1] = (float32_t)im[2 * length + k];
+    }
+  }
+  else
+  {
+    re[0] = p[0];
+    re[length / 2] = p[1];
+    for (uint32_t k = 1; k < length / 2; k++)
+    {
+      re[k] = re[length - k] = p[2 * k];
+      im[k] = p[2 * k + 1];
+      im[length - k] = -p[2 * k + 1];
+    }
+    fft(re, im, re + 2 * length, im + 2 * length, length, true);
+    for (uint32_t n = 0; n < length; n++)
+    {
+      pOut[n] = (float32_t)(re[2 * length + n] / length);
+    }
+  }
+  free(buffer);
+}
+
+arm_status arm_rfft_init_q15(arm_rfft_instance_q15* S, uint32_t fftLenReal, uint32_t ifftFlagR, uint32_t bitReverseFlag)
+{
+  if ((fftLenReal < 32) || (fftLenReal > 8192) || (fftLenReal & (fftLenReal - 1)))
+  {
+    return ARM_MATH_ARGUMENT_ERROR;
+  }
+  S->fftLenReal = fftLenReal;
+  S->ifftFlagR = ifftFlagR;
+  S->bitReverseFlagR = bitReverseFlag;
+  return ARM_MATH_SUCCESS;
+}
+
+void arm_rfft_q15(const arm_rfft_instance_q15* S, q15_t* pSrc, q15_t* pDst)
+{
+  uint32_t length = S->fftLenReal;
+  uint32_t upscale = 30 - __CLZ(length);          // log2(N) - 1, the output format of N = 512 is 9.7
+  double* buffer = calloc(4 * length, sizeof(double));
+  double* re = buffer;
+  double* im = buffer + length;
+
+  // Forward transform only, the whole conjugate symmetric spectrum is written
+  for (uint32_t n = 0; n < length; n++)
+  {
+    re[n] = pSrc[n];
+  }
+  fft(re, im, re + 2 * length, im + 2 * length, length, false);
+  for (uint32_t k = 0; k < length; k++)
+  {
+    pDst[2 * k] = (q15_t)__SSAT((q31_t)floor(re[2 * length + k] / (1 << upscale)), 16);
+    pDst[2 * k + 1] = (q15_t)__SSAT((q31_t)floor(im[2 * length + k] / (1 << upscale)), 16);
+  }
+  free(buffer);
+}
+
+void arm_cmplx_mag_f32(const float32_t* pSrc, float32_t* pDst, uint32_t numSamples)
+{
+  for (uint32_t n = 0; n < numSamples; n++)
+  {
+    pDst[n] = sqrtf(pSrc[2 * n] * pSrc[2 * n] + pSrc[2 * n + 1] * pSrc[2 * n + 1]);
+  }
+}
+
+void arm_float_to_q15(const float32_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    pDst[n] = (q15_t)__SSAT((q31_t)(pSrc[n] * 32768.0f), 16);
+  }
+}
+
+void arm_q15_to_float(const q15_t* pSrc, float32_t* pDst, uint32_t blockSize)
+{
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    pDst[n] = pSrc[n] / 32768.0f;
+  }
+}
+
+void arm_mult_q15(const q15_t* pSrcA, const q15_t* pSrcB, q15_t* pDst, uint32_t blockSize)
+{
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    pDst[n] = (q15_t)__SSAT(((q31_t)pSrcA[n] * pSrcB[n]) >> 15, 16);
+  }
+}
+
+void arm_power_q15(const q15_t* pSrc, uint32_t blockSize, q63_t* pResult)
+{
+  q63_t sum = 0;
+
+  // 34.30 result, no saturation
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    sum += (q31_t)pSrc[n] * pSrc[n];
+  }
+  *pResult = sum;
+}
+
+void arm_power_f32(const float32_t* pSrc, uint32_t blockSize, float32_t* pResult)
+{
+  float32_t sum = 0.0f;
+
+  for (uint32_t n = 0; n < blockSize; n++)
+  {
+    sum += pSrc[n] * pSrc[n];
+  }
+  *pResult = sum;
+}
+
+arm_status arm_sqrt_q31(q31_t in, q31_t* pOut)
+{
+  if (in <= 0)
+  {
+    *pOut = 0;
+    return in < 0 ? ARM_MATH_ARGUMENT_ERROR : ARM_MATH_SUCCESS;
+  }
+  *pOut = (q31_t)(sqrt(in / 2147483648.0) * 2147483648.0);
+  return ARM_MATH_SUCCESS;
+}
+
+float32_t arm_cos_f32(float32_t x)
+{
+  return cosf(x);
+}
+
+float32_t arm_sin_f32(float32_t x)
+{
+  return sinf(x);
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void fft(const double* re, const double* im, double* outRe, double* outIm, uint32_t length, bool inverse)
+{
+  double sign = inverse ? 1.0 : -1.0;
+  uint32_t bits = 31 - __CLZ(length);
+
+  // Iterative radix-2 FFT, the lengths used are all powers of two
+  for (uint32_t k = 0; k < length; k++)
+  {
+    uint32_t reversed = 0;
+    for (uint32_t bit = 0; bit < bits; bit++)
+    {
+      reversed |= ((k >> bit) & 1) << (bits - 1 - bit);
+    }
+    outRe[reversed] = re[k];
+    outIm[reversed] = im[k];
+  }
+
+  for (uint32_t span = 1; span < length; span <<= 1)
+  {
+    for (uint32_t j = 0; j < span; j++)
+    {
+      double wRe = cos(sign * M_PI * j / span);
+      double wIm = sin(sign * M_PI * j / span);
+      for (uint32_t k = j; k < length; k += 2 * span)
+      {
+        double tRe = outRe[k + span] * wRe - outIm[k + span] * wIm;
+        double tIm = outRe[k + span] * wIm + outIm[k + span] * wRe;
+        outRe[k + span] = outRe[k] - tRe;
+        outIm[k + span] = outIm[k] - tIm;
+        outRe[k] += tRe;
+        outIm[k] += tIm;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
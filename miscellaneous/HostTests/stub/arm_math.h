@@ -0,0 +1,142 @@
+/*******************************************************************************
+  @file     arm_math.h
+  @brief    Host subset of CMSIS-DSP, for the host tests of the firmware modules.
+            Same types and prototypes as CMSIS-DSP, with plain C reference
+            implementations in arm_math.c. Only what the tested modules use.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef STUB_ARM_MATH_H_
+#define STUB_ARM_MATH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef float     float32_t;
+typedef double    float64_t;
+typedef int8_t    q7_t;
+typedef int16_t   q15_t;
+typedef int32_t   q31_t;
+typedef int64_t   q63_t;
+
+typedef enum {
+  ARM_MATH_SUCCESS = 0,
+  ARM_MATH_ARGUMENT_ERROR = -1,
+  ARM_MATH_LENGTH_ERROR = -2
+} arm_status;
+
+typedef struct {
+  uint16_t          numTaps;
+  float32_t*        pState;
+  const float32_t*  pCoeffs;
+} arm_fir_instance_f32;
+
+typedef struct {
+  uint16_t          numTaps;
+  q15_t*            pState;
+  const q15_t*      pCoeffs;
+} arm_fir_instance_q15;
+
+typedef struct {
+  uint8_t           M;
+  uint16_t          numTaps;
+  const q15_t*      pCoeffs;
+  q15_t*            pState;
+} arm_fir_decimate_instance_q15;
+
+typedef struct {
+  int8_t            numStages;
+  q15_t*            pState;
+  const q15_t*      pCoeffs;
+  int8_t            postShift;
+} arm_biquad_casd_df1_inst_q15;
+
+typedef struct {
+  uint8_t           numStages;
+  float32_t*        pState;
+  const float32_t*  pCoeffs;
+} arm_biquad_cascade_df2T_instance_f32;
+
+typedef struct {
+  uint16_t          fftLen;
+  const float32_t*  pTwiddle;
+  const uint16_t*   pBitRevTable;
+  uint16_t          bitRevLength;
+} arm_cfft_instance_f32;
+
+typedef struct {
+  arm_cfft_instance_f32   Sint;
+  uint16_t                fftLenRFFT;
+  const float32_t*        pTwiddleRFFT;
+} arm_rfft_fast_instance_f32;
+
+typedef struct {
+  uint32_t          fftLenReal;
+  uint8_t           ifftFlagR;
+  uint8_t           bitReverseFlagR;
+} arm_rfft_instance_q15;
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define PI    3.14159265358979f
+
+static inline int32_t __SSAT(int32_t value, uint32_t bits)
+{
+  int32_t max = (1 << (bits - 1)) - 1;
+  return value > max ? max : (value < -max - 1 ? -max - 1 : value);
+}
+
+static inline uint32_t __CLZ(uint32_t value)
+{
+  return value ? (uint32_t)__builtin_clz(value) : 32;
+}
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+void arm_fir_init_f32(arm_fir_instance_f32* S, uint16_t numTaps, const float32_t* pCoeffs, float32_t* pState, uint32_t blockSize);
+arm_status arm_fir_init_q15(arm_fir_instance_q15* S, uint16_t numTaps, const q15_t* pCoeffs, q15_t* pState, uint32_t blockSize);
+void arm_fir_f32(const arm_fir_instance_f32* S, const float32_t* pSrc, float32_t* pDst, uint32_t blockSize);
+void arm_fir_fast_q15(const arm_fir_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize);
+void arm_shift_q15(const q15_t* pSrc, int8_t shiftBits, q15_t* pDst, uint32_t blockSize);
+
+arm_status arm_fir_decimate_init_q15(arm_fir_decimate_instance_q15* S, uint16_t numTaps, uint8_t M, const q15_t* pCoeffs, q15_t* pState, uint32_t blockSize);
+void arm_fir_decimate_fast_q15(const arm_fir_decimate_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize);
+
+void arm_biquad_cascade_df1_init_q15(arm_biquad_casd_df1_inst_q15* S, uint8_t numStages, const q15_t* pCoeffs, q15_t* pState, int8_t postShift);
+void arm_biquad_cascade_df1_q15(const arm_biquad_casd_df1_inst_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize);
+void arm_biquad_cascade_df2T_init_f32(arm_biquad_cascade_df2T_instance_f32* S, uint8_t numStages, const float32_t* pCoeffs, float32_t* pState);
+void arm_biquad_cascade_df2T_f32(const arm_biquad_cascade_df2T_instance_f32* S, const float32_t* pSrc, float32_t* pDst, uint32_t blockSize);
+
+void arm_cfft_f32(const arm_cfft_instance_f32* S, float32_t* p1, uint8_t ifftFlag, uint8_t bitReverseFlag);
+arm_status arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32* S, uint16_t fftLen);
+void arm_rfft_fast_f32(const arm_rfft_fast_instance_f32* S, float32_t* p, float32_t* pOut, uint8_t ifftFlag);
+arm_status arm_rfft_init_q15(arm_rfft_instance_q15* S, uint32_t fftLenReal, uint32_t ifftFlagR, uint32_t bitReverseFlag);
+void arm_rfft_q15(const arm_rfft_instance_q15* S, q15_t* pSrc, q15_t* pDst);
+void arm_cmplx_mag_f32(const float32_t* pSrc, float32_t* pDst, uint32_t numSamples);
+
+void arm_float_to_q15(const float32_t* pSrc, q15_t* pDst, uint32_t blockSize);
+void arm_q15_to_float(const q15_t* pSrc, float32_t* pDst, uint32_t blockSize);
+void arm_mult_q15(const q15_t* pSrcA, const q15_t* pSrcB, q15_t* pDst, uint32_t blockSize);
+void arm_power_q15(const q15_t* pSrc, uint32_t blockSize, q63_t* pResult);
+void arm_power_f32(const float32_t* pSrc, uint32_t blockSize, float32_t* pResult);
+arm_status arm_sqrt_q31(q31_t in, q31_t* pOut);
+float32_t arm_cos_f32(float32_t x);
+float32_t arm_sin_f32(float32_t x);
+
+static inline arm_status arm_sqrt_f32(float32_t in, float32_t* pOut)
+{
+  *pOut = in >= 0.0f ? sqrtf(in) : 0.0f;
+  return in >= 0.0f ? ARM_MATH_SUCCESS : ARM_MATH_ARGUMENT_ERROR;
+}
+
+#endif /* STUB_ARM_MATH_H_ */
@@ -0,0 +1,77 @@
+/*******************************************************************************
+  @file     hardware.c
+  @brief    Host stand-in of the core interrupt mask and exclusive access,
+            see hardware.h
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "hardware.h"
+
+uint32_t hostPrimask;
+void     (*hostPendingIrq)(void);
+void     (*hostExclusiveIrq)(void);
+
+static bool exclusive;
+
+uint32_t __get_PRIMASK(void)
+{
+  return hostPrimask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+  hostPrimask = primask;
+
+  // A pending interrupt is taken as soon as it is unmasked, once
+  if (!primask && hostPendingIrq)
+  {
+    void (*irq)(void) = hostPendingIrq;
+    hostPendingIrq = NULL;
+    irq();
+  }
+}
+
+void __disable_irq(void)
+{
+  hostPrimask = 1;
+}
+
+void __enable_irq(void)
+{
+  __set_PRIMASK(0);
+}
+
+uint32_t __LDREXW(volatile uint32_t* address)
+{
+  exclusive = true;
+  return *address;
+}
+
+uint32_t __STREXW(uint32_t value, volatile uint32_t* address)
+{
+  // The return from an interrupt clears the exclusive monitor
+  if (hostExclusiveIrq)
+  {
+    void (*irq)(void) = hostExclusiveIrq;
+    hostExclusiveIrq = NULL;
+    irq();
+    exclusive = false;
+  }
+
+  if (!exclusive)
+  {
+    return 1;
+  }
+  exclusive = false;
+  *address = value;
+  return 0;
+}
+
+void __CLREX(void)
+{
+  exclusive = false;
+}
+
+void __DMB(void)
+{
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+  @file     hardware.h
+  @brief    Host stand-in of startup/hardware.h, for the host tests of the
+            drivers. Same macros, without the device registers, so only the
+            drivers that don't touch a peripheral directly build against it.
+            The interrupt mask is a variable, and a test can run a simulated
+            interrupt each time the code under test unmasks the interrupts,
+            or between the exclusive load and store of the code under test.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef STUB_HARDWARE_H_
+#define STUB_HARDWARE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sram_sections.h"
+
+#define __CORE_CLOCK__  100000000U
+#define __FOREVER__     for(;;)
+#define __ISR__         void
+
+// Simulated interrupt mask, and interrupt run when the mask is cleared while it is pending
+extern uint32_t hostPrimask;
+extern void     (*hostPendingIrq)(void);
+
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t primask);
+void     __disable_irq(void);
+void     __enable_irq(void);
+
+// Exclusive access, an interrupt taken between the load and the store makes the store fail
+extern void     (*hostExclusiveIrq)(void);
+
+uint32_t __LDREXW(volatile uint32_t* address);
+uint32_t __STREXW(uint32_t value, volatile uint32_t* address);
+void     __CLREX(void);
+void     __DMB(void);
+
+#endif /* STUB_HARDWARE_H_ */
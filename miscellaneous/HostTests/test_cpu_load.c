@@ -0,0 +1,231 @@
+/*******************************************************************************
+  @file     test_cpu_load.c
+  @brief    Host test of the CPU load accounting, with the time base built for
+            the target against a simulated core: the DWT cycle counter, which
+            stops while the core sleeps in __WFE(), and the PIT channel clocked
+            by the bus, which keeps counting. A main loop of known subsystem
+            times sleeps the rest of each period. Checks the load of every slot
+            and that the time base keeps the time slept, whether the cycle
+            counter stops while sleeping or not, and the loads read when the
+            sleeps are not measured.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+
+#include <stdint.h>
+
+// Simulated core registers used by the time base
+static struct { uint32_t CTRL; uint32_t CYCCNT; }   dwt;
+static struct { uint32_t DEMCR; }                   coreDebug;
+
+#define DWT                         (&dwt)
+#define CoreDebug                   (&coreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1U << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1U << 24)
+#define __WFE()                     simulatedSleep()
+
+static void simulatedSleep(void);
+
+// Both modules name their state context
+#define __arm__
+#define context   timebaseContext
+#include "drivers/MCAL/timebase/timebase.c"
+#undef context
+#undef __arm__
+#define context   cpuLoadContext
+#include "source/cpu_load/cpu_load.c"
+#undef context
+
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define PERIOD_US           (10000)     // Main loop woken up by the audio and the timers
+#define WAKEUP_US           (20)        // Interrupts run when waking up
+#define SIMULATED_US        (5200000)
+#define START_CYCCNT        (UINT32_MAX - TIMEBASE_US2CYCLES(500000))   // Wraps around while running
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Simulated clock, in core cycles
+static uint64_t         realCycles;
+static uint64_t         nextSystick;
+static void             (*systickCallback)(void);
+static bool             countsWhileSleeping;
+static bool             pitRunning;
+
+// Subsystems of the main loop and their time in each period, the rest of the period is slept
+static const struct {
+  cpu_load_slot_t slot;
+  uint32_t        us;
+} loop[] = {
+  { CPU_LOAD_WORK_QUEUE, 500 }, { CPU_LOAD_UI, 1000 }, { CPU_LOAD_AUDIO, 3000 }, { CPU_LOAD_VISUALISER, 500 }, { CPU_LOAD_OTHER, 50 }
+};
+
+#define LOOP_COUNT          (sizeof(loop) / sizeof(loop[0]))
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+bool systickInit(void (*callback)(void))
+{
+  systickCallback = callback;
+  return true;
+}
+
+void pitInit(pit_channel_t channel)
+{
+}
+
+void pitSetInterval(pit_channel_t channel, uint32_t ticks)
+{
+}
+
+void pitStart(pit_channel_t channel)
+{
+  pitRunning = true;
+}
+
+// Counts down from its interval at the bus clock, half the core clock
+uint32_t pitGetCount(pit_channel_t channel)
+{
+  return pitRunning ? UINT32_MAX - (uint32_t)(realCycles / TIMEBASE_CYCLES_PER_PIT) : UINT32_MAX;
+}
+
+// The core runs, counting its cycles and taking the SysTick
+static void run(uint32_t us)
+{
+  uint64_t end = realCycles + TIMEBASE_US2CYCLES(us);
+
+  while (realCycles < end)
+  {
+    uint64_t step = (nextSystick < end ? nextSystick : end) - realCycles;
+    realCycles += step;
+    dwt.CYCCNT += step;
+    if (realCycles == nextSystick)
+    {
+      nextSystick += TIMEBASE_US2CYCLES(1000);
+      systickCallback();
+    }
+  }
+}
+
+// The core sleeps until the next period, where the audio interrupt wakes it up
+static void simulatedSleep(void)
+{
+  uint64_t period = TIMEBASE_US2CYCLES(PERIOD_US);
+  uint64_t wakeup = (realCycles / period + 1) * period;
+
+  if (countsWhileSleeping)
+  {
+    dwt.CYCCNT += wakeup - realCycles;
+  }
+  realCycles = wakeup;
+  nextSystick = realCycles + TIMEBASE_US2CYCLES(1000);
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static uint8_t expectedLoad(cpu_load_slot_t slot)
+{
+  uint32_t us = 0, busy = WAKEUP_US;
+
+  for (uint32_t i = 0; i < LOOP_COUNT; i++)
+  {
+    us += loop[i].slot == slot ? loop[i].us : 0;
+    busy += loop[i].us;
+  }
+  if (slot == CPU_LOAD_WAKEUP)
+  {
+    us = WAKEUP_US;
+  }
+  else if (slot == CPU_LOAD_IDLE)
+  {
+    us = PERIOD_US - busy;
+  }
+  return (us * 100 + PERIOD_US / 2) / PERIOD_US;
+}
+
+// The main loop of the application, with the sleep of eventsWait(), returns the time base error in cycles
+static int64_t runMainLoop(bool counts, bool measured)
+{
+  memset(&timebaseContext, 0, sizeof(timebaseContext));
+  memset(&cpuLoadContext, 0, sizeof(cpuLoadContext));
+  realCycles = 0;
+  nextSystick = TIMEBASE_US2CYCLES(1000);
+  dwt.CYCCNT = START_CYCCNT;
+  countsWhileSleeping = counts;
+  pitRunning = false;
+  cpuLoadInit();
+  pitRunning = measured;
+
+  while (realCycles < TIMEBASE_US2CYCLES(SIMULATED_US))
+  {
+    for (uint32_t i = 0; i < LOOP_COUNT; i++)
+    {
+      cpuLoadSwitch(loop[i].slot);
+      run(loop[i].us);
+    }
+
+    // Sleeping with the interrupts masked, those waking the core up run afterwards
+    cpuLoadSwitch(CPU_LOAD_IDLE);
+    timebaseWaitForEvent();
+    cpuLoadSwitch(CPU_LOAD_WAKEUP);
+    run(WAKEUP_US);
+  }
+
+  return (int64_t)(timeNowCycles() - START_CYCCNT - realCycles);
+}
+
+static void printLoads(const char* name)
+{
+  printf("  %-40s busy %3u%%, idle %3u%%, wakeup %u%%, work %u%%, audio %u%%, ui %u%%, visualiser %u%%, other %u%%\n", name,
+         cpuLoadGetBusy(), cpuLoadGet(CPU_LOAD_IDLE), cpuLoadGet(CPU_LOAD_WAKEUP), cpuLoadGet(CPU_LOAD_WORK_QUEUE),
+         cpuLoadGet(CPU_LOAD_AUDIO), cpuLoadGet(CPU_LOAD_UI), cpuLoadGet(CPU_LOAD_VISUALISER), cpuLoadGet(CPU_LOAD_OTHER));
+}
+
+// Every slot reads its share of the period, whether the cycle counter counts while sleeping or not
+static void testLoads(void)
+{
+  for (uint32_t counts = 0; counts < 2; counts++)
+  {
+    uint32_t wrong = 0;
+    int64_t error = runMainLoop(counts, true);
+
+    printLoads(counts ? "cycle counter counting while sleeping:" : "cycle counter stopped while sleeping:");
+    for (cpu_load_slot_t slot = 0; slot < CPU_LOAD_SLOT_COUNT; slot++)
+    {
+      wrong += abs((int)cpuLoadGet(slot) - (int)expectedLoad(slot)) > 1;
+    }
+    CHECK(wrong == 0, "%u slots with the wrong load, the counter %s while sleeping", wrong, counts ? "counting" : "stopped");
+    CHECK(llabs(error) <= TIMEBASE_US2CYCLES(1), "the time base is %lld cycles off the real time", (long long)error);
+  }
+}
+
+// Without measuring the sleeps, the stopped cycle counter hides the idle time
+static void testUnmeasuredSleep(void)
+{
+  runMainLoop(false, false);
+  printLoads("sleeps not measured, counter stopped:");
+  CHECK(cpuLoadGet(CPU_LOAD_IDLE) < expectedLoad(CPU_LOAD_IDLE) / 2, "the idle time was accounted without measuring the sleeps");
+}
+
+int main(void)
+{
+  testLoads();
+  testUnmeasuredSleep();
+
+  return HOST_TEST_RESULT();
+}
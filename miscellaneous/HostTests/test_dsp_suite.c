@@ -0,0 +1,519 @@
+/*******************************************************************************
+  @file     test_dsp_suite.c
+  @brief    Host verification and benchmark suite of the DSP modules. Measures
+            the frequency and phase response, the SNR against a double precision
+            reference, the behaviour at full scale and the throughput of the
+            equalisers and the real FFT, the band levels of the visualiser
+            filter bank, and writes them to a JSON report so DSP
+            changes can be compared run against run. The kernels are the plain C
+            references of stub/, not CMSIS-DSP: the SNR measures the fixed point
+            design of each module, and the throughput only compares modules and
+            changes on the same host.
+  @sources  drivers/MCAL/equaliser/equaliser.c drivers/MCAL/filterbank/filterbank.c
+  @sources  drivers/MCAL/cfft/cfft.c source/math_helper.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/MCAL/equaliser/equaliser.h"
+#include "drivers/MCAL/filterbank/filterbank.h"
+#include "drivers/MCAL/cfft/cfft.h"
+#include "math_helper.h"
+
+// The IIR equaliser is included for its coefficients, the double reference runs them
+#include "drivers/MCAL/equaliser/equaliser_iir.c"
+
+#include <time.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SAMPLE_RATE           (44100.0)
+#define FRAME_SIZE            IIR_EQ_FRAME_SIZE       // Fixed by the IIR equaliser
+#define FREQUENCY_COUNT       (9)
+#define TONE_AMPLITUDE        (0.25)
+#define NOISE_AMPLITUDE       (0.1)
+#define FULL_SCALE_AMPLITUDE  (0.9)
+#define THROUGHPUT_SECONDS    (0.2)
+#define FFT_SIZE              (1024)
+#define FFT_TONE_BIN          (37)
+#define STOPBAND_DB           (-40.0)                 // Below it the response deviation is not checked
+#define FIR_TAPS_MEASURED     (128)                   // Longer than the FIR equaliser, the rest are zero
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  const char*   name;
+  void          (*reset)(void);
+  void          (*run)(const double* input, double* output);       // A frame, full scale is 1.0
+  void          (*reference)(const double* input, double* output); // The same in double precision
+  double        minSnrDb;
+  double        maxDeviationDb;
+} module_t;
+
+typedef struct {
+  double        gainDb[FREQUENCY_COUNT];
+  double        phase[FREQUENCY_COUNT];
+  double        deviationDb;
+  double        snrDb;
+  uint32_t      clipped;
+  uint32_t      wrapped;
+  double        samplesPerSecond;
+} module_result_t;
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static const double FREQUENCIES[FREQUENCY_COUNT] = { 63, 125, 250, 500, 1000, 2000, 4000, 8000, 16000 };
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static float32_t firTaps[FIR_TAPS_MEASURED];
+static double    referenceState[FRAME_SIZE + FIR_TAPS_MEASURED];
+static double    biquadState[IIR_EQ_STAGES][4];
+
+static float32_t bufferF32[2][FRAME_SIZE];
+static q15_t     bufferQ15[2][FRAME_SIZE];
+static double    input[2][FRAME_SIZE];
+static double    output[2][FRAME_SIZE];
+static double    expected[2][FRAME_SIZE];
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static q15_t toQ15(double value);
+
+/*******************************************************************************
+ *******************************************************************************
+                        MODULES UNDER TEST
+ *******************************************************************************
+ ******************************************************************************/
+
+// Combined FIR equaliser, with its default gains
+static void firReset(void)
+{
+  eqInit(FRAME_SIZE);
+  memset(referenceState, 0, sizeof(referenceState));
+}
+
+static void firRunF32(const double* in, double* out)
+{
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    bufferF32[0][n] = (float32_t)in[n];
+  }
+  eqFilterFrame(bufferF32[0], bufferF32[1]);
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    out[n] = bufferF32[1][n];
+  }
+}
+
+static void firRunQ15(const double* in, double* out)
+{
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    bufferQ15[0][n] = toQ15(in[n]);
+  }
+  eqFilterFrameQ15(bufferQ15[0], bufferQ15[1]);
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    out[n] = bufferQ15[1][n] / 32768.0;
+  }
+}
+
+static void firReference(const double* in, double* out)
+{
+  // The taps of the float path, measured once, convolved in double precision
+  memcpy(referenceState + FIR_TAPS_MEASURED - 1, in, FRAME_SIZE * sizeof(double));
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    double acc = 0.0;
+    for (uint32_t k = 0; k < FIR_TAPS_MEASURED; k++)
+    {
+      acc += firTaps[k] * referenceState[n + FIR_TAPS_MEASURED - 1 - k];
+    }
+    out[n] = acc;
+  }
+  memmove(referenceState, referenceState + FRAME_SIZE, (FIR_TAPS_MEASURED - 1) * sizeof(double));
+}
+
+// IIR equaliser, the cascade eqIirInit sets up
+static void iirReset(void)
+{
+  eqIirInit();
+  memset(biquadState, 0, sizeof(biquadState));
+}
+
+static void iirRun(const double* in, double* out)
+{
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    bufferQ15[0][n] = toQ15(in[n]);
+  }
+  eqIirFilterFrame(bufferQ15[0], bufferQ15[1]);
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    out[n] = bufferQ15[1][n] / 32768.0;
+  }
+}
+
+static void iirReference(const double* in, double* out)
+{
+  // Coefficients {b0, 0, b1, b2, a1, a2}, scaled back by the post shift of the Q15 cascade
+  double scale = 1 << context.filter.postShift;
+
+  memcpy(out, in, FRAME_SIZE * sizeof(double));
+  for (uint32_t stage = 0; stage < (uint32_t)context.filter.numStages; stage++)
+  {
+    const float32_t* b = context.coefficients + IIR_EQ_COEFFS * stage;
+    double* state = biquadState[stage];
+    for (uint32_t n = 0; n < FRAME_SIZE; n++)
+    {
+      double x = out[n];
+      double y = scale * (b[0] * x + b[2] * state[0] + b[3] * state[1] + b[4] * state[2] + b[5] * state[3]);
+      state[1] = state[0];
+      state[0] = x;
+      state[3] = state[2];
+      state[2] = y;
+      out[n] = y;
+    }
+  }
+}
+
+// The limits are the figures of the modules as they are, less a margin, so that a change
+// that makes them worse fails. The IIR cascade scales its first stage down to 0.003 to
+// avoid saturating, which leaves the signal 30dB down and limits its SNR to about 8dB.
+static const module_t MODULES[] = {
+  { "eq_fir_f32", firReset, firRunF32, firReference, 120.0, 0.01 },
+  { "eq_fir_q15", firReset, firRunQ15, firReference,  60.0, 0.05 },
+  { "eq_iir_q15", iirReset, iirRun,    iirReference,   6.0, 0.1  },
+};
+
+#define MODULE_COUNT    (sizeof(MODULES) / sizeof(MODULES[0]))
+
+/*******************************************************************************
+ *******************************************************************************
+                        MEASUREMENTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static q15_t toQ15(double value)
+{
+  return (q15_t)__SSAT((q31_t)lrint(value * 32768.0), 16);
+}
+
+static void tone(double* out, double frequency, double amplitude, uint32_t offset)
+{
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    out[n] = amplitude * sin(2.0 * M_PI * frequency * (offset + n) / SAMPLE_RATE);
+  }
+}
+
+// Least squares fit of a sine and a cosine of the frequency, on the second half of the frame
+static void fitTone(const double* signal, double frequency, double amplitude, uint32_t offset, double* gainDb, double* phase)
+{
+  double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+
+  for (uint32_t n = FRAME_SIZE / 2; n < FRAME_SIZE; n++)
+  {
+    double s = sin(2.0 * M_PI * frequency * (offset + n) / SAMPLE_RATE);
+    double c = cos(2.0 * M_PI * frequency * (offset + n) / SAMPLE_RATE);
+    ss += s * s;
+    cc += c * c;
+    sc += s * c;
+    ys += signal[n] * s;
+    yc += signal[n] * c;
+  }
+
+  double det = ss * cc - sc * sc;
+  double a = (ys * cc - yc * sc) / det;
+  double b = (yc * ss - ys * sc) / det;
+  *gainDb = 20.0 * log10(fmax(hypot(a, b) / amplitude, 1e-12));
+  *phase = atan2(b, a);
+}
+
+static void measureResponse(const module_t* module, module_result_t* result)
+{
+  double referenceDb, referencePhase;
+
+  result->deviationDb = 0.0;
+  for (uint32_t i = 0; i < FREQUENCY_COUNT; i++)
+  {
+    // Two frames, the second one in steady state
+    module->reset();
+    for (uint32_t frame = 0; frame < 2; frame++)
+    {
+      tone(input[0], FREQUENCIES[i], TONE_AMPLITUDE, frame * FRAME_SIZE);
+      module->run(input[0], output[0]);
+      module->reference(input[0], expected[0]);
+    }
+    fitTone(output[0], FREQUENCIES[i], TONE_AMPLITUDE, FRAME_SIZE, &result->gainDb[i], &result->phase[i]);
+    fitTone(expected[0], FREQUENCIES[i], TONE_AMPLITUDE, FRAME_SIZE, &referenceDb, &referencePhase);
+    if (referenceDb > STOPBAND_DB)
+    {
+      result->deviationDb = fmax(result->deviationDb, fabs(result->gainDb[i] - referenceDb));
+    }
+  }
+}
+
+static void measureSnr(const module_t* module, module_result_t* result)
+{
+  srand(1);
+  module->reset();
+  for (uint32_t frame = 0; frame < 2; frame++)
+  {
+    for (uint32_t n = 0; n < FRAME_SIZE; n++)
+    {
+      input[0][n] = NOISE_AMPLITUDE * (2.0 * rand() / RAND_MAX - 1.0);
+    }
+    module->run(input[0], output[0]);
+    module->reference(input[0], expected[0]);
+  }
+
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    bufferF32[0][n] = (float32_t)expected[0][n];
+    bufferF32[1][n] = (float32_t)output[0][n];
+  }
+  result->snrDb = arm_snr_f32(bufferF32[0], bufferF32[1], FRAME_SIZE);
+}
+
+static void measureSaturation(const module_t* module, module_result_t* result)
+{
+  uint32_t loudest = 0;
+
+  // Near full scale at the frequency with the most gain
+  for (uint32_t i = 1; i < FREQUENCY_COUNT; i++)
+  {
+    loudest = result->gainDb[i] > result->gainDb[loudest] ? i : loudest;
+  }
+
+  result->clipped = 0;
+  result->wrapped = 0;
+  module->reset();
+  for (uint32_t frame = 0; frame < 2; frame++)
+  {
+    tone(input[0], FREQUENCIES[loudest], FULL_SCALE_AMPLITUDE, frame * FRAME_SIZE);
+    module->run(input[0], output[0]);
+    module->reference(input[0], expected[0]);
+    for (uint32_t n = 0; n < FRAME_SIZE; n++)
+    {
+      // Clipping is expected past full scale, wrapping around is not
+      result->clipped += fabs(output[0][n]) >= 32767.0 / 32768.0;
+      result->wrapped += (fabs(expected[0][n]) > 0.5) && (output[0][n] * expected[0][n] < 0.0);
+    }
+  }
+}
+
+static double secondsNow(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void measureThroughput(const module_t* module, module_result_t* result)
+{
+  uint32_t frames = 0;
+  double start;
+
+  module->reset();
+  tone(input[0], 1000.0, TONE_AMPLITUDE, 0);
+  start = secondsNow();
+  do
+  {
+    module->run(input[0], output[0]);
+    frames++;
+  } while (secondsNow() - start < THROUGHPUT_SECONDS);
+  result->samplesPerSecond = frames * (double)FRAME_SIZE / (secondsNow() - start);
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        REAL FFT AND FILTER BANK
+ *******************************************************************************
+ ******************************************************************************/
+
+static double measureRfft(double* toneErrorDb)
+{
+  static float32_t spectrum[FFT_SIZE];
+  static double re[FFT_SIZE / 2 + 1], im[FFT_SIZE / 2 + 1];
+  static const uint32_t toneBin[1] = { FFT_TONE_BIN };
+  float32_t magnitude;
+  double signal = 0.0, noise = 0.0;
+
+  // Noise against a double precision DFT, over the packed spectrum of cfft.c
+  rfftInit(CFFT_1024);
+  srand(2);
+  for (uint32_t n = 0; n < FFT_SIZE; n++)
+  {
+    input[0][n] = NOISE_AMPLITUDE * (2.0 * rand() / RAND_MAX - 1.0);
+    bufferF32[0][n] = (float32_t)input[0][n];
+  }
+  for (uint32_t k = 0; k <= FFT_SIZE / 2; k++)
+  {
+    re[k] = im[k] = 0.0;
+    for (uint32_t n = 0; n < FFT_SIZE; n++)
+    {
+      re[k] += input[0][n] * cos(2.0 * M_PI * (double)(k * n % FFT_SIZE) / FFT_SIZE);
+      im[k] -= input[0][n] * sin(2.0 * M_PI * (double)(k * n % FFT_SIZE) / FFT_SIZE);
+    }
+  }
+  rfft(bufferF32[0], spectrum);
+  for (uint32_t k = 1; k < FFT_SIZE / 2; k++)
+  {
+    signal += re[k] * re[k] + im[k] * im[k];
+    noise += pow(spectrum[2 * k] - re[k], 2) + pow(spectrum[2 * k + 1] - im[k], 2);
+  }
+  signal += re[0] * re[0] + re[FFT_SIZE / 2] * re[FFT_SIZE / 2];
+  noise += pow(spectrum[0] - re[0], 2) + pow(spectrum[1] - re[FFT_SIZE / 2], 2);
+
+  // A tone centred on a bin, read back with rfftGetMagBins
+  for (uint32_t n = 0; n < FFT_SIZE; n++)
+  {
+    bufferF32[0][n] = (float32_t)(TONE_AMPLITUDE * sin(2.0 * M_PI * FFT_TONE_BIN * n / FFT_SIZE));
+  }
+  rfft(bufferF32[0], spectrum);
+  rfftGetMagBins(spectrum, toneBin, 1, &magnitude);
+  *toneErrorDb = 20.0 * log10(magnitude / (TONE_AMPLITUDE * FFT_SIZE / 2));
+
+  return 10.0 * log10(signal / fmax(noise, 1e-30));
+}
+
+// Band levels of the visualiser filter bank for a tone at each test frequency. The
+// filters keep their state, so the first frames of each tone are only a warm up.
+static void measureFilterBank(double gainDb[FREQUENCY_COUNT][FILTERBANK_BAND_COUNT])
+{
+  uint32_t bands[FILTERBANK_BAND_COUNT];
+
+  filterbankInit();
+  for (uint32_t i = 0; i < FREQUENCY_COUNT; i++)
+  {
+    for (uint32_t frame = 0; frame < 4; frame++)
+    {
+      tone(input[0], FREQUENCIES[i], TONE_AMPLITUDE, frame * FRAME_SIZE);
+      for (uint32_t n = 0; n < FRAME_SIZE; n++)
+      {
+        bufferQ15[0][n] = toQ15(input[0][n]);
+      }
+      filterbankAnalyse(bufferQ15[0], FRAME_SIZE, bands);
+    }
+    for (uint32_t band = 0; band < FILTERBANK_BAND_COUNT; band++)
+    {
+      // UINT32_MAX is the energy of a full scale tone
+      gainDb[i][band] = 10.0 * log10(fmax(bands[band], 1.0) / UINT32_MAX) - 20.0 * log10(TONE_AMPLITUDE);
+    }
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        REPORT
+ *******************************************************************************
+ ******************************************************************************/
+
+static void writeArray(FILE* report, const char* indent, const char* name, const double* values, uint32_t count, const char* separator)
+{
+  fprintf(report, "%s\"%s\": [", indent, name);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    fprintf(report, "%s%.3f", i ? ", " : "", values[i]);
+  }
+  fprintf(report, "]%s\n", separator);
+}
+
+int main(void)
+{
+  static module_result_t results[MODULE_COUNT];
+  static double bankDb[FREQUENCY_COUNT][FILTERBANK_BAND_COUNT];
+  const char* path = getenv("DSP_REPORT") ? getenv("DSP_REPORT") : "dsp_report.json";
+  double rfftToneErrorDb, rfftSnrDb;
+  FILE* report;
+
+  // The taps of the FIR equaliser, from the impulse response of its float path
+  eqInit(FRAME_SIZE);
+  memset(bufferF32, 0, sizeof(bufferF32));
+  bufferF32[0][0] = 1.0f;
+  eqFilterFrame(bufferF32[0], bufferF32[1]);
+  memcpy(firTaps, bufferF32[1], sizeof(firTaps));
+
+  for (uint32_t m = 0; m < MODULE_COUNT; m++)
+  {
+    const module_t* module = &MODULES[m];
+    module_result_t* result = &results[m];
+
+    measureResponse(module, result);
+    measureSnr(module, result);
+    measureSaturation(module, result);
+    measureThroughput(module, result);
+
+    printf("  %-10s SNR %6.1f dB, response within %5.3f dB, %u clipped, %u wrapped, %.2f Msamples/s\n",
+           module->name, result->snrDb, result->deviationDb, result->clipped, result->wrapped,
+           result->samplesPerSecond * 1e-6);
+    CHECK(result->snrDb >= module->minSnrDb, "%s: SNR %.1f dB below %.1f dB", module->name, result->snrDb, module->minSnrDb);
+    CHECK(result->deviationDb <= module->maxDeviationDb, "%s: response %.3f dB off the reference", module->name, result->deviationDb);
+    CHECK(result->wrapped == 0, "%s: %u samples wrapped around at full scale", module->name, result->wrapped);
+  }
+
+  rfftSnrDb = measureRfft(&rfftToneErrorDb);
+  printf("  %-10s SNR %6.1f dB, tone magnitude within %5.3f dB\n", "rfft_f32", rfftSnrDb, fabs(rfftToneErrorDb));
+  CHECK(rfftSnrDb >= 100.0, "rfft_f32: SNR %.1f dB", rfftSnrDb);
+  CHECK(fabs(rfftToneErrorDb) <= 0.01, "rfft_f32: tone magnitude %.3f dB off", rfftToneErrorDb);
+
+  measureFilterBank(bankDb);
+  for (uint32_t i = 0; i < FREQUENCY_COUNT; i++)
+  {
+    // The octave bands go from 43Hz to 7.6kHz, the tones up to 4kHz are each in one band
+    if (FREQUENCIES[i] <= 4000.0)
+    {
+      CHECK(bankDb[i][i] >= -1.0, "filter bank: %.0fHz tone %.2f dB down in band %u", FREQUENCIES[i], bankDb[i][i], i);
+    }
+  }
+
+  report = fopen(path, "w");
+  CHECK(report != NULL, "can't write %s", path);
+  if (report)
+  {
+    fprintf(report, "{\n  \"kernels\": \"reference C of HostTests/stub, not CMSIS-DSP\",\n");
+    fprintf(report, "  \"sample_rate\": %.0f,\n", SAMPLE_RATE);
+    writeArray(report, "  ", "frequencies_hz", FREQUENCIES, FREQUENCY_COUNT, ",");
+    fprintf(report, "  \"modules\": [\n");
+    for (uint32_t m = 0; m < MODULE_COUNT; m++)
+    {
+      fprintf(report, "    {\n      \"name\": \"%s\",\n", MODULES[m].name);
+      writeArray(report, "      ", "gain_db", results[m].gainDb, FREQUENCY_COUNT, ",");
+      writeArray(report, "      ", "phase_rad", results[m].phase, FREQUENCY_COUNT, ",");
+      fprintf(report, "      \"response_deviation_db\": %.4f,\n", results[m].deviationDb);
+      fprintf(report, "      \"snr_db\": %.2f,\n", results[m].snrDb);
+      fprintf(report, "      \"full_scale_clipped\": %u,\n", results[m].clipped);
+      fprintf(report, "      \"full_scale_wrapped\": %u,\n", results[m].wrapped);
+      fprintf(report, "      \"samples_per_second\": %.0f\n    },\n", results[m].samplesPerSecond);
+    }
+    fprintf(report, "    {\n      \"name\": \"rfft_f32\",\n      \"size\": %u,\n", FFT_SIZE);
+    fprintf(report, "      \"snr_db\": %.2f,\n      \"tone_error_db\": %.4f\n    }\n  ],\n", rfftSnrDb, rfftToneErrorDb);
+    fprintf(report, "  \"filter_bank_gain_db\": [\n");
+    for (uint32_t i = 0; i < FREQUENCY_COUNT; i++)
+    {
+      fprintf(report, "    [");
+      for (uint32_t band = 0; band < FILTERBANK_BAND_COUNT; band++)
+      {
+        fprintf(report, "%s%.2f", band ? ", " : "", bankDb[i][band]);
+      }
+      fprintf(report, "]%s\n", i + 1 < FREQUENCY_COUNT ? "," : "");
+    }
+    fprintf(report, "  ]\n}\n");
+    fclose(report);
+    printf("  report: %s\n", path);
+  }
+
+  return HOST_TEST_RESULT();
+}
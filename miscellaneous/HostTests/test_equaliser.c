@@ -0,0 +1,180 @@
+/*******************************************************************************
+  @file     test_equaliser.c
+  @brief    Host test of the combined FIR equaliser. Checks that the gain weighted
+            sum collapsed into one FIR has the magnitude response of the bank of
+            bandpass filters it replaces, sample by sample against the bank, and
+            that the Q15 path with its headroom shift follows the float one.
+            Also checks that the Q15 state holds what CMSIS writes to it.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/MCAL/equaliser/equaliser.c"
+
+#define FRAME_SIZE          (1024)
+#define RESPONSE_POINTS     (256)
+
+static const float32_t GAIN_SETS[][EQ_NUM_OF_FILTERS] = {
+  { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+  { 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f },
+  { 10.0f, 1.0f, 0.1f, 5.0f, 0.5f, 8.0f, 0.2f, 3.0f },
+  { 10.0f, 10.0f, 10.0f, 10.0f, 10.0f, 10.0f, 10.0f, 10.0f },
+  { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+};
+
+static float32_t inputF32[FRAME_SIZE];
+static float32_t outputF32[FRAME_SIZE];
+static float32_t bankF32[FRAME_SIZE];
+static float32_t bandF32[FRAME_SIZE];
+static q15_t inputQ15[FRAME_SIZE];
+static q15_t outputQ15[FRAME_SIZE];
+
+// Magnitude at the normalised frequency f of the FIR h, or of the gain weighted bank
+static double magnitude(const float32_t* h, double f)
+{
+  double re = 0.0, im = 0.0;
+  for (uint32_t n = 0; n < NUM_TAPS; n++)
+  {
+    re += h[n] * cos(2.0 * M_PI * f * n);
+    im -= h[n] * sin(2.0 * M_PI * f * n);
+  }
+  return hypot(re, im);
+}
+
+static double bankMagnitude(const float32_t* gains, double f)
+{
+  double re = 0.0, im = 0.0;
+  for (uint32_t k = 0; k < EQ_NUM_OF_FILTERS; k++)
+  {
+    for (uint32_t n = 0; n < NUM_TAPS; n++)
+    {
+      re += gains[k] * eqFirCoeffs32[k][n] * cos(2.0 * M_PI * f * n);
+      im -= gains[k] * eqFirCoeffs32[k][n] * sin(2.0 * M_PI * f * n);
+    }
+  }
+  return hypot(re, im);
+}
+
+static void testResponse(const float32_t* gains)
+{
+  double worst = 0.0, peak = 0.0;
+
+  eqSetFilterGains((float32_t*)gains);
+  for (uint32_t i = 0; i < RESPONSE_POINTS; i++)
+  {
+    double f = 0.5 * i / RESPONSE_POINTS;
+    double expected = bankMagnitude(gains, f);
+    worst = fmax(worst, fabs(magnitude(eqCoeffsF32, f) - expected));
+    peak = fmax(peak, expected);
+  }
+  CHECK(worst <= 1e-5 * fmax(peak, 1.0), "response off the bank by %g (peak %g)", worst, peak);
+}
+
+static void testAgainstBank(const float32_t* gains)
+{
+  static float32_t state[BLOCK_SIZE + NUM_TAPS - 1];
+  arm_fir_instance_f32 band;
+  double worst = 0.0, peak = 0.0;
+
+  // The combined filter, from a clean state
+  eqSetFilterGains((float32_t*)gains);
+  eqInit(FRAME_SIZE);
+  eqFilterFrame(inputF32, outputF32);
+
+  // The bank it replaces, each bandpass filter on its own and added with its gain
+  memset(bankF32, 0, sizeof(bankF32));
+  for (uint32_t k = 0; k < EQ_NUM_OF_FILTERS; k++)
+  {
+    arm_fir_init_f32(&band, NUM_TAPS, eqFirCoeffs32[k], state, BLOCK_SIZE);
+    for (uint32_t i = 0; i < FRAME_SIZE / BLOCK_SIZE; i++)
+    {
+      arm_fir_f32(&band, inputF32 + i * BLOCK_SIZE, bandF32 + i * BLOCK_SIZE, BLOCK_SIZE);
+    }
+    for (uint32_t n = 0; n < FRAME_SIZE; n++)
+    {
+      bankF32[n] += gains[k] * bandF32[n];
+    }
+  }
+
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    worst = fmax(worst, fabs(outputF32[n] - bankF32[n]));
+    peak = fmax(peak, fabs(bankF32[n]));
+  }
+  CHECK(worst <= 1e-5 * fmax(peak, 1.0), "output off the bank by %g (peak %g)", worst, peak);
+}
+
+static void testQ15(const float32_t* gains)
+{
+  float32_t maxCoeff = 0.0f;
+  double worst = 0.0;
+
+  eqSetFilterGains((float32_t*)gains);
+  eqInit(FRAME_SIZE);
+  eqFilterFrame(inputF32, outputF32);
+  eqInit(FRAME_SIZE);
+  eqFilterFrameQ15(inputQ15, outputQ15);
+
+  // The shift is the smallest that keeps the coefficients below 1.0
+  for (uint32_t n = 0; n < NUM_TAPS; n++)
+  {
+    maxCoeff = fmaxf(maxCoeff, fabsf(eqCoeffsF32[n]));
+  }
+  CHECK(maxCoeff < ldexpf(1.0f, eqShiftQ15) || eqShiftQ15 == Q15_MAX_SHIFT, "shift %d too small for %g", eqShiftQ15, maxCoeff);
+  CHECK(eqShiftQ15 == 0 || maxCoeff >= ldexpf(1.0f, eqShiftQ15 - 1), "shift %d too large for %g", eqShiftQ15, maxCoeff);
+
+  // Truncation of the output and rounding of the coefficients, both scaled back by the shift
+  double tolerance = 4.0 * ldexp(1.0, eqShiftQ15);
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    double expected = fmax(fmin(outputF32[n] * 32768.0, 32767.0), -32768.0);
+    worst = fmax(worst, fabs(outputQ15[n] - expected));
+  }
+  CHECK(worst <= tolerance, "Q15 off the float output by %g LSB, shift %d", worst, eqShiftQ15);
+  printf("  gains %4.1f..: shift %d, Q15 worst error %5.1f LSB (tolerance %5.1f)\n", gains[0], eqShiftQ15, worst, tolerance);
+}
+
+// A guard after a copy of the state, as long as the one of the firmware, is never written
+static void testStateSize(void)
+{
+  static struct {
+    q15_t state[sizeof(firStateQ15) / sizeof(q15_t)];
+    q15_t guard[4];
+  } guarded;
+  uint32_t written = 0;
+
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    guarded.guard[i] = (q15_t)0x5A5A;
+  }
+  eqSetFilterGains((float32_t*)GAIN_SETS[0]);
+  eqInit(FRAME_SIZE);
+  arm_fir_init_q15(&eqFilterQ15, NUM_TAPS_Q15, eqCoeffsQ15, guarded.state, blockSize);
+  eqFilterFrameQ15(inputQ15, outputQ15);
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    written += guarded.guard[i] != (q15_t)0x5A5A;
+  }
+  CHECK(written == 0, "%u entries written past the Q15 state of %zu", written, sizeof(firStateQ15) / sizeof(q15_t));
+}
+
+int main(void)
+{
+  // Noise at a tenth of full scale, exact in both formats
+  srand(1);
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    inputQ15[n] = (q15_t)((rand() % 6554) - 3277);
+    inputF32[n] = inputQ15[n] / 32768.0f;
+  }
+
+  for (uint32_t set = 0; set < sizeof(GAIN_SETS) / sizeof(GAIN_SETS[0]); set++)
+  {
+    testResponse(GAIN_SETS[set]);
+    testAgainstBank(GAIN_SETS[set]);
+    testQ15(GAIN_SETS[set]);
+  }
+  testStateSize();
+
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,300 @@
+/*******************************************************************************
+  @file     test_hd44780_lcd.c
+  @brief    Host test of the LCD drivers with a congested serial to parallel
+            port. The SPI driver is replaced by a small queue drained a few
+            frames per tick, so many writes find it full, and by a model of the
+            LCD decoding the frames it accepts. Checks that no byte is ever left
+            half written, and that once the port drains the LCD shows the
+            screen of the services and the custom characters, with the cells
+            and the cursor that could not be written sent again.
+  @sources  drivers/HAL/HD44780/HD44780.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/HAL/HD44780_LCD/HD44780_LCD.c"
+#include "drivers/MCAL/spi/spi_master.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define PORT_QUEUE_FRAMES   (40)            // Frames the SPI queue holds
+#define PORT_DRAIN_FRAMES   (12)            // Frames sent by the SPI each tick
+#define RANDOM_WRITES       (2000)
+#define SETTLE_TICKS        (100)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Simulated timers, all of them run from the tick
+typedef struct {
+  tim_callback_t  callback;
+  ttick_t         period;
+  ttick_t         left;
+  uint8_t         mode;
+  bool            running;
+} sim_timer_t;
+
+static sim_timer_t  timers[TIMERS_MAX_CANT];
+static tim_id_t     timerCount;
+
+// Simulated port queue
+static uint32_t     queuedFrames;
+static uint32_t     rejectedSends;
+
+// Model of the LCD, decoding the port frames
+static uint8_t      ddram[128];
+static uint8_t      cgram[64];
+static uint8_t      addressCounter;
+static bool         cgramSelected;
+static bool         fourBitMode;
+static bool         enable;
+static int          highNybble = -1;
+static uint32_t     halfBytes;
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+void timerInit(void)
+{
+}
+
+tim_id_t timerGetId(void)
+{
+  return timerCount++;
+}
+
+void timerStart(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback)
+{
+  timers[id] = (sim_timer_t){ callback, ticks, ticks, mode, true };
+}
+
+void timerStartDeferred(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback)
+{
+  timerStart(id, ticks, mode, callback);
+}
+
+void timerPause(tim_id_t id)
+{
+  timers[id].running = false;
+}
+
+void spiInit(spi_id_t id, spi_slave_id_t slave, spi_cfg_t config)
+{
+}
+
+bool spiCanSend(spi_id_t id, size_t len)
+{
+  bool canSend = queuedFrames + len <= PORT_QUEUE_FRAMES;
+  rejectedSends += !canSend;
+  return canSend;
+}
+
+static void lcdByte(bool rs, uint8_t byte)
+{
+  if (rs)
+  {
+    if (cgramSelected)
+    {
+      cgram[addressCounter++ & 0x3F] = byte;
+    }
+    else
+    {
+      ddram[addressCounter++ & 0x7F] = byte;
+    }
+  }
+  else if (byte & 0x80)
+  {
+    addressCounter = byte & 0x7F;
+    cgramSelected = false;
+  }
+  else if (byte & 0x40)
+  {
+    addressCounter = byte & 0x3F;
+    cgramSelected = true;
+  }
+  else if (byte == HD44780_CLEAR_DISPLAY)
+  {
+    memset(ddram, ' ', sizeof(ddram));
+    addressCounter = 0;
+  }
+  else if (byte == HD44780_RETURN_HOME)
+  {
+    addressCounter = 0;
+  }
+}
+
+bool spiSend(spi_id_t id, spi_slave_id_t slave, const uint16_t message[], size_t len)
+{
+  if (!spiCanSend(id, len))
+  {
+    return false;
+  }
+  queuedFrames += len;
+
+  // The LCD latches D4-D7 and RS on the falling edge of E
+  for (size_t i = 0; i < len; i++)
+  {
+    bool rs = (message[i] >> 5) & 1;
+    bool e = (message[i] >> 4) & 1;
+    uint8_t nybble = message[i] & 0xF;
+    if (enable && !e)
+    {
+      if (!fourBitMode)
+      {
+        fourBitMode = (nybble == (HD44780_FUNCTION_SET(0, 0, 0) >> 4));
+      }
+      else if (highNybble < 0)
+      {
+        highNybble = nybble;
+      }
+      else
+      {
+        lcdByte(rs, (highNybble << 4) | nybble);
+        highNybble = -1;
+      }
+    }
+    enable = e;
+  }
+
+  // Once in 4 bit mode, every send must end on a whole byte
+  halfBytes += fourBitMode && (highNybble >= 0);
+  return true;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void tick(void)
+{
+  queuedFrames = queuedFrames > PORT_DRAIN_FRAMES ? queuedFrames - PORT_DRAIN_FRAMES : 0;
+  for (tim_id_t id = 0; id < timerCount; id++)
+  {
+    if (timers[id].running && (--timers[id].left == 0))
+    {
+      timers[id].left = timers[id].period;
+      timers[id].running = (timers[id].mode == TIM_MODE_PERIODIC);
+      timers[id].callback();
+    }
+  }
+}
+
+static uint32_t screenMismatches(void)
+{
+  uint32_t mismatches = 0;
+  for (uint8_t line = 0; line < HD44780_LINE_COUNT; line++)
+  {
+    mismatches += memcmp(&ddram[HD44780_LINE_ADDRESS(line)], context.screen[line], HD44780_COL_COUNT) != 0;
+  }
+  return mismatches;
+}
+
+// The custom characters are all written, even when the port is full while writing them
+static void testInit(void)
+{
+  HD44780LcdInit();
+  for (uint32_t i = 0; (i < 1000) && !HD44780LcdInitReady(); i++)
+  {
+    // Once the LCD is initialised, the port is kept busy while the characters are written
+    if (HD44780InitReady())
+    {
+      queuedFrames = rand() % PORT_QUEUE_FRAMES;
+    }
+    tick();
+  }
+  CHECK(HD44780LcdInitReady(), "the custom characters were never ready");
+  CHECK(memcmp(&cgram[8], customCharacters[1], sizeof(customCharacters) - 8) == 0, "the custom characters differ in the CGRAM");
+  CHECK(halfBytes == 0, "%u sends left half a byte while initialising", halfBytes);
+}
+
+// Services writing faster than the port drains, the LCD ends showing the screen
+static void testCongested(void)
+{
+  uint8_t text[HD44780_COL_COUNT];
+  uint32_t pending = 0, rejected = rejectedSends;
+
+  for (uint32_t n = 0; n < RANDOM_WRITES; n++)
+  {
+    uint8_t line = rand() % HD44780_LINE_COUNT;
+    uint8_t len = 1 + rand() % HD44780_COL_COUNT;
+    for (uint8_t i = 0; i < len; i++)
+    {
+      text[i] = 'A' + rand() % 26;
+    }
+    if (rand() % 4)
+    {
+      HD44780WriteString(line, rand() % HD44780_COL_COUNT, text, len);
+    }
+    else
+    {
+      HD44780WriteNewLine(line, text, len);
+    }
+    if (rand() % 3 == 0)
+    {
+      tick();
+    }
+  }
+  pending = memcmp(context.screen, context.shadow, sizeof(context.shadow)) != 0;
+
+  for (uint32_t i = 0; i < SETTLE_TICKS; i++)
+  {
+    tick();
+  }
+  printf("  %u writes rejected by the port\n", rejectedSends - rejected);
+  CHECK(rejectedSends > rejected, "the port was never full, the test does not exercise anything");
+  CHECK(pending, "no cell was left pending by the congested port");
+  CHECK(halfBytes == 0, "%u sends left half a byte", halfBytes);
+  CHECK(screenMismatches() == 0, "the LCD differs from the screen after the port drained");
+  CHECK(memcmp(context.screen, context.shadow, sizeof(context.shadow)) == 0, "cells still pending after the port drained");
+}
+
+// A rotating line keeps scrolling while the other line is rewritten, and the shadow always
+// holds what the LCD shows
+static void testRotating(void)
+{
+  const char* title = "Pink Floyd - Shine On You Crazy Diamond (Parts I-V).mp3";
+  uint32_t wrongShadow = 0, shown = 0;
+
+  HD44780WriteRotatingString(0, (uint8_t*)title, strlen(title), 20);
+  for (uint32_t i = 0; i < 2000; i++)
+  {
+    if (i % 7 == 0)
+    {
+      HD44780WriteNewLine(1, (uint8_t*)((i & 8) ? "Vol 21   EQ Rock" : "Vol 20   EQ Rock"), 16);
+    }
+    tick();
+    for (uint8_t line = 0; line < HD44780_LINE_COUNT; line++)
+    {
+      wrongShadow += memcmp(&ddram[HD44780_LINE_ADDRESS(line)], context.shadow[line], HD44780_COL_COUNT) != 0;
+    }
+    shown += screenMismatches() == 0;
+  }
+  printf("  screen shown on the LCD on %u of 2000 ticks\n", shown);
+  CHECK(halfBytes == 0, "%u sends left half a byte", halfBytes);
+  CHECK(wrongShadow == 0, "%u ticks with the shadow differing from the LCD", wrongShadow);
+
+  // Once the line stops rotating, the last writes reach the LCD
+  HD44780WriteNewLine(0, (uint8_t*)"Paused", 6);
+  for (uint32_t i = 0; i < SETTLE_TICKS; i++)
+  {
+    tick();
+  }
+  CHECK(screenMismatches() == 0, "the LCD differs from the screen after the rotation stopped");
+}
+
+int main(void)
+{
+  testInit();
+  testCongested();
+  testRotating();
+
+  return HOST_TEST_RESULT();
+}
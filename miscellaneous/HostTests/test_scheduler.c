@@ -0,0 +1,460 @@
+/*******************************************************************************
+  @file     test_scheduler.c
+  @brief    Host test of the scheduler of the main loop on a simulated clock,
+            with the real work queue as the LCD task. The tasks of app.c are
+            simulated with their cost on the board: the refill of each DAC
+            buffer, the display work posted every tick, the scrolling through a
+            large directory, the decoder prefetch and the visualiser. Compares
+            the latency of the refills with the loop it replaced, which handled
+            the whole scan with each input event, and checks that the LCD task
+            keeps its budget and that a slice over its budget is reported by the
+            SysTick while it is still running.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+
+// Both modules name their state context
+#define context   schedulerContext
+#include "source/scheduler/scheduler.c"
+#undef context
+#define context   workQueueContext
+#include "drivers/HAL/work_queue/work_queue.c"
+#undef context
+
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TICK_US             (1000)
+#define SIMULATED_S         (120)
+
+// Costs on the board, estimates
+#define DECODE_FRAME_US     (4000)        // One MP3 frame, the longest slice below the refill
+#define REFILL_OUTPUT_US    (6000)        // Equaliser, visualiser feed and DAC conversion of a buffer
+#define READDIR_US          (250)         // One f_readdir() of a large directory
+#define INPUT_US            (200)
+#define VISUALISER_US       (3000)
+
+// Audio, in samples
+#define PERIOD_US           (4096 * 1000000ULL / 44100)
+#define FRAME_SAMPLES       (2304)
+#define REFILL_SAMPLES      (8192)
+#define DECODED_CAPACITY    (4608 + 2 * 4096)
+#define DIRECTORY_SIZE      (1000)
+#define SCAN_READS          (8)           // Entries read by each slice of the scan
+
+// Budgets of app.c
+#define AUDIO_REFILL_BUDGET_US      (20000)
+#define LCD_BUDGET_US               (WORK_QUEUE_RUN_US)
+#define INPUT_BUDGET_US             (5000)
+#define DECODER_PREFETCH_BUDGET_US  (15000)
+#define LIBRARY_SCAN_BUDGET_US      (5000)
+#define VISUALISER_BUDGET_US        (5000)
+
+#define HUNG_BUDGET_US      (1000)
+#define HUNG_US             (3500)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Simulated clock, the SysTick watches the slices and the timers post the display work
+static uint64_t     cycles;
+static uint64_t     nextTick;
+static uint32_t     ticks;
+static void         (*systickCallback)(void);
+
+// Trace points of the scheduler, with the time they were recorded
+static uint32_t     overBudgetTraces;
+static uint32_t     overrunTraces;
+static uint64_t     overBudgetCycles;
+
+// Next arrival of each source of work
+static uint64_t     nextFrame;
+static uint64_t     nextVisualiser;
+static uint64_t     nextInput;
+
+// Audio and directory state
+static uint32_t     decoded;
+static uint32_t     position;
+static uint32_t     target;
+static bool         scanning;
+static bool         monolithic;
+static uint32_t     inputs;
+
+// Results of the refills
+static uint32_t     frames;
+static uint32_t     late;
+static uint64_t     worstLatency;
+
+// Slice that runs over its budget
+static bool         hung;
+static uint32_t     flagsWhileRunning;
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+void timebaseInit(void)
+{
+}
+
+uint64_t timeNowCycles(void)
+{
+  return cycles;
+}
+
+bool systickInit(void (*callback)(void))
+{
+  systickCallback = callback;
+  return true;
+}
+
+void cpuLoadSwitch(cpu_load_slot_t slot)
+{
+}
+
+void traceRecord(trace_id_t id, uint16_t arg, uint32_t payload)
+{
+  if (id == TRACE_TASK_OVER_BUDGET)
+  {
+    overBudgetTraces++;
+    overBudgetCycles = cycles;
+  }
+  overrunTraces += id == TRACE_TASK_OVERRUN;
+}
+
+static void displayTick(void);
+
+// The core runs, taking the SysTick on every tick
+static void spend(uint64_t us)
+{
+  uint64_t end = cycles + TIMEBASE_US2CYCLES(us);
+
+  while (nextTick <= end)
+  {
+    cycles = nextTick;
+    nextTick += TIMEBASE_US2CYCLES(TICK_US);
+    ticks++;
+    systickCallback();
+    displayTick();
+  }
+  cycles = end;
+}
+
+// The core sleeps until the next interrupt raising work
+static void sleep(void)
+{
+  uint64_t next = nextFrame;
+
+  next = nextVisualiser < next ? nextVisualiser : next;
+  next = nextInput < next ? nextInput : next;
+  next = nextTick < next ? nextTick : next;
+  if (next > cycles)
+  {
+    spend(TIMEBASE_CYCLES2US(next - cycles + TIMEBASE_US2CYCLES(1) - 1));
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED TASKS
+ *******************************************************************************
+ ******************************************************************************/
+
+// Works of the display, with their cost on the board
+#define DISPLAY_WORK(name, costUs) static void name(void) { spend(costUs); }
+DISPLAY_WORK(lcdRotateTop,    900)
+DISPLAY_WORK(lcdRotateBottom, 900)
+DISPLAY_WORK(lcdFlush,        120)
+DISPLAY_WORK(audioLcd,        450)
+DISPLAY_WORK(uiLcd,           450)
+DISPLAY_WORK(displayFps,      750)
+
+// Periods of the timers posting them
+static const struct {
+  work_callback_t work;
+  uint32_t        periodMs;
+} displayWork[] = {
+  { lcdRotateTop, 350 }, { lcdRotateBottom, 350 }, { lcdFlush, 1 }, { audioLcd, 100 }, { uiLcd, 100 }, { displayFps, 20 }
+};
+
+#define DISPLAY_WORK_COUNT  (sizeof(displayWork) / sizeof(displayWork[0]))
+
+static void displayTick(void)
+{
+  for (uint32_t i = 0; i < DISPLAY_WORK_COUNT; i++)
+  {
+    if (ticks % displayWork[i].periodMs == 0)
+    {
+      workQueuePost(displayWork[i].work);
+    }
+  }
+}
+
+static void decode(void)
+{
+  spend(DECODE_FRAME_US);
+  decoded += FRAME_SAMPLES;
+}
+
+// Refills the buffer played, decoding what the prefetch did not
+static bool audioRefillTask(void)
+{
+  uint64_t played = nextFrame;
+
+  if (cycles < nextFrame)
+  {
+    return false;
+  }
+
+  nextFrame += TIMEBASE_US2CYCLES(PERIOD_US);
+  worstLatency = cycles - played > worstLatency ? cycles - played : worstLatency;
+  while (decoded < REFILL_SAMPLES)
+  {
+    decode();
+  }
+  spend(REFILL_OUTPUT_US);
+  decoded -= REFILL_SAMPLES;
+  late += cycles - played > TIMEBASE_US2CYCLES(PERIOD_US);
+  frames++;
+
+  return true;
+}
+
+static bool scanSlice(uint32_t reads)
+{
+  if (!scanning)
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; scanning && (i < reads); i++)
+  {
+    if ((position > target) || (position >= DIRECTORY_SIZE))
+    {
+      scanning = false;
+    }
+    else
+    {
+      spend(READDIR_US);
+      position++;
+    }
+  }
+
+  return true;
+}
+
+// Moving back in the directory reads it again from its first entry
+static void seek(uint32_t index)
+{
+  if (index + 1 < position)
+  {
+    position = 0;
+  }
+  target = index;
+  scanning = true;
+}
+
+// Scrolling at about 20 detents per second, with a fast spin every 25 of them
+static bool inputTask(void)
+{
+  uint32_t shown = scanning ? target : (position ? position - 1 : 0);
+
+  if (cycles < nextInput)
+  {
+    return false;
+  }
+
+  inputs++;
+  nextInput += TIMEBASE_US2CYCLES(20000 + rand() % 60000);
+  spend(INPUT_US);
+  if (inputs % 50 == 0)
+  {
+    seek(shown + 900);
+  }
+  else if (inputs % 50 == 25)
+  {
+    seek(shown > 900 ? shown - 900 : 0);
+  }
+  else
+  {
+    seek(rand() % 2 ? shown + 1 : (shown ? shown - 1 : 0));
+  }
+
+  // The loop replaced read the directory up to the entry shown before leaving
+  while (monolithic && scanSlice(UINT32_MAX));
+
+  return true;
+}
+
+static bool decoderPrefetchTask(void)
+{
+  if (decoded + 2 * FRAME_SAMPLES > DECODED_CAPACITY)
+  {
+    return false;
+  }
+
+  decode();
+  return true;
+}
+
+static bool libraryScanTask(void)
+{
+  return scanSlice(SCAN_READS);
+}
+
+static bool visualiserTask(void)
+{
+  if (cycles < nextVisualiser)
+  {
+    return false;
+  }
+
+  nextVisualiser += TIMEBASE_US2CYCLES(33333);
+  spend(VISUALISER_US);
+  return true;
+}
+
+// Finds its overrun flag set by the SysTick before it returns
+static bool hungTask(void)
+{
+  if (!hung)
+  {
+    return false;
+  }
+
+  hung = false;
+  spend(HUNG_US);
+  flagsWhileRunning = schedulerTakeOverruns();
+  return true;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void resetScheduler(void)
+{
+  memset(&schedulerContext, 0, sizeof(schedulerContext));
+  memset(&workQueueContext, 0, sizeof(workQueueContext));
+  schedulerInit();
+  workQueueInit();
+  cycles = 0;
+  ticks = 0;
+  nextTick = TIMEBASE_US2CYCLES(TICK_US);
+  overBudgetTraces = 0;
+  overrunTraces = 0;
+}
+
+// Main loop of the tasks of app.c, or of the loop it replaced
+static void runMainLoop(bool replaced)
+{
+  resetScheduler();
+  srand(1);
+  monolithic = replaced;
+  nextFrame = TIMEBASE_US2CYCLES(PERIOD_US);
+  nextVisualiser = TIMEBASE_US2CYCLES(33333);
+  nextInput = TIMEBASE_US2CYCLES(50000);
+  decoded = 0;
+  position = 1;
+  target = 0;
+  scanning = false;
+  inputs = 0;
+  frames = 0;
+  late = 0;
+  worstLatency = 0;
+
+  schedulerAddTask(audioRefillTask, AUDIO_REFILL_BUDGET_US, CPU_LOAD_AUDIO);
+  schedulerAddTask(workQueueRun, LCD_BUDGET_US, CPU_LOAD_WORK_QUEUE);
+  schedulerAddTask(inputTask, INPUT_BUDGET_US, CPU_LOAD_UI);
+  schedulerAddTask(decoderPrefetchTask, DECODER_PREFETCH_BUDGET_US, CPU_LOAD_AUDIO);
+  schedulerAddTask(libraryScanTask, LIBRARY_SCAN_BUDGET_US, CPU_LOAD_UI);
+  schedulerAddTask(visualiserTask, VISUALISER_BUDGET_US, CPU_LOAD_VISUALISER);
+
+  while (cycles < TIMEBASE_US2CYCLES(SIMULATED_S * 1000000ULL))
+  {
+    if (replaced)
+    {
+      // The deferred work, then one event by class or the visualiser
+      workQueueRun();
+      if (!audioRefillTask() && !inputTask() && !visualiserTask())
+      {
+        sleep();
+      }
+    }
+    else if (!schedulerRun())
+    {
+      sleep();
+    }
+  }
+
+  printf("  %-10s %u buffers, %3u late, longest from played to refilled %6.1f ms\n", replaced ? "replaced" : "scheduler",
+         frames, late, TIMEBASE_CYCLES2US(worstLatency) / 1000.0);
+}
+
+// A buffer waits at most for the longest slice of a lower priority task
+static void testRefillLatency(void)
+{
+  static const char* names[] = { "audio refill", "lcd", "input", "decoder prefetch", "library scan", "visualiser" };
+  scheduler_stats_t stats;
+  uint32_t replacedLate;
+
+  runMainLoop(true);
+  replacedLate = late;
+  runMainLoop(false);
+
+  for (scheduler_task_id_t id = 0; id < schedulerContext.count; id++)
+  {
+    stats = schedulerGetStats(id);
+    printf("    %-17s %6u slices, longest %5.2f ms of %5.2f ms, %u over the budget\n", names[id], stats.runs,
+           TIMEBASE_CYCLES2US(stats.maxCycles) / 1000.0, TIMEBASE_CYCLES2US(stats.budgetCycles) / 1000.0, stats.overruns);
+    CHECK(stats.overruns == 0, "the %s task ran over its budget %u times", names[id], stats.overruns);
+  }
+  CHECK(late == 0, "%u buffers refilled late", late);
+  CHECK(worstLatency <= TIMEBASE_US2CYCLES(DECODE_FRAME_US + READDIR_US),
+        "a buffer waited %llu us to be refilled", (unsigned long long)TIMEBASE_CYCLES2US(worstLatency));
+  CHECK(replacedLate > 0, "the loop replaced never refilled late, the test does not load it");
+  CHECK(schedulerTakeOverruns() == 0 && overBudgetTraces == 0 && overrunTraces == 0, "overruns were reported");
+}
+
+// A slice over its budget is flagged and traced by the SysTick while it runs, and counted once when it ends
+static void testOverrunWhileRunning(void)
+{
+  scheduler_task_id_t id;
+  scheduler_stats_t stats;
+
+  resetScheduler();
+  id = schedulerAddTask(hungTask, HUNG_BUDGET_US, CPU_LOAD_OTHER);
+  hung = true;
+  flagsWhileRunning = 0;
+  schedulerRun();
+  stats = schedulerGetStats(id);
+
+  CHECK(flagsWhileRunning == 1UL << id, "the slice was not flagged while it ran, flags %08x", flagsWhileRunning);
+  CHECK(overBudgetTraces == 1, "the slice over its budget was traced %u times while it ran", overBudgetTraces);
+  CHECK(overBudgetCycles <= TIMEBASE_US2CYCLES(HUNG_BUDGET_US + TICK_US), "the slice was found over its budget %llu us after it started",
+        (unsigned long long)TIMEBASE_CYCLES2US(overBudgetCycles));
+  CHECK(stats.overruns == 1 && overrunTraces == 1, "the slice was counted %u times and traced %u times when it ended",
+        stats.overruns, overrunTraces);
+  CHECK(schedulerTakeOverruns() == 1UL << id, "the slice was not flagged when it ended");
+
+  // The SysTick between the slices flags nothing
+  spend(HUNG_US);
+  CHECK(schedulerTakeOverruns() == 0 && overBudgetTraces == 1, "a flag was set between the slices");
+}
+
+int main(void)
+{
+  testRefillLatency();
+  testOverrunWhileRunning();
+
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+/*******************************************************************************
+  @file     test_spectrum.c
+  @brief    Host test of the spectrum analyser band mapping. Feeds known tones
+            through the decimator, window and FFT, and checks the band they
+            land in, the leakage into the other bands, and the dB levels of
+            the vumeter table.
+  @sources  drivers/MCAL/cfft/cfft.c lib/vumeter/vumeter.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/MCAL/spectrum/spectrum.c"
+#include "lib/vumeter/vumeter.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SAMPLE_RATE       (44100.0)
+#define BIN_HZ            (SAMPLE_RATE / SPECTRUM_DECIMATION / SPECTRUM_FFT_SIZE)
+#define FEED_SIZE         (4096)          // Fills the history several times over
+#define LEAKAGE_DB        (25.0)          // Least attenuation of the bands not next to the tone
+#define LEVEL_DB          (0.75)          // dB per vumeter level
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static int16_t   samples[FEED_SIZE];
+static q15_t     snapshot[SPECTRUM_SNAPSHOT_SIZE];
+static uint32_t  bands[SPECTRUM_BAND_COUNT];
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void analyseTone(double frequency, double amplitude)
+{
+  for (uint32_t n = 0; n < FEED_SIZE; n++)
+  {
+    samples[n] = (int16_t)lrint(amplitude * 32767.0 * sin(2.0 * M_PI * frequency * n / SAMPLE_RATE));
+  }
+  spectrumFeed(samples, FEED_SIZE, 1);
+  spectrumGetSnapshot(snapshot);
+  spectrumAnalyse(snapshot, bands);
+}
+
+static uint32_t loudestBand(void)
+{
+  uint32_t loudest = 0;
+  for (uint32_t band = 1; band < SPECTRUM_BAND_COUNT; band++)
+  {
+    loudest = bands[band] > bands[loudest] ? band : loudest;
+  }
+  return loudest;
+}
+
+static double toDb(uint32_t power)
+{
+  return 10.0 * log10(fmax(power, 1.0) / (double)UINT32_MAX);
+}
+
+// A tone at the geometric centre of each band lands in it, with little leakage past its neighbours
+static void testBandMapping(void)
+{
+  for (uint32_t band = 0; band < SPECTRUM_BAND_COUNT; band++)
+  {
+    double frequency = sqrt((double)BAND_FIRST_BIN[band] * BAND_FIRST_BIN[band + 1]) * BIN_HZ;
+    analyseTone(frequency, 0.5);
+
+    CHECK(loudestBand() == band, "%.0fHz tone in band %u instead of %u", frequency, loudestBand(), band);
+    for (uint32_t other = 0; other < SPECTRUM_BAND_COUNT; other++)
+    {
+      if ((other + 1 < band) || (other > band + 1))
+      {
+        double leakage = toDb(bands[band]) - toDb(bands[other]);
+        CHECK(leakage >= LEAKAGE_DB, "%.0fHz tone leaks into band %u, only %.1fdB down", frequency, other, leakage);
+      }
+    }
+    printf("  band %u: %5.0fHz tone at %6.1fdB\n", band, frequency, toDb(bands[band]));
+  }
+}
+
+// Full scale maps to the top level, and the levels follow the tone amplitude in 0.75dB steps
+static void testLevels(void)
+{
+  double frequency = BIN_HZ * 24;
+  uint8_t fullScale, quieter;
+
+  analyseTone(frequency, 1.0);
+  fullScale = vumeterPowerToLevel(bands[4]);
+  CHECK(fullScale + VUMETER_LEVELS_PER_ROW / 2 >= VUMETER_LEVEL_MAX, "full scale tone at level %u of %u", fullScale, VUMETER_LEVEL_MAX);
+
+  analyseTone(frequency, pow(10.0, -24.0 / 20.0));
+  quieter = vumeterPowerToLevel(bands[4]);
+  CHECK(abs((int)(fullScale - quieter) - (int)lrint(24.0 / LEVEL_DB)) <= 1, "24dB quieter tone %u levels down", fullScale - quieter);
+}
+
+// Tones past the highest band edge and their images stay out of the bands
+static void testTopEdge(void)
+{
+  const double frequencies[] = { 9000.0, 15000.0, 19000.0 };
+
+  for (uint32_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); i++)
+  {
+    analyseTone(frequencies[i], 1.0);
+    for (uint32_t band = 0; band < SPECTRUM_BAND_COUNT; band++)
+    {
+      CHECK(toDb(bands[band]) <= -LEAKAGE_DB, "%.0fHz tone shows in band %u at %.1fdB", frequencies[i], band, toDb(bands[band]));
+    }
+  }
+}
+
+int main(void)
+{
+  spectrumInit();
+
+  testBandMapping();
+  testLevels();
+  testTopEdge();
+
+  return HOST_TEST_RESULT();
+}
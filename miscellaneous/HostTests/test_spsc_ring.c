@@ -0,0 +1,146 @@
+/*******************************************************************************
+  @file     test_spsc_ring.c
+  @brief    Host test of the lock-free ring. A producer thread pushes numbered
+            elements that a consumer thread pops, through small rings that wrap
+            around constantly, and checks that every element comes out once,
+            whole and in order. Also checks the full and empty rings, and the
+            sizes accepted by SPSC_RING_CHECK().
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include "host_test.h"
+#include "lib/spsc_ring/spsc_ring.c"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define STRESS_ELEMENTS     (1000000)
+#define RING_CAPACITY       (4)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Elements of one and of several words, each word derived from the sequence number
+typedef struct {
+  uint32_t  sequence;
+} small_element_t;
+
+typedef struct {
+  uint32_t  sequence;
+  uint32_t  check[4];
+} large_element_t;
+
+SPSC_RING_CHECK(RING_CAPACITY, sizeof(small_element_t));
+SPSC_RING_CHECK(RING_CAPACITY, sizeof(large_element_t));
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static spsc_ring_t      ring;
+static large_element_t  buffer[RING_CAPACITY];
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void fill(large_element_t* element, uint32_t sequence)
+{
+  element->sequence = sequence;
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    element->check[i] = ~sequence * 2654435761U + i;
+  }
+}
+
+static void* producer(void* argument)
+{
+  large_element_t element;
+
+  for (uint32_t sequence = 0; sequence < STRESS_ELEMENTS; )
+  {
+    fill(&element, sequence);
+    if (spscRingPush(&ring, &element))
+    {
+      sequence++;
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+// Every element pushed by the other thread is popped once, whole and in order
+static void testStress(size_t size)
+{
+  large_element_t element, expected;
+  uint32_t sequence = 0, wrong = 0, torn = 0;
+  pthread_t thread;
+
+  ring = createSpscRing(buffer, RING_CAPACITY, size);
+  pthread_create(&thread, NULL, producer, NULL);
+
+  while (sequence < STRESS_ELEMENTS)
+  {
+    memset(&element, 0, sizeof(element));
+    if (spscRingPop(&ring, &element))
+    {
+      fill(&expected, sequence);
+      wrong += element.sequence != sequence;
+      torn += memcmp(&element, &expected, size) != 0;
+      sequence++;
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+  pthread_join(thread, NULL);
+
+  CHECK(wrong == 0, "%u elements of %zu bytes out of order", wrong, size);
+  CHECK(torn == 0, "%u elements of %zu bytes torn", torn, size);
+  CHECK(spscRingIsEmpty(&ring), "elements of %zu bytes left in the ring", size);
+}
+
+// Every slot is used, and a full or empty ring leaves the element untouched
+static void testFullAndEmpty(void)
+{
+  large_element_t element;
+  uint32_t pushed = 0;
+
+  ring = createSpscRing(buffer, RING_CAPACITY, sizeof(large_element_t));
+  for (uint32_t i = 0; i < RING_CAPACITY + 2; i++)
+  {
+    fill(&element, i);
+    pushed += spscRingPush(&ring, &element);
+  }
+  CHECK(pushed == RING_CAPACITY, "%u elements pushed to a ring of %u", pushed, RING_CAPACITY);
+  CHECK(spscRingSize(&ring) == RING_CAPACITY, "the full ring has a size of %u", spscRingSize(&ring));
+
+  for (uint32_t i = 0; i < RING_CAPACITY; i++)
+  {
+    CHECK(spscRingPop(&ring, &element) && element.sequence == i, "element %u popped out of order", i);
+  }
+  fill(&element, 1234);
+  CHECK(!spscRingPop(&ring, &element) && element.sequence == 1234, "an empty ring popped an element");
+}
+
+int main(void)
+{
+  testFullAndEmpty();
+  testStress(sizeof(small_element_t));
+  testStress(sizeof(large_element_t));
+
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,414 @@
+/*******************************************************************************
+  @file     test_timer.c
+  @brief    Host simulation of the timer driver on a simulated clock. Random
+            starts, pauses, resumes and restarts of every timer are made from
+            the main loop and from the callbacks, which run with interrupts
+            enabled like a higher priority interrupt would. Checks that every
+            timer expires exactly at its tick, once, and that no callback is
+            ever called with the interrupts masked. test_timer_tickless.c runs
+            the same simulation in the tickless mode, where ticks also elapse
+            inside the critical sections of the driver, so the compare is
+            found pending, is reached while being programmed, and the interrupt
+            is taken late. The LPTMR counter wraps around many times.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+
+// The driver names its timer type like the POSIX one declared by the C library
+#define timer_t   driver_timer_t
+#include "drivers/HAL/timer/timer.c"
+#undef timer_t
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TIMER_COUNT         (TIMERS_MAX_CANT - 1)   // The first one is internal
+#define STEPS               (200000)
+#define MAX_TICKS           (60)
+#define OPERATION_PERCENT   (10)                    // Steps with an operation from the main loop
+#define NESTED_PERCENT      (20)                    // Callbacks making an operation on another timer
+#define INJECT_PERCENT      (25)                    // Lptmr accesses during which a tick elapses
+#define MAX_LATE            (2)                     // Ticks an expiration is delayed by the interrupt taken late
+#define WORK_QUEUE_LENGTH   (64)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Simulated clock and timer interrupt
+static uint32_t         now;
+static void             (*timerIsr)(void);
+static bool             timerIrqPending;
+static bool             inTimerIrq;
+
+// Simulated LPTMR, the counter runs freely and the compare interrupts when it is reached
+static uint16_t         lptmrCounter;
+static uint16_t         lptmrCompare;
+static bool             lptmrEnabled;
+static bool             lptmrFlag;
+static uint32_t         latchedNow;         // Tick of the last read of the counter
+static bool             irqEntry;           // The interrupt has not read the counter yet
+static uint32_t         listNow;            // Tick of the timer expiring, where the list is during its callback
+
+// Simulated work queue
+static work_callback_t  workQueue[WORK_QUEUE_LENGTH];
+static uint32_t         workQueued;
+
+// Expected state of each timer, expectedTick is 0 when it is not running
+static tim_id_t         ids[TIMER_COUNT];
+static uint32_t         expectedTick[TIMER_COUNT];
+static uint32_t         periods[TIMER_COUNT];
+static bool             periodic[TIMER_COUNT];
+
+// Results
+static uint32_t         fires;
+static uint32_t         wrongFires;
+static uint32_t         overdue;
+static uint32_t         lateFires;
+static uint32_t         maskedCallbacks;
+static uint32_t         pendingTaken;
+static uint32_t         raised;
+
+// Change made by the operation in progress, applied to the expected state when the driver makes it
+typedef enum { CHANGE_NONE, CHANGE_START, CHANGE_PAUSE, CHANGE_RESUME, CHANGE_RESTART } change_t;
+
+static change_t         change;
+static uint32_t         changeIndex;
+static uint32_t         changeTicks;
+static bool             changePeriodic;
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+static const tim_callback_t callbacks[TIMER_COUNT];
+
+static void clockTick(void);
+static void changeMade(void);
+static void timerFired(uint32_t index);
+
+bool systickInit(void (*callback)(void))
+{
+  timerIsr = callback;
+  return true;
+}
+
+void lptmrInit(lptmr_callback_t callback)
+{
+  timerIsr = callback;
+}
+
+// A tick may elapse while the driver accesses the LPTMR, always before the access
+static void lptmrMaybeTick(void)
+{
+  if (hostPrimask && !timerIrqPending && (rand() % 100 < INJECT_PERCENT))
+  {
+    clockTick();
+  }
+}
+
+// The driver accounts the ticks up to the count it reads, the changes it makes start from there.
+// A tick before the interrupt reads it would only be the latency of the interrupt
+uint16_t lptmrCount(void)
+{
+  if (!irqEntry)
+  {
+    lptmrMaybeTick();
+  }
+  irqEntry = false;
+  latchedNow = now;
+  return lptmrCounter;
+}
+
+void lptmrSetCompare(uint16_t count)
+{
+  // The change was made after the ticks elapsed while catching up
+  changeMade();
+  lptmrMaybeTick();
+  lptmrCompare = count;
+  lptmrEnabled = true;
+  lptmrFlag = false;
+  timerIrqPending = false;
+}
+
+void lptmrCancel(void)
+{
+  changeMade();
+  lptmrMaybeTick();
+  lptmrEnabled = false;
+  lptmrFlag = false;
+  timerIrqPending = false;
+}
+
+static void raiseTimerIrq(void);
+
+void lptmrRaise(void)
+{
+  raised++;
+  raiseTimerIrq();
+}
+
+void workQueueInit(void)
+{
+}
+
+bool workQueuePost(work_callback_t work)
+{
+  // The timer expired now, its callback runs later from the main loop
+  for (uint32_t i = 0; i < TIMER_COUNT; i++)
+  {
+    if (work == callbacks[i])
+    {
+      timerFired(i);
+    }
+  }
+  workQueue[workQueued++ % WORK_QUEUE_LENGTH] = work;
+  return true;
+}
+
+// Interrupt of the timer, the same priority can't preempt itself and is taken afterwards
+static void timerIrq(void)
+{
+  if (inTimerIrq)
+  {
+    timerIrqPending = true;
+    return;
+  }
+  inTimerIrq = true;
+  do
+  {
+    timerIrqPending = false;
+#ifdef TIMER_TICKLESS_MODE
+    lptmrFlag = false;
+    irqEntry = true;
+#endif
+    timerIsr();
+  } while (timerIrqPending);
+  inTimerIrq = false;
+}
+
+static void takePendingIrq(void)
+{
+  if (inTimerIrq)
+  {
+    hostPendingIrq = takePendingIrq;
+  }
+  else if (timerIrqPending)
+  {
+    pendingTaken++;
+    timerIrq();
+  }
+}
+
+static void raiseTimerIrq(void)
+{
+  if (hostPrimask || inTimerIrq)
+  {
+    timerIrqPending = true;
+    hostPendingIrq = takePendingIrq;
+  }
+  else
+  {
+    timerIrq();
+  }
+}
+
+static void clockTick(void)
+{
+  now++;
+#ifdef TIMER_TICKLESS_MODE
+  if ((++lptmrCounter == lptmrCompare) && lptmrEnabled)
+  {
+    lptmrFlag = true;
+    raiseTimerIrq();
+  }
+#else
+  raiseTimerIrq();
+#endif
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static uint32_t ticksOf(uint32_t ticks)
+{
+  return ticks ? ticks : 1;
+}
+
+static void changeMade(void)
+{
+  uint32_t index = changeIndex;
+#ifdef TIMER_TICKLESS_MODE
+  uint32_t now = inTimerIrq ? listNow : latchedNow;
+#endif
+
+  switch (change)
+  {
+    case CHANGE_START:
+      periods[index] = changeTicks;
+      periodic[index] = changePeriodic;
+      expectedTick[index] = now + ticksOf(changeTicks);
+      break;
+    case CHANGE_PAUSE:
+      expectedTick[index] = 0;
+      break;
+    case CHANGE_RESUME:
+    case CHANGE_RESTART:
+      // A timer never started has no callback, its expiration is not seen
+      if (periods[index] != UINT32_MAX && (change == CHANGE_RESTART || !expectedTick[index]))
+      {
+        expectedTick[index] = now + ticksOf(periods[index]);
+      }
+      break;
+    default:
+      break;
+  }
+  change = CHANGE_NONE;
+}
+
+// Operations made on the driver. From the main loop, the change is made after the driver catches
+// up with the ticks elapsed, and a timer may expire before it. From a callback of the interrupt
+// there is nothing to catch up and the LPTMR is programmed after the callback, so the change is
+// made when the operation returns. When tickless, the change starts from the last count read,
+// the ticks elapsed afterwards are accounted later
+static void operate(uint32_t index)
+{
+  changeIndex = index;
+  changeTicks = rand() % MAX_TICKS;
+  changePeriodic = rand() % 2;
+
+  switch (rand() % 5)
+  {
+    case 0:
+    case 1:
+      change = CHANGE_START;
+      if (rand() % 2)
+      {
+        timerStart(ids[index], changeTicks, changePeriodic ? TIM_MODE_PERIODIC : TIM_MODE_SINGLESHOT, callbacks[index]);
+      }
+      else
+      {
+        timerStartDeferred(ids[index], changeTicks, changePeriodic ? TIM_MODE_PERIODIC : TIM_MODE_SINGLESHOT, callbacks[index]);
+      }
+      break;
+    case 2:
+      change = CHANGE_PAUSE;
+      timerPause(ids[index]);
+      break;
+    case 3:
+      change = CHANGE_RESUME;
+      timerResume(ids[index]);
+      break;
+    default:
+      change = CHANGE_RESTART;
+      timerRestart(ids[index]);
+      break;
+  }
+  changeMade();
+}
+
+// Expiration of a timer, seen by its callback or by the post of its callback. When tickless, the
+// interrupt may be taken some ticks late, the timers expire from their tick all the same
+static void timerFired(uint32_t index)
+{
+  fires++;
+  lateFires += expectedTick[index] < now;
+  wrongFires += (expectedTick[index] > now) || (expectedTick[index] + MAX_LATE < now);
+  listNow = expectedTick[index];
+  if (expectedTick[index] && periodic[index])
+  {
+    expectedTick[index] += ticksOf(periods[index]);
+  }
+  else
+  {
+    expectedTick[index] = 0;
+  }
+}
+
+static void callback(uint32_t index, bool deferred)
+{
+  maskedCallbacks += hostPrimask != 0;
+  if (!deferred)
+  {
+    timerFired(index);
+  }
+
+  // An interrupt changing another timer while the timer interrupt runs
+  if (rand() % 100 < NESTED_PERCENT)
+  {
+    operate(rand() % TIMER_COUNT);
+  }
+}
+
+// Only the callbacks called from the interrupt see their expiration, the others were posted
+#define TIMER_CALLBACK(n) static void callback##n(void) { callback(n, !inTimerIrq); }
+TIMER_CALLBACK(0)  TIMER_CALLBACK(1)  TIMER_CALLBACK(2)  TIMER_CALLBACK(3)  TIMER_CALLBACK(4)
+TIMER_CALLBACK(5)  TIMER_CALLBACK(6)  TIMER_CALLBACK(7)  TIMER_CALLBACK(8)  TIMER_CALLBACK(9)
+TIMER_CALLBACK(10) TIMER_CALLBACK(11) TIMER_CALLBACK(12) TIMER_CALLBACK(13) TIMER_CALLBACK(14)
+
+static const tim_callback_t callbacks[TIMER_COUNT] = {
+  callback0, callback1, callback2,  callback3,  callback4,  callback5,  callback6, callback7,
+  callback8, callback9, callback10, callback11, callback12, callback13, callback14
+};
+
+static void drainWorkQueue(void)
+{
+  for (uint32_t i = 0; i < workQueued; i++)
+  {
+    workQueue[i % WORK_QUEUE_LENGTH]();
+  }
+  workQueued = 0;
+}
+
+static void testRandomOperations(void)
+{
+  timerInit();
+  for (uint32_t i = 0; i < TIMER_COUNT; i++)
+  {
+    ids[i] = timerGetId();
+    periods[i] = UINT32_MAX;
+  }
+  CHECK(ids[TIMER_COUNT - 1] != TIMER_INVALID_ID, "only %u timers available", TIMER_COUNT);
+
+  for (uint32_t step = 0; step < STEPS; step++)
+  {
+    if (rand() % 100 < OPERATION_PERCENT)
+    {
+      operate(rand() % TIMER_COUNT);
+      drainWorkQueue();
+    }
+    clockTick();
+    drainWorkQueue();
+
+    for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    {
+      overdue += expectedTick[i] && expectedTick[i] <= now;
+    }
+  }
+
+  printf("  %u expirations in %u ticks, %u late, %u interrupts taken late, %u raised for a compare reached while programmed\n",
+         fires, now, lateFires, pendingTaken, raised);
+  CHECK(fires > STEPS / 10, "only %u expirations", fires);
+  CHECK(wrongFires == 0, "%u expirations out of their tick", wrongFires);
+#ifndef TIMER_TICKLESS_MODE
+  CHECK(lateFires == 0, "%u expirations late on the tick interrupt", lateFires);
+#endif
+  CHECK(overdue == 0, "%u ticks with a timer overdue", overdue);
+  CHECK(maskedCallbacks == 0, "%u callbacks called with the interrupts masked", maskedCallbacks);
+  CHECK(workQueued == 0 && hostPrimask == 0, "interrupts left masked");
+}
+
+int main(void)
+{
+  srand(1);
+  testRandomOperations();
+
+  return HOST_TEST_RESULT();
+}
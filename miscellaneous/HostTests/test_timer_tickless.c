@@ -0,0 +1,10 @@
+/*******************************************************************************
+  @file     test_timer_tickless.c
+  @brief    Host simulation of the timer driver in the tickless mode, see
+            test_timer.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#define TIMER_TICKLESS_MODE
+
+#include "test_timer.c"
@@ -0,0 +1,118 @@
+/*******************************************************************************
+  @file     test_triple_buffer.c
+  @brief    Host stress test of the lock-free triple buffer. A writer thread
+            publishes numbered buffers as fast as it can while the reader
+            acquires them, and the reader checks it never sees a torn buffer,
+            never goes back to older data, and ends with the last one published.
+  @sources  lib/triple_buffer/triple_buffer.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "lib/triple_buffer/triple_buffer.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define BUFFER_SIZE       (64)
+#define PUBLISH_COUNT     (2000000)
+#define YIELD_PERIOD      (16)            // Publishes between yields of the writer
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static uint32_t         buffers[3][BUFFER_SIZE];
+static triple_buffer_t  tb;
+static volatile bool    writerDone;
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+// Fills every buffer with its sequence number, starting at 1
+static void* writer(void* arg)
+{
+  for (uint32_t sequence = 1; sequence <= PUBLISH_COUNT; sequence++)
+  {
+    uint32_t* buffer = tripleBufferWriteBuffer(&tb);
+    for (uint32_t i = 0; i < BUFFER_SIZE; i++)
+    {
+      buffer[i] = sequence;
+    }
+    tripleBufferPublish(&tb);
+
+    // Let the reader in now and then, so the swaps interleave in every order
+    if ((sequence % YIELD_PERIOD) == 0)
+    {
+      sched_yield();
+    }
+  }
+  __atomic_store_n(&writerDone, true, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void testConcurrent(void)
+{
+  uint32_t last = 0, acquired = 0, torn = 0, older = 0;
+  bool done = false;
+  pthread_t thread;
+
+  tb = createTripleBuffer(buffers[0], buffers[1], buffers[2]);
+  CHECK(!tripleBufferAcquire(&tb), "acquired data before anything was published");
+  pthread_create(&thread, NULL, writer, NULL);
+
+  // Once the writer is done, one more acquire takes whatever it published last
+  while (!done)
+  {
+    done = __atomic_load_n(&writerDone, __ATOMIC_ACQUIRE);
+    while (tripleBufferAcquire(&tb))
+    {
+      const uint32_t* buffer = tripleBufferReadBuffer(&tb);
+      for (uint32_t i = 1; i < BUFFER_SIZE; i++)
+      {
+        torn += buffer[i] != buffer[0];
+      }
+      older += buffer[0] <= last;
+      last = buffer[0];
+      acquired++;
+    }
+  }
+  pthread_join(thread, NULL);
+
+  printf("  %u buffers published, %u acquired\n", PUBLISH_COUNT, acquired);
+  CHECK(torn == 0, "%u torn samples read", torn);
+  CHECK(older == 0, "%u buffers not newer than the previous one", older);
+  CHECK(last == PUBLISH_COUNT, "last buffer acquired is %u, not %u", last, PUBLISH_COUNT);
+  CHECK(!tripleBufferAcquire(&tb), "acquired the same data twice");
+}
+
+// Without a reader, the writer keeps overwriting and the reader then only gets the latest
+static void testOverwrite(void)
+{
+  tb = createTripleBuffer(buffers[0], buffers[1], buffers[2]);
+  for (uint32_t sequence = 1; sequence <= 5; sequence++)
+  {
+    uint32_t* buffer = tripleBufferWriteBuffer(&tb);
+    buffer[0] = sequence;
+    tripleBufferPublish(&tb);
+  }
+  CHECK(tripleBufferAcquire(&tb), "nothing to acquire after publishing");
+  CHECK(((uint32_t*)tripleBufferReadBuffer(&tb))[0] == 5, "read %u instead of the latest", ((uint32_t*)tripleBufferReadBuffer(&tb))[0]);
+  CHECK(!tripleBufferAcquire(&tb), "acquired again without a new publish");
+  CHECK(tripleBufferWriteBuffer(&tb) != tripleBufferReadBuffer(&tb), "writer and reader share a buffer");
+}
+
+int main(void)
+{
+  testOverwrite();
+  testConcurrent();
+
+  return HOST_TEST_RESULT();
+}
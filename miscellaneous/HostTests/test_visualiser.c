@@ -0,0 +1,205 @@
+/*******************************************************************************
+  @file     test_visualiser.c
+  @brief    Host simulation of the visualiser scheduling. The audio path feeds a
+            frame every 4096 samples and the frame timer fires every display
+            period, on a simulated clock, while the main loop runs the
+            visualiser only when it is idle. Checks that frames are drawn at the
+            display rate, that frames due while the CPU is busy are skipped
+            rather than queued, that the latest snapshot is the one drawn, that
+            feeding never does the analysis or the drawing, and that the bars
+            fall once the audio stops.
+  @sources  lib/triple_buffer/triple_buffer.c lib/vumeter/vumeter.c
+  @sources  drivers/MCAL/spectrum/spectrum.c drivers/MCAL/cfft/cfft.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "visualiser/visualiser.c"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SAMPLE_RATE         (44100.0)
+#define AUDIO_FRAME_SIZE    (4096)
+#define AUDIO_FRAME_MS      (AUDIO_FRAME_SIZE * 1000.0 / SAMPLE_RATE)
+#define CHANNEL_COUNT       (2)
+#define BAND_BIN_HZ         (SAMPLE_RATE / SPECTRUM_DECIMATION / SPECTRUM_SNAPSHOT_SIZE)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Geometric centre of each band of the spectrum analyser, in bins
+static const double BAND_CENTRE_BINS[SPECTRUM_BAND_COUNT] = {
+  1.41, 2.83, 5.66, 11.3, 22.6, 45.3, 90.5, 150.1
+};
+
+// Simulated hardware
+static tim_callback_t frameCallback;
+static ttick_t        framePeriod;
+static uint32_t       flips;
+static bool           feeding;
+static uint32_t       flipsWhileFeeding;
+
+// Simulated time line
+static int16_t        audioFrame[AUDIO_FRAME_SIZE * CHANNEL_COUNT];
+static uint32_t       audioFrames;
+static double         nextAudioMs;
+static double         nextFrameMs;
+static double         nowMs;
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+void timerInit(void)
+{
+}
+
+tim_id_t timerGetId(void)
+{
+  return 0;
+}
+
+void timerStart(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback)
+{
+  frameCallback = callback;
+  framePeriod = ticks;
+}
+
+void displayFlip(ws2812_pixel_t* buffer)
+{
+  flips++;
+  flipsWhileFeeding += feeding;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+// Audio frames cycle through the bands, so the band drawn tells which frame it came from
+static uint32_t frameBand(uint32_t frame)
+{
+  return frame % SPECTRUM_BAND_COUNT;
+}
+
+static void feedAudioFrame(void)
+{
+  double frequency = BAND_CENTRE_BINS[frameBand(audioFrames)] * BAND_BIN_HZ;
+
+  for (uint32_t n = 0; n < AUDIO_FRAME_SIZE; n++)
+  {
+    int16_t sample = (int16_t)lrint(0.5 * 32767.0 * sin(2.0 * M_PI * frequency * n / SAMPLE_RATE));
+    audioFrame[CHANNEL_COUNT * n] = sample;
+    audioFrame[CHANNEL_COUNT * n + 1] = sample;
+  }
+  feeding = true;
+  visualiserFeed(audioFrame, AUDIO_FRAME_SIZE, CHANNEL_COUNT);
+  feeding = false;
+  audioFrames++;
+}
+
+static uint32_t loudestBand(void)
+{
+  uint32_t loudest = 0;
+  for (uint32_t band = 1; band < SPECTRUM_BAND_COUNT; band++)
+  {
+    loudest = context.bands[band] > context.bands[loudest] ? band : loudest;
+  }
+  return loudest;
+}
+
+// Advances the simulated clock, firing the audio and the frame timer events in order.
+// The main loop runs the visualiser after each event, unless the CPU is busy.
+static void simulate(double durationMs, bool audio, bool busy)
+{
+  double endMs = nowMs + durationMs;
+
+  while (true)
+  {
+    double nextMs = audio && nextAudioMs < nextFrameMs ? nextAudioMs : nextFrameMs;
+    if (nextMs > endMs)
+    {
+      break;
+    }
+    nowMs = nextMs;
+    if (audio && nowMs == nextAudioMs)
+    {
+      feedAudioFrame();
+      nextAudioMs += AUDIO_FRAME_MS;
+    }
+    else
+    {
+      frameCallback();
+      nextFrameMs += framePeriod * TIMER_TICK_MS;
+    }
+
+    while (!busy && visualiserRun());
+  }
+  nowMs = endMs;
+  if (!audio)
+  {
+    nextAudioMs = nowMs;
+  }
+}
+
+// Frames are drawn at the display rate, whatever the audio frame rate
+static void testDisplayRate(void)
+{
+  uint32_t startFlips = flips;
+
+  simulate(2000.0, true, false);
+  CHECK(TIMER_MS2TICKS(VISUALISER_FPS_MS) * TIMER_TICK_MS == VISUALISER_FPS_MS, "frame period %u ticks", framePeriod);
+  CHECK(flips - startFlips == 2000 / VISUALISER_FPS_MS, "%u frames drawn in 2s, expected %u", flips - startFlips, 2000 / VISUALISER_FPS_MS);
+  CHECK(flipsWhileFeeding == 0, "%u frames drawn from the audio path", flipsWhileFeeding);
+  CHECK(loudestBand() == frameBand(audioFrames - 1), "band %u drawn, the last audio frame is in band %u", loudestBand(), frameBand(audioFrames - 1));
+}
+
+// Frames due while the CPU is busy are skipped, and the next one draws the latest snapshot
+static void testBusy(void)
+{
+  uint32_t startFlips, startFrames;
+  uint32_t bands[SPECTRUM_BAND_COUNT];
+
+  memcpy(bands, context.bands, sizeof(bands));
+  startFlips = flips;
+  startFrames = audioFrames;
+  simulate(500.0, true, true);
+  CHECK(flips == startFlips, "%u frames drawn while busy", flips - startFlips);
+  CHECK(audioFrames - startFrames >= 5, "only %u audio frames fed while busy", audioFrames - startFrames);
+  CHECK(memcmp(bands, context.bands, sizeof(bands)) == 0, "the bands were analysed from the audio path");
+
+  // The frames missed are not drawn in a burst afterwards
+  while (visualiserRun());
+  CHECK(flips == startFlips + 1, "%u frames drawn when the CPU got idle, expected 1", flips - startFlips);
+  CHECK(loudestBand() == frameBand(audioFrames - 1), "band %u drawn, the last audio frame is in band %u", loudestBand(), frameBand(audioFrames - 1));
+}
+
+// Once the audio stops, the last bands are kept for a few frames and then cleared
+static void testStale(void)
+{
+  simulate(VISUALISER_FPS_MS * (VISUALISER_STALE_FRAMES + 0.5), false, false);
+  CHECK(context.bands[loudestBand()] > 0, "bands cleared before %u frames without audio", VISUALISER_STALE_FRAMES);
+  simulate(VISUALISER_FPS_MS, false, false);
+  CHECK(context.bands[loudestBand()] == 0, "bands still up after %u frames without audio", VISUALISER_STALE_FRAMES + 1);
+}
+
+int main(void)
+{
+  visualiserInit();
+  CHECK(frameCallback != NULL, "the frame timer was not started");
+  nextAudioMs = 0.0;
+  nextFrameMs = VISUALISER_FPS_MS;
+
+  testDisplayRate();
+  testBusy();
+  testStale();
+
+  printf("  %u audio frames fed, %u display frames drawn\n", audioFrames, flips);
+  return HOST_TEST_RESULT();
+}
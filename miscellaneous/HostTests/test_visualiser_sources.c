@@ -0,0 +1,163 @@
+/*******************************************************************************
+  @file     test_visualiser_sources.c
+  @brief    Host comparison of the two sources of the visualiser, the spectrum
+            analyser and the octave filter bank. Checks that a tone lands in the
+            same column at a similar level with either one, and compares the
+            cost of each per audio frame, as the visualiser runs them: the FFT
+            source decimates the whole frame and analyses 512 samples, the
+            filter bank analyses the last 1024 samples of the frame. The kernels
+            are the plain C references of stub/, so the times only compare the
+            sources on the same host; the operation counts are what carries over
+            to the Cortex-M4.
+  @sources  drivers/MCAL/spectrum/spectrum.c drivers/MCAL/cfft/cfft.c
+  @sources  drivers/MCAL/filterbank/filterbank.c lib/vumeter/vumeter.c
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/MCAL/spectrum/spectrum.h"
+#include "drivers/MCAL/filterbank/filterbank.h"
+#include "lib/vumeter/vumeter.h"
+
+#include <time.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SAMPLE_RATE           (44100.0)
+#define FRAME_SIZE            (4096)          // Samples of an audio frame fed to the visualiser
+#define FILTERBANK_SIZE       (1024)          // Samples of a frame analysed by the filter bank
+#define HALF_BAND_TAPS        (19)            // Of the spectrum decimator
+#define BAND_COUNT            (8)
+#define LEVEL_TOLERANCE       (4)             // Levels, 3dB, the sources may differ by
+#define TIMING_SECONDS        (0.2)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Edges of the bands of both sources, 43Hz bins of the spectrum analyser
+static const double BAND_EDGES_HZ[BAND_COUNT + 1] = {
+  43.07, 86.13, 172.27, 344.53, 689.06, 1378.13, 2756.25, 5512.50, 7579.69
+};
+
+static int16_t   samples[FRAME_SIZE];
+static q15_t     snapshot[FILTERBANK_SIZE];
+static uint32_t  fftBands[BAND_COUNT];
+static uint32_t  bankBands[BAND_COUNT];
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void tone(double frequency, double amplitude, uint32_t offset)
+{
+  for (uint32_t n = 0; n < FRAME_SIZE; n++)
+  {
+    samples[n] = (int16_t)lrint(amplitude * 32767.0 * sin(2.0 * M_PI * frequency * (offset + n) / SAMPLE_RATE));
+  }
+}
+
+// One audio frame through the FFT source, as visualiserFeed and visualiserAnalyse run it
+static void runFft(void)
+{
+  spectrumFeed(samples, FRAME_SIZE, 1);
+  spectrumGetSnapshot(snapshot);
+  spectrumAnalyse(snapshot, fftBands);
+}
+
+// One audio frame through the filter bank source, the last samples are copied and analysed
+static void runFilterBank(void)
+{
+  for (uint32_t n = 0; n < FILTERBANK_SIZE; n++)
+  {
+    snapshot[n] = samples[FRAME_SIZE - FILTERBANK_SIZE + n];
+  }
+  filterbankAnalyse(snapshot, FILTERBANK_SIZE, bankBands);
+}
+
+static uint32_t loudest(const uint32_t* bands)
+{
+  uint32_t band = 0;
+  for (uint32_t i = 1; i < BAND_COUNT; i++)
+  {
+    band = bands[i] > bands[band] ? i : band;
+  }
+  return band;
+}
+
+static double secondsNow(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// A tone at the centre of each band shows in the same column at about the same level
+static void testSameBands(void)
+{
+  for (uint32_t band = 0; band < BAND_COUNT; band++)
+  {
+    double frequency = sqrt(BAND_EDGES_HZ[band] * BAND_EDGES_HZ[band + 1]);
+    uint8_t fftLevel, bankLevel;
+
+    // Two frames, so the filters and the history start from the tone
+    for (uint32_t frame = 0; frame < 2; frame++)
+    {
+      tone(frequency, 0.5, frame * FRAME_SIZE);
+      runFft();
+      runFilterBank();
+    }
+    fftLevel = vumeterPowerToLevel(fftBands[band]);
+    bankLevel = vumeterPowerToLevel(bankBands[band]);
+
+    CHECK(loudest(fftBands) == band, "fft: %.0fHz tone in band %u instead of %u", frequency, loudest(fftBands), band);
+    CHECK(loudest(bankBands) == band, "filter bank: %.0fHz tone in band %u instead of %u", frequency, loudest(bankBands), band);
+    CHECK(abs((int)fftLevel - (int)bankLevel) <= LEVEL_TOLERANCE, "%.0fHz tone at level %u with the fft, %u with the filter bank", frequency, fftLevel, bankLevel);
+    printf("  band %u: %5.0fHz tone at level %2u with the fft, %2u with the filter bank\n", band, frequency, fftLevel, bankLevel);
+  }
+}
+
+// Time and operations per audio frame of each source
+static void compareCost(void)
+{
+  const double fftMacs = (FRAME_SIZE / SPECTRUM_DECIMATION) * HALF_BAND_TAPS      // Decimator
+                       + SPECTRUM_SNAPSHOT_SIZE                                    // Window
+                       + 2.0 * SPECTRUM_SNAPSHOT_SIZE * log2(SPECTRUM_SNAPSHOT_SIZE); // Real FFT, complex MACs as 2
+  const double bankMacs = FILTERBANK_SIZE * FILTERBANK_BAND_COUNT * (5 + 1);      // Biquad and power
+  double start, fftSeconds, bankSeconds;
+  uint32_t frames;
+
+  tone(1000.0, 0.5, 0);
+
+  start = secondsNow();
+  for (frames = 0; secondsNow() - start < TIMING_SECONDS; frames++)
+  {
+    runFft();
+  }
+  fftSeconds = (secondsNow() - start) / frames;
+
+  start = secondsNow();
+  for (frames = 0; secondsNow() - start < TIMING_SECONDS; frames++)
+  {
+    runFilterBank();
+  }
+  bankSeconds = (secondsNow() - start) / frames;
+
+  printf("  fft:         %7.1f us per frame, about %6.0f MACs, q15\n", fftSeconds * 1e6, fftMacs);
+  printf("  filter bank: %7.1f us per frame, about %6.0f MACs, f32\n", bankSeconds * 1e6, bankMacs);
+}
+
+int main(void)
+{
+  spectrumInit();
+  filterbankInit();
+
+  testSameBands();
+  compareCost();
+
+  return HOST_TEST_RESULT();
+}
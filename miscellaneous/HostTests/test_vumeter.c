@@ -0,0 +1,195 @@
+/*******************************************************************************
+  @file     test_vumeter.c
+  @brief    Host test of the vumeter library. Checks the smoothing and peak hold
+            of the column levels, shared by both sources of the visualiser, the
+            tables of a matrix without rows or columns, and the linear bars
+            against the double precision mapping they replaced. Also times the
+            bar drawing of both; the host runs the old doubles in hardware, the
+            Cortex-M4 FPU is single precision and runs them in software.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "lib/vumeter/vumeter.c"
+
+#include <time.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define RANDOM_VALUES     (100000)
+#define TIMING_SECONDS    (0.2)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static vumeter_t vumeter;
+static pixel_t   matrix[VUMETER_MAX_ROWS * VUMETER_MAX_COLS];
+static pixel_t   expected[VUMETER_MAX_ROWS * VUMETER_MAX_COLS];
+
+static const vumeter_modes_t graphicModes[] = { BAR_MODE, CENTRE_MODE, DOT_MODE, MIRRORED_MODE, WATERFALL_MODE };
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+// The levels rise fast and fall slowly, and the peak is held before it falls
+static void testSmoothing(void)
+{
+  uint32_t silence[VUMETER_MAX_COLS] = { 0 };
+  uint32_t loud[VUMETER_MAX_COLS];
+  vumeter_level_t levels[VUMETER_MAX_COLS];
+  uint8_t top, frames;
+
+  vumeterInit(&vumeter, VUMETER_MAX_ROWS, VUMETER_MAX_COLS, UINT32_MAX, 0);
+  for (uint32_t col = 0; col < VUMETER_MAX_COLS; col++)
+  {
+    loud[col] = UINT32_MAX;
+  }
+
+  // Attack, three quarters of the way per frame
+  for (frames = 0; frames < 20; frames++)
+  {
+    vumeterUpdateLevels(&vumeter, loud, levels);
+    if (levels[0].level == VUMETER_LEVEL_MAX)
+    {
+      break;
+    }
+  }
+  CHECK(frames <= 5, "took %u frames to reach full scale", frames);
+  top = levels[0].peak;
+
+  // Release, with the peak held
+  for (frames = 0; frames < PEAK_HOLD; frames++)
+  {
+    vumeterUpdateLevels(&vumeter, silence, levels);
+    CHECK(levels[0].peak == top, "peak fell after %u frames, held for %u", frames + 1, PEAK_HOLD);
+  }
+  CHECK(levels[0].level > 0 && levels[0].level < top, "level %u after the hold, should be falling", levels[0].level);
+  vumeterUpdateLevels(&vumeter, silence, levels);
+  CHECK(levels[0].peak == top - PEAK_FALL || levels[0].peak == levels[0].level, "peak %u after the hold", levels[0].peak);
+
+  for (frames = 0; frames < 100 && levels[0].peak; frames++)
+  {
+    vumeterUpdateLevels(&vumeter, silence, levels);
+  }
+  CHECK(levels[0].level == 0 && levels[0].peak == 0, "level %u, peak %u after a long silence", levels[0].level, levels[0].peak);
+
+  // Initialising again clears the smoothing
+  vumeterUpdateLevels(&vumeter, loud, levels);
+  vumeterInit(&vumeter, VUMETER_MAX_ROWS, VUMETER_MAX_COLS, UINT32_MAX, 0);
+  vumeterUpdateLevels(&vumeter, silence, levels);
+  CHECK(levels[0].level == 0 && levels[0].peak == 0, "level %u, peak %u after initialising again", levels[0].level, levels[0].peak);
+}
+
+// Rows of a bar with the old mapping, in double precision, rounded to the nearest row
+static uint8_t referenceRows(uint32_t value, uint32_t fullScale, uint8_t rows)
+{
+  int height = (int)((float)value / (double)fullScale * rows + 0.5);
+  return height > rows ? rows : height;
+}
+
+// The old bar drawing, over a matrix cleared by the caller
+static void referenceDraw(pixel_t* matrix, const uint32_t* values, uint32_t fullScale)
+{
+  memset(matrix, 0, sizeof(expected));
+  for (uint8_t j = 0; j < VUMETER_MAX_COLS; j++)
+  {
+    uint8_t height = referenceRows(values[j], fullScale, VUMETER_MAX_ROWS);
+    for (uint8_t i = 0; i < height; i++)
+    {
+      matrix[i * VUMETER_MAX_COLS + j] = vumeterPixelColours[i];
+    }
+  }
+}
+
+static double secondsNow(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Without rows or columns the vumeter is a single pixel, every mode builds its tables and draws
+static void testEmptyMatrix(void)
+{
+  uint32_t values[VUMETER_MAX_COLS] = { UINT32_MAX };
+
+  for (uint32_t mode = 0; mode < sizeof(graphicModes) / sizeof(graphicModes[0]); mode++)
+  {
+    for (uint32_t scale = 0; scale < 2; scale++)
+    {
+      vumeter_modes_t scaleMode = scale ? LOGARITHMIC_MODE : LINEAR_MODE;
+      vumeterInit(&vumeter, 0, 0, UINT32_MAX, graphicModes[mode] | scaleMode);
+      CHECK(vumeter.rows == 1 && vumeter.cols == 1, "mode %#x: %u x %u matrix", graphicModes[mode] | scaleMode, vumeter.rows, vumeter.cols);
+      vumeterDraw(&vumeter, matrix, values);
+    }
+  }
+  vumeterInit(&vumeter, 0, 0, UINT32_MAX, BAR_MODE | LINEAR_MODE);
+  vumeterDraw(&vumeter, matrix, values);
+  CHECK(vumeterValueToRows(&vumeter, UINT32_MAX) == 1 && matrix[0].r, "full scale does not light the single pixel");
+}
+
+// Linear bars light the same rows as the old mapping, and cost per frame of both
+static void testLinearBars(void)
+{
+  static const uint32_t fullScales[] = { 64, 1000, 1000000, UINT32_MAX };
+  uint32_t values[VUMETER_MAX_COLS];
+  uint32_t mismatches = 0, frames;
+  double start, newSeconds, oldSeconds;
+
+  for (uint32_t scale = 0; scale < sizeof(fullScales) / sizeof(fullScales[0]); scale++)
+  {
+    for (uint8_t rows = 1; rows <= VUMETER_MAX_ROWS; rows++)
+    {
+      vumeterInit(&vumeter, rows, VUMETER_MAX_COLS, fullScales[scale], BAR_MODE | LINEAR_MODE);
+      for (uint32_t n = 0; n < RANDOM_VALUES / VUMETER_MAX_ROWS; n++)
+      {
+        uint32_t value = (uint32_t)(((uint64_t)rand() << 16 ^ rand()) % ((uint64_t)fullScales[scale] + fullScales[scale] / 8 + 1));
+        mismatches += vumeterValueToRows(&vumeter, value) != referenceRows(value, fullScales[scale], rows);
+      }
+    }
+  }
+  CHECK(mismatches == 0, "%u values light other rows than the old mapping", mismatches);
+
+  vumeterInit(&vumeter, VUMETER_MAX_ROWS, VUMETER_MAX_COLS, 64, BAR_MODE | LINEAR_MODE);
+  for (uint32_t j = 0; j < VUMETER_MAX_COLS; j++)
+  {
+    values[j] = rand() % 65;
+  }
+  vumeterDraw(&vumeter, matrix, values);
+  referenceDraw(expected, values, 64);
+  CHECK(memcmp(matrix, expected, sizeof(matrix)) == 0, "bar matrix differs from the old drawing");
+
+  start = secondsNow();
+  for (frames = 0; secondsNow() - start < TIMING_SECONDS; frames++)
+  {
+    values[frames % VUMETER_MAX_COLS] = frames % 65;
+    vumeterDraw(&vumeter, matrix, values);
+  }
+  newSeconds = (secondsNow() - start) / frames;
+
+  start = secondsNow();
+  for (frames = 0; secondsNow() - start < TIMING_SECONDS; frames++)
+  {
+    values[frames % VUMETER_MAX_COLS] = frames % 65;
+    referenceDraw(expected, values, 64);
+  }
+  oldSeconds = (secondsNow() - start) / frames;
+
+  printf("  8 x 8 linear bars: %5.0f ns per frame, 64 integer compares\n", newSeconds * 1e9);
+  printf("  old double mapping: %4.0f ns per frame, 8 double divisions, multiplications and additions\n", oldSeconds * 1e9);
+}
+
+int main(void)
+{
+  testSmoothing();
+  testEmptyMatrix();
+  testLinearBars();
+
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/*******************************************************************************
+  @file     test_work_queue.c
+  @brief    Host test of the work queue on a simulated clock. The works of the
+            display posted by the timers every tick are simulated with their
+            cost, and a task of the main loop measures how long it waits for
+            each call to workQueueRun(). Checks the order and the coalescing of
+            the work, that a call only runs over its budget with a work longer
+            than any before, and compares the wait of the task with the drain of
+            the whole queue it replaced.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/HAL/work_queue/work_queue.c"
+
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TICK_US             (1000)
+#define STEP_US             (10)          // Resolution of the simulated work
+#define SIMULATED_MS        (20000)
+#define TASK_US             (50)          // Other task of the main loop, run between the calls
+#define LONGEST_WORK_US     (900)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Simulated clock, the tick interrupt posts the work due
+static uint64_t     cycles;
+static uint64_t     nextTick;
+static uint32_t     ticks;
+
+// Works run, in order
+static uint32_t     runOrder[64];
+static uint32_t     runCount;
+
+// Work that posts itself again
+static uint32_t     selfPosts;
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED HARDWARE
+ *******************************************************************************
+ ******************************************************************************/
+
+void timebaseInit(void)
+{
+}
+
+uint64_t timeNowCycles(void)
+{
+  return cycles;
+}
+
+static void tickIsr(void);
+
+// The work takes its time, while the tick interrupt keeps posting
+static void spend(uint32_t us)
+{
+  for (uint32_t i = 0; i < us; i += STEP_US)
+  {
+    cycles += TIMEBASE_US2CYCLES(STEP_US);
+    while (cycles >= nextTick)
+    {
+      nextTick += TIMEBASE_US2CYCLES(TICK_US);
+      ticks++;
+      tickIsr();
+    }
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        SIMULATED WORK
+ *******************************************************************************
+ ******************************************************************************/
+
+// Works of the display, with their cost on the board
+#define DISPLAY_WORK(name, costUs) static void name(void) { spend(costUs); }
+DISPLAY_WORK(lcdRotateTop,    LONGEST_WORK_US)
+DISPLAY_WORK(lcdRotateBottom, LONGEST_WORK_US)
+DISPLAY_WORK(lcdFlush,        120)
+DISPLAY_WORK(audioLcd,        450)
+DISPLAY_WORK(uiLcd,           450)
+DISPLAY_WORK(displayFps,      750)
+DISPLAY_WORK(volumeTimeout,   240)
+
+// Periods of the timers posting them
+static const struct {
+  work_callback_t work;
+  uint32_t        periodMs;
+} displayWork[] = {
+  { lcdRotateTop, 350 }, { lcdRotateBottom, 350 }, { lcdFlush, 1 },          { audioLcd, 100 },
+  { uiLcd, 100 },        { displayFps, 20 },       { volumeTimeout, 3000 }
+};
+
+#define DISPLAY_WORK_COUNT  (sizeof(displayWork) / sizeof(displayWork[0]))
+
+static void tickIsr(void)
+{
+  for (uint32_t i = 0; i < DISPLAY_WORK_COUNT; i++)
+  {
+    if (ticks % displayWork[i].periodMs == 0)
+    {
+      workQueuePost(displayWork[i].work);
+    }
+  }
+}
+
+#define ORDERED_WORK(n) static void ordered##n(void) { runOrder[runCount++] = n; }
+ORDERED_WORK(0) ORDERED_WORK(1) ORDERED_WORK(2) ORDERED_WORK(3)
+
+static void selfPosting(void)
+{
+  selfPosts++;
+  workQueuePost(selfPosting);
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void resetQueue(void)
+{
+  memset(&context, 0, sizeof(context));
+  workQueueInit();
+}
+
+// The work runs once, in the order it was first posted
+static void testOrder(void)
+{
+  resetQueue();
+  workQueuePost(ordered2);
+  workQueuePost(ordered0);
+  workQueuePost(ordered2);
+  workQueuePost(ordered1);
+  workQueuePost(ordered3);
+  workQueueRun();
+
+  CHECK(runCount == 4, "%u works run instead of 4", runCount);
+  CHECK(runOrder[0] == 2 && runOrder[1] == 0 && runOrder[2] == 1 && runOrder[3] == 3, "work run out of order");
+  CHECK(workQueueGetStats().coalesced == 1, "the second post of a waiting work was not coalesced");
+}
+
+// A work posting itself leaves the main loop after WORK_QUEUE_RUN_MAX runs
+static void testSelfPosting(void)
+{
+  resetQueue();
+  workQueuePost(selfPosting);
+  workQueueRun();
+  CHECK(selfPosts == WORK_QUEUE_RUN_MAX, "a work posting itself ran %u times in a call", selfPosts);
+  workQueueRun();
+  CHECK(selfPosts == 2 * WORK_QUEUE_RUN_MAX, "a work posting itself did not run again in the next call");
+  CHECK(workQueueGetStats().yielded == 2, "the calls leaving work were not counted");
+}
+
+// Main loop of the display work, returns the longest wait of the other task in microseconds
+static uint64_t runMainLoop(bool (*run)(void), uint64_t* longestCall, uint32_t* overBudget)
+{
+  uint64_t lastTask = 0, longestWait = 0, start;
+  uint32_t longestWork;
+
+  resetQueue();
+  cycles = 0;
+  ticks = 0;
+  nextTick = TIMEBASE_US2CYCLES(TICK_US);
+  *longestCall = 0;
+  *overBudget = 0;
+
+  while (ticks < SIMULATED_MS)
+  {
+    // The other task
+    longestWait = cycles - lastTask > longestWait ? cycles - lastTask : longestWait;
+    spend(TASK_US);
+    lastTask = cycles;
+
+    // The work queue, or the idle wait of the next tick
+    start = cycles;
+    longestWork = context.stats.longestWork;
+    if (!run())
+    {
+      spend(STEP_US);
+    }
+    *overBudget += (cycles - start > TIMEBASE_US2CYCLES(WORK_QUEUE_RUN_US)) && (context.stats.longestWork == longestWork);
+    *longestCall = cycles - start > *longestCall ? cycles - start : *longestCall;
+  }
+
+  *longestCall = TIMEBASE_CYCLES2US(*longestCall);
+  return TIMEBASE_CYCLES2US(longestWait);
+}
+
+// The drain of the whole queue, including the work posted while draining
+static bool drainAll(void)
+{
+  return workQueueDrain(UINT32_MAX, UINT64_MAX);
+}
+
+// The other tasks of the main loop wait at most the budget of the work queue
+static void testBudget(void)
+{
+  uint64_t boundedCall, unboundedCall, boundedWait, unboundedWait;
+  uint32_t overBudget, unboundedOverBudget;
+  work_queue_stats_t stats;
+
+  unboundedWait = runMainLoop(drainAll, &unboundedCall, &unboundedOverBudget);
+  boundedWait = runMainLoop(workQueueRun, &boundedCall, &overBudget);
+  stats = workQueueGetStats();
+
+  printf("  longest call %llu us, task waits %llu us, draining the whole queue %llu us and %llu us\n",
+         (unsigned long long)boundedCall, (unsigned long long)boundedWait,
+         (unsigned long long)unboundedCall, (unsigned long long)unboundedWait);
+  printf("  %u works run, %u calls left work for the next one, %u dropped, %u calls over the budget draining the whole queue\n",
+         stats.run, stats.yielded, stats.dropped, unboundedOverBudget);
+  CHECK(overBudget == 0, "%u calls over the budget without a work longer than any before", overBudget);
+  CHECK(boundedCall <= WORK_QUEUE_RUN_US + LONGEST_WORK_US, "a call took %llu us", (unsigned long long)boundedCall);
+  CHECK(boundedWait <= WORK_QUEUE_RUN_US + LONGEST_WORK_US + TASK_US + STEP_US, "the task waited %llu us", (unsigned long long)boundedWait);
+  CHECK(boundedWait < unboundedWait, "the budget does not shorten the wait of the task");
+  CHECK(stats.yielded > 0, "no call reached the budget, the test does not exercise it");
+  CHECK(stats.dropped == 0, "%u works dropped", stats.dropped);
+}
+
+int main(void)
+{
+  testOrder();
+  testSelfPosting();
+  testBudget();
+
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,208 @@
+/*******************************************************************************
+  @file     test_ws2812.c
+  @brief    Host test of the WS2812 table encoder. Compares the frames it
+            encodes, bit for bit, with the encoder it replaced, which sent
+            every bit of every colour value with a branch, in GRB order.
+            Also checks the level tables and the skipping of unchanged frames.
+            The PWM DMA driver is replaced by fakes that keep the frame sent.
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#include "host_test.h"
+#include "drivers/HAL/WS2812/WS2812.c"
+
+#include <math.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define LED_COUNT         (64)
+#define RANDOM_FRAMES     (2000)
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static ws2812_pixel_t   pixels[LED_COUNT];
+static uint16_t         expected[LED_COUNT * WS2812_LED_SIZE];
+static uint16_t         chunk[WS2812_FRAME_SIZE] __attribute__ ((aligned(4)));
+static uint8_t          levels[WS2812_LEVEL_COUNT];
+
+// Fake PWM DMA driver
+static pwmdma_update_callback_t updateCallback;
+static uint16_t*        sentFrame;
+static size_t           sentSize;
+static uint32_t         sentCount;
+
+/*******************************************************************************
+ *******************************************************************************
+                        FAKE PWM DMA DRIVER
+ *******************************************************************************
+ ******************************************************************************/
+
+void pwmdmaInit(uint8_t prescaler, uint16_t mod, ftm_instance_t ftmInstance, ftm_channel_t ftmChannel)
+{
+}
+
+void pwmdmaOnFrameUpdate(pwmdma_update_callback_t callback)
+{
+  updateCallback = callback;
+}
+
+void pwmdmaStart(uint16_t* firstFrame, uint16_t* secondFrame, size_t frameSize, size_t totalFrames, bool loop)
+{
+}
+
+void pwmdmaStartSingle(uint16_t* frame, size_t frameSize)
+{
+  sentFrame = frame;
+  sentSize = frameSize;
+  sentCount++;
+}
+
+bool pwmdmaBusy(void)
+{
+  return false;
+}
+
+uint32_t pwmdmaGetInterruptCount(void)
+{
+  return 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        TESTS
+ *******************************************************************************
+ ******************************************************************************/
+
+// The encoder before the table, one branch per bit, with the levels applied first
+static void referenceEncode(uint16_t* frame, const ws2812_pixel_t* pixel, size_t count, const uint8_t* levelTable)
+{
+  uint8_t pixelComponents[3];
+
+  for (size_t i = 0; i < count; i++)
+  {
+    pixelComponents[0] = levelTable[pixel[i].g];
+    pixelComponents[1] = levelTable[pixel[i].r];
+    pixelComponents[2] = levelTable[pixel[i].b];
+    for (uint8_t j = 0; j < WS2812_LED_RGB_SIZE; j++)
+    {
+      for (uint8_t k = 0; k < 8; k++)
+      {
+        frame[i * WS2812_LED_SIZE + j * 8 + k] = (pixelComponents[j] & 0x80) ? WS2812_HIGH_DUTY : WS2812_LOW_DUTY;
+        pixelComponents[j] <<= 1;
+      }
+    }
+  }
+}
+
+static void randomPixels(void)
+{
+  for (uint32_t i = 0; i < LED_COUNT; i++)
+  {
+    pixels[i].r = rand();
+    pixels[i].g = rand();
+    pixels[i].b = rand();
+  }
+}
+
+// Whole frames and DMA chunks match the old encoder, with the identity level table
+static void testBitExact(void)
+{
+  uint32_t frameMismatches = 0, chunkMismatches = 0, badLatch = 0;
+
+  for (uint32_t i = 0; i < WS2812_LEVEL_COUNT; i++)
+  {
+    levels[i] = i;
+  }
+  WS2812SetBrightness(WS2812_MAX_BRIGHTNESS);
+
+  for (uint32_t frame = 0; frame < RANDOM_FRAMES; frame++)
+  {
+    randomPixels();
+    referenceEncode(expected, pixels, LED_COUNT, levels);
+
+    // Whole frame in a single transfer, closed by a low slot that latches the colours
+    WS2812Update();
+    frameMismatches += memcmp(sentFrame, expected, sizeof(expected)) != 0;
+    badLatch += (sentSize != LED_COUNT * WS2812_LED_SIZE + 1) || (sentFrame[LED_COUNT * WS2812_LED_SIZE] != 0);
+
+    // Chunks of a few leds, as the DMA interrupt encodes them
+    for (uint8_t counter = 0; counter < LED_COUNT / WS2812_FRAME_LED_SIZE; counter++)
+    {
+      updateCallback(chunk, counter);
+      chunkMismatches += memcmp(chunk, expected + counter * WS2812_FRAME_SIZE, sizeof(chunk)) != 0;
+    }
+  }
+
+  CHECK(frameMismatches == 0, "%u of %u whole frames differ from the old encoder", frameMismatches, RANDOM_FRAMES);
+  CHECK(chunkMismatches == 0, "%u chunks differ from the old encoder", chunkMismatches);
+  CHECK(badLatch == 0, "%u frames without the latch slot", badLatch);
+}
+
+// The brightness and the level tables are applied to every colour value
+static void testLevels(void)
+{
+  uint32_t mismatches = 0;
+
+  // Brightness, a linear scale rounded to the nearest level
+  WS2812SetBrightness(100);
+  for (uint32_t i = 0; i < WS2812_LEVEL_COUNT; i++)
+  {
+    levels[i] = (i * 100 + 127) / 255;
+  }
+  randomPixels();
+  referenceEncode(expected, pixels, LED_COUNT, levels);
+  WS2812Update();
+  mismatches += memcmp(sentFrame, expected, sizeof(expected)) != 0;
+
+  // A gamma curve
+  for (uint32_t i = 0; i < WS2812_LEVEL_COUNT; i++)
+  {
+    levels[i] = (uint8_t)lrint(255.0 * pow(i / 255.0, 2.2));
+  }
+  WS2812SetLevelTable(levels);
+  referenceEncode(expected, pixels, LED_COUNT, levels);
+  WS2812Update();
+  mismatches += memcmp(sentFrame, expected, sizeof(expected)) != 0;
+
+  CHECK(mismatches == 0, "%u frames with the wrong levels", mismatches);
+  WS2812SetBrightness(WS2812_MAX_BRIGHTNESS);
+}
+
+// An unchanged frame is not sent again, unless the levels changed
+static void testSkipUnchanged(void)
+{
+  ws2812_stats_t stats;
+  uint32_t sent;
+
+  randomPixels();
+  WS2812Update();
+  sent = sentCount;
+  WS2812Update();
+  CHECK(sentCount == sent, "an unchanged frame was sent again");
+  WS2812GetStats(&stats);
+  CHECK(stats.framesSkipped >= 1, "the skipped frame was not counted");
+
+  WS2812SetBrightness(WS2812_MAX_BRIGHTNESS);
+  WS2812Update();
+  CHECK(sentCount == sent + 1, "the frame was not sent after setting the brightness");
+
+  pixels[LED_COUNT - 1].b ^= 1;
+  WS2812Update();
+  CHECK(sentCount == sent + 2, "a frame with one value changed was not sent");
+}
+
+int main(void)
+{
+  WS2812Init();
+  WS2812SetDisplayBuffer(pixels, LED_COUNT);
+
+  testBitExact();
+  testLevels();
+  testSkipUnchanged();
+
+  return HOST_TEST_RESULT();
+}
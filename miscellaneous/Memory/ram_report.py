@@ -0,0 +1,134 @@
+"""
+RAM report of the mp3_player_eq project, per subsystem, from the linker map.
+
+The budgets and the directory of each subsystem are read from
+source/memory/memory_plan.h, the first word of the comment of each
+MEMORY_BUDGET_ definition being the directory. A directory with a budget per
+configuration is checked against the largest one, the smaller ones are checked
+when compiling. Returns a non zero exit code when a subsystem exceeds its
+budget. Run it by hand after building, the project build settings are not in
+the repository to run it as a post-build step:
+
+    python ram_report.py Debug/mp3_player_eq.map source/memory/memory_plan.h
+"""
+
+import re
+import sys
+from collections import defaultdict
+from os import path
+
+BUDGET_RE = re.compile(r'#define\s+MEMORY_BUDGET_(\w+)\s+\(([\d\s\*\+]+)\)\s*//\s*(\S+?),?\s')
+SECTION_RE = re.compile(r'^\s+(\.bss\S*|\.data\S*|\.noinit\S*|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$')
+CONTINUATION_RE = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+
+# SRAM banks of the K64F, by base address
+BANKS = [('SRAM_L', 0x1FFF0000, 0x10000), ('SRAM_U', 0x20000000, 0x30000)]
+
+
+def read_budgets(header):
+    budgets = {}
+    with open(header, 'r') as f:
+        for line in f:
+            match = BUDGET_RE.search(line)
+            if match:
+                name, expression, directory = match.groups()
+                budget = eval(expression, {'__builtins__': {}})
+                directory = directory.strip('/')
+                if directory not in budgets or budgets[directory][1] < budget:
+                    budgets[directory] = (name, budget)
+    return budgets
+
+
+def object_directory(obj):
+    # Archive members are accounted to the archive, "lib/helix/libhelix.a(mp3dec.o)"
+    obj = obj.split('(')[0]
+    obj = obj.replace('\\', '/')
+    while obj.startswith('./') or obj.startswith('../'):
+        obj = obj[obj.index('/') + 1:]
+    return path.dirname(obj)
+
+
+def bank_of(address):
+    for name, base, length in BANKS:
+        if base <= address < base + length:
+            return name
+    return None
+
+
+def read_map(map_file):
+    sizes = defaultdict(int)
+    banks = defaultdict(int)
+    pending = None
+    in_map = False
+    with open(map_file, 'r') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('Linker script and memory map'):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+
+            # Long section names leave the address and size on the next line
+            if pending is not None:
+                match = CONTINUATION_RE.match(line)
+                if match:
+                    sizes[object_directory(match.group(3))] += int(match.group(2), 16)
+                    banks[bank_of(int(match.group(1), 16))] += int(match.group(2), 16)
+                pending = None
+                continue
+
+            match = SECTION_RE.match(line)
+            if match:
+                if match.group(2) is None:
+                    pending = match.group(1)
+                else:
+                    sizes[object_directory(match.group(4))] += int(match.group(3), 16)
+                    banks[bank_of(int(match.group(2), 16))] += int(match.group(3), 16)
+    return sizes, banks
+
+
+def subsystem_of(directory, budgets):
+    best = None
+    for subsystem in budgets:
+        if directory == subsystem or directory.startswith(subsystem + '/'):
+            if best is None or len(subsystem) > len(best):
+                best = subsystem
+    return best
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f'usage: {sys.argv[0]} <linker map> <memory_plan.h>')
+        return 2
+
+    budgets = read_budgets(sys.argv[2])
+    sizes, banks = read_map(sys.argv[1])
+
+    used = defaultdict(int)
+    for directory, size in sizes.items():
+        used[subsystem_of(directory, budgets) or directory or '<other>'] += size
+
+    exceeded = False
+    total = 0
+    print(f'{"Subsystem":<28}{"Used":>10}{"Budget":>10}{"Free":>10}')
+    for subsystem in sorted(used, key=lambda s: -used[s]):
+        size = used[subsystem]
+        total += size
+        if subsystem in budgets:
+            budget = budgets[subsystem][1]
+            status = '' if size <= budget else '  OVER BUDGET'
+            exceeded |= size > budget
+            print(f'{subsystem:<28}{size:>10}{budget:>10}{budget - size:>10}{status}')
+        else:
+            print(f'{subsystem:<28}{size:>10}{"-":>10}{"-":>10}')
+    print(f'{"Total":<28}{total:>10}')
+    print()
+    for name, base, length in BANKS:
+        print(f'{name:<28}{banks[name]:>10}{length:>10}{length - banks[name]:>10}')
+
+    return 1 if exceeded else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
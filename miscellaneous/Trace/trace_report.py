@@ -0,0 +1,192 @@
+"""
+Latency report of a trace dumped by the mp3_player_eq project.
+
+The dump is the semihosting console output of traceDump(), other lines are
+ignored and the last dump found is used. The names of the trace points are
+read from drivers/HAL/trace/trace.h, and the names of the events and their
+classes from source/events/events.h when given. Prints latency histograms and
+the slices of each task that ran over its budget. The Chrome trace, written
+when requested, also marks the moment the SysTick found a slice over its
+budget while it still ran. It opens in chrome://tracing or https://ui.perfetto.dev:
+
+    python trace_report.py console.txt drivers/HAL/trace/trace.h --events source/events/events.h --chrome trace.json
+"""
+
+import argparse
+import json
+import re
+import sys
+from collections import defaultdict
+
+ENUM_RE = re.compile(r'typedef\s+enum\s*\{(.*?)\}\s*(\w+)\s*;', re.S)
+ENUMERATOR_RE = re.compile(r'^\s*(\w+)\s*(?:=\s*(\d+))?\s*,?', re.M)
+BEGIN_RE = re.compile(r'^trace begin (\d+) (\d+)$')
+END_RE = re.compile(r'^trace end (\d+)$')
+RECORD_RE = re.compile(r'^([0-9a-fA-F]{16}) (\d+) (\d+) ([0-9a-fA-F]{8})$')
+
+
+def read_enums(header):
+    # Enumerators of every enum of the header, by the name of its type
+    with open(header, 'r') as f:
+        text = re.sub(r'//[^\n]*', '', f.read())
+    enums = {}
+    for body, name in ENUM_RE.findall(text):
+        values = {}
+        value = 0
+        for match in ENUMERATOR_RE.finditer(body):
+            if match.group(2) is not None:
+                value = int(match.group(2))
+            values[value] = match.group(1)
+            value += 1
+        enums[name] = values
+    return enums
+
+
+def read_dump(dump):
+    clock, records, lost, current = None, None, 0, None
+    with open(dump, 'r', errors='replace') as f:
+        for line in f:
+            line = line.strip()
+            match = BEGIN_RE.match(line)
+            if match:
+                current = (int(match.group(1)), [])
+                continue
+            if current is None:
+                continue
+            match = RECORD_RE.match(line)
+            if match:
+                current[1].append((int(match.group(1), 16), int(match.group(2)), int(match.group(3)), int(match.group(4), 16)))
+                continue
+            match = END_RE.match(line)
+            if match:
+                clock, records = current
+                lost = int(match.group(1))
+                current = None
+    return clock, records, lost
+
+
+def histogram(title, samples, deadline=None):
+    print(title)
+    if not samples:
+        print('  no samples\n')
+        return
+    samples = sorted(samples)
+    count = len(samples)
+    print(f'  n {count}  min {samples[0]:.1f}  p50 {samples[count // 2]:.1f}  '
+          f'p99 {samples[min(count - 1, count * 99 // 100)]:.1f}  max {samples[-1]:.1f} us')
+    if deadline is not None:
+        late = sum(1 for sample in samples if sample > deadline)
+        print(f'  deadline {deadline:.1f} us, {late} late')
+
+    # Power of two buckets
+    buckets = defaultdict(int)
+    for sample in samples:
+        buckets[max(int(sample), 1).bit_length() - 1] += 1
+    most = max(buckets.values())
+    for bucket in range(min(buckets), max(buckets) + 1):
+        amount = buckets[bucket]
+        print(f'  [{1 << bucket:>9}, {2 << bucket:>9}) {"#" * ((amount * 40 + most - 1) // most):<40} {amount}')
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Latency report of a trace dump')
+    parser.add_argument('dump', help='console output with the trace dump')
+    parser.add_argument('trace', help='drivers/HAL/trace/trace.h')
+    parser.add_argument('--events', help='source/events/events.h, to name the events and their classes')
+    parser.add_argument('--chrome', help='Chrome trace to be written')
+    args = parser.parse_args()
+
+    ids = read_enums(args.trace).get('trace_id_t', {})
+    events = read_enums(args.events) if args.events else {}
+    event_names = events.get('event_id_t', {})
+    class_names = events.get('events_class_t', {})
+    clock, records, lost = read_dump(args.dump)
+    if not records:
+        print('no trace dump found')
+        return 1
+
+    us = lambda cycles: cycles * 1e6 / clock
+    start = records[0][0]
+    event_of = lambda arg: event_names.get(arg & 0xFF, str(arg & 0xFF))
+    class_of = lambda arg: class_names.get(arg >> 8, f'class {arg >> 8}')
+    input_class = {name: value for value, name in class_names.items()}.get('EVENTS_CLASS_INPUT', 1)
+    threads = {}
+    tid = lambda thread: threads.setdefault(thread, len(threads))
+
+    print(f'{len(records)} records, {lost} overwritten, {us(records[-1][0] - start) / 1e3:.1f} ms\n')
+
+    dispatch = defaultdict(list)        # Raise to dispatch, by class
+    dropped = defaultdict(int)
+    input_to_lcd = []                   # Input raised to the next LCD write
+    refill = []                         # Buffer played to its refill finished
+    periods = []                        # Between buffers played
+    overruns = defaultdict(list)        # Slices over their budget, by task
+    waiting_input = []
+    finished = {}
+    last_finished = None
+    chrome = []
+    open_slices = {}
+
+    for timestamp, trace_id, arg, payload in records:
+        name = ids.get(trace_id, str(trace_id))
+        time = us(timestamp - start)
+
+        if name == 'TRACE_EVENT_DISPATCHED':
+            dispatch[class_of(arg)].append(us(payload))
+            chrome.append({'name': event_of(arg), 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('dispatch')})
+        elif name in ('TRACE_EVENT_RAISED', 'TRACE_EVENT_DROPPED'):
+            if name == 'TRACE_EVENT_DROPPED':
+                dropped[class_of(arg)] += 1
+            elif (arg >> 8) == input_class:
+                waiting_input.append(time)
+            chrome.append({'name': event_of(arg) + (' dropped' if name == 'TRACE_EVENT_DROPPED' else ''),
+                           'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid(class_of(arg))})
+        elif name == 'TRACE_UI_LCD_WRITE':
+            input_to_lcd.extend(time - raised for raised in waiting_input)
+            waiting_input = []
+            chrome.append({'name': f'line {arg}', 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('lcd')})
+        elif name == 'TRACE_AUDIO_FRAME_FINISHED':
+            finished[payload] = time
+            if last_finished is not None:
+                periods.append(time - last_finished)
+            last_finished = time
+            chrome.append({'name': f'buffer {payload:08x}', 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('dac')})
+        elif name in ('TRACE_AUDIO_REFILL_BEGIN', 'TRACE_WORK_BEGIN'):
+            open_slices[(name, payload)] = time
+        elif name in ('TRACE_AUDIO_REFILL_END', 'TRACE_WORK_END'):
+            begin = open_slices.pop((name.replace('_END', '_BEGIN'), payload), None)
+            if name == 'TRACE_AUDIO_REFILL_END' and payload in finished:
+                refill.append(time - finished.pop(payload))
+            if begin is not None:
+                audio = name == 'TRACE_AUDIO_REFILL_END'
+                chrome.append({'name': 'refill' if audio else f'work {payload:08x}', 'ph': 'X', 'ts': begin,
+                               'dur': time - begin, 'pid': 0, 'tid': tid('audio' if audio else 'work queue')})
+        elif name == 'TRACE_TASK_OVERRUN':
+            overruns[arg].append(us(payload))
+            chrome.append({'name': f'task {arg} overrun', 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('scheduler')})
+        elif name == 'TRACE_TASK_OVER_BUDGET':
+            chrome.append({'name': f'task {arg} over budget', 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('scheduler')})
+        else:
+            chrome.append({'name': name, 'ph': 'i', 's': 't', 'ts': time, 'pid': 0, 'tid': tid('other')})
+
+    for event_class in sorted(set(dispatch) | set(dropped)):
+        histogram(f'{event_class}, raised to dispatched (us), {dropped[event_class]} dropped', dispatch[event_class])
+    histogram('Input raised to LCD written (us)', input_to_lcd)
+    period = sorted(periods)[len(periods) // 2] if periods else None
+    histogram('Buffer played to refilled (us)', refill, period)
+    for task in sorted(overruns):
+        histogram(f'Task {task}, slices over its budget (us)', overruns[task])
+
+    if args.chrome:
+        chrome.extend({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': number, 'args': {'name': thread}}
+                      for thread, number in threads.items())
+        with open(args.chrome, 'w') as f:
+            json.dump({'traceEvents': chrome, 'displayTimeUnit': 'ms'}, f)
+        print(f'{len(chrome)} events written to {args.chrome}')
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -34,7 +34,7 @@
 // SPI Serial2Parallel port definitions
 #define SPORT_SPI_INSTANCE	SPI_INSTANCE_0
 #define SPORT_SPI_SLAVE		1
-#define SPORT_SPI_BAUD_RATE	700000	// 700 kbps ensures 40us between instructions
+#define SPORT_SPI_BAUD_RATE	700000	// 700 kbps ensures 40us between instructions, frames are paced by the SPI even when sent by the DMA
 #define SPORT_SPI_FRAME_SIZE	6	// 4 data bits, 1 for E and 1 for RS
 
 /*******************************************************************************
@@ -72,6 +72,9 @@ typedef struct {
 	// Timer ID given by the driver
 	tim_id_t				idTimer;
 
+	// SPI frames queued to the output port
+	uint32_t				frameCount;
+
 } hd44780_context_t;
 
 /*******************************************************************************
@@ -101,12 +104,6 @@ static hd44780_context_t lcdContext;
  */
 static void writeInstructionNybble(uint8_t instruction);
 
-/**
- * @brief Writes the given data nybble to the LCD
- * @param data	Data nybble to be written
- */
-static void writeDataNybble(uint8_t data);
-
 /**
  * @brief Starts writing the given nybble to the LCD and queues
  * 			the E pulse.
@@ -115,6 +112,15 @@ static void writeDataNybble(uint8_t data);
  */
 static void writeNybble(uint8_t rs, uint8_t nybble);
 
+/**
+ * @brief Queues both nybbles of a byte, MSN first, with their E pulses. Either the whole
+ * 			byte is queued or nothing is, so a full port never leaves the LCD with half a byte.
+ * @param rs		RS bit to be written
+ * @param byte		Byte to be written
+ * @returns			True if the byte was queued
+ */
+static bool writeByte(uint8_t rs, uint8_t byte);
+
 // EVENT CALLBACKS
 
 /**
@@ -185,7 +191,8 @@ void HD44780Init(hd44780_cfg_t config)
 			.continuousPcs = SPI_CONTINUOUS_PCS_DIS,
 			.clockPhase = SPI_CPHA_FIRST_CAPTURE,
 			.clockPolarity = SPI_CPOL_INACTIVE_LOW,
-			.endianness = SPI_ENDIANNESS_MSB_FIRST
+			.endianness = SPI_ENDIANNESS_MSB_FIRST,
+			.txDma = SPI_TX_DMA_EN
 		};
 		spiInit(SPORT_SPI_INSTANCE, SPORT_SPI_SLAVE, spiConfig);
 
@@ -206,24 +213,31 @@ void HD44780onInitReady(hd44780_callback_t callback)
 }
 
 
-void HD44780WriteInstruction(uint8_t instruction)
+bool HD44780WriteInstruction(uint8_t instruction)
 {
+	bool ret = false;
 	if (lcdContext.initState >= HD44780_INITIALIZING_4BIT)
 	{
-		// Write both nybbles, MSN first
-		writeInstructionNybble( (instruction & 0xF0) >> 4);
-		writeInstructionNybble( instruction & 0x0F );
+		// Write with RS=0 (instruction)
+		ret = writeByte(0, instruction);
 	}
+	return ret;
 }
 
-void HD44780WriteData(uint8_t data)
+bool HD44780WriteData(uint8_t data)
 {
+	bool ret = false;
 	if (lcdContext.initState >= HD44780_INITIALIZING_4BIT)
 	{
-		// Write both nybbles, MSN first
-		writeDataNybble( (data & 0xF0) >> 4);
-		writeDataNybble( data & 0x0F );
+		// Write with RS=1 (data)
+		ret = writeByte(1, data);
 	}
+	return ret;
+}
+
+uint32_t HD44780GetFrameCount(void)
+{
+	return lcdContext.frameCount;
 }
 
 /*******************************************************************************
@@ -240,12 +254,6 @@ void writeInstructionNybble(uint8_t instruction)
 	writeNybble(0, instruction);
 }
 
-void writeDataNybble(uint8_t data)
-{
-	// Write nybble with RS=1 (data)
-	writeNybble(1, data);
-}
-
 
 void writeNybble(uint8_t rs, uint8_t nybble)
 {
@@ -259,6 +267,22 @@ void writeNybble(uint8_t rs, uint8_t nybble)
 	portWriteMany(message, 3);
 }
 
+bool writeByte(uint8_t rs, uint8_t byte)
+{
+	uint16_t message[6];
+	uint8_t nybbles[2] = { (byte & 0xF0) >> 4, byte & 0x0F };
+
+	for (uint8_t i = 0 ; i < 2 ; i++)
+	{
+		message[3 * i + 0] = HD44780_PORT_VALUE(rs, 0, nybbles[i]);	// E = 0, write D4-D7 and RS
+		message[3 * i + 1] = HD44780_PORT_VALUE(rs, 1, nybbles[i]);	// E = 1, write D4-D7 and RS
+		message[3 * i + 2] = HD44780_PORT_VALUE(rs, 0, nybbles[i]);	// E = 0, write D4-D7 and RS
+	}
+
+	// Start transfer
+	return portWriteMany(message, 6);
+}
+
 uint8_t parallelOutput4bit(uint8_t enable, uint8_t rs, uint8_t value)
 {
 	uint8_t newPortValue = ((rs & 1) << HD44780_RS_POS) | ((enable & 1) << HD44780_E_POS) | ((value & 0xF) << HD44780_VALUE_POS);
@@ -349,13 +373,13 @@ bool portWriteMany(uint16_t * buffer, size_t len)
 	if (spiCanSend(SPORT_SPI_INSTANCE, len))
 	{
 		// Send values to the output
-		spiSend(SPORT_SPI_INSTANCE, SPORT_SPI_SLAVE, buffer, len);
-
-		// Save last value as current value
-		lcdContext.currentPortValue = buffer[len-1];
-
-		// Success
-		ret = true;
+		ret = spiSend(SPORT_SPI_INSTANCE, SPORT_SPI_SLAVE, buffer, len);
+		if (ret)
+		{
+			// Save last value as current value
+			lcdContext.currentPortValue = buffer[len-1];
+			lcdContext.frameCount += len;
+		}
 	}
 	else
 	{
@@ -115,14 +115,24 @@ void HD44780onInitReady(hd44780_callback_t callback);
 /**
  * @brief Writes to the LCD IR. Asynchronous, can take up to 200us.
  * @param instruction 	HD44780 instruction
+ * @returns				True if it was queued, false if the port is full or the LCD is not initialized.
+ * 						Nothing reaches the LCD when it fails.
  */
-void HD44780WriteInstruction(uint8_t instruction);
+bool HD44780WriteInstruction(uint8_t instruction);
 
 /**
  * @brief Writes to the LCD DR. Asynchronous, can take up to 200us.
  * @param data		Byte to be written
+ * @returns			True if it was queued, false if the port is full or the LCD is not initialized.
+ * 					Nothing reaches the LCD when it fails.
  */
-void HD44780WriteData(uint8_t data);
+bool HD44780WriteData(uint8_t data);
+
+/**
+ * @brief Returns the amount of SPI frames queued to the serial to parallel port since
+ * 		  the initialization. Each byte written to the LCD takes 6 frames of 6 bits.
+ */
+uint32_t HD44780GetFrameCount(void);
 
 /*******************************************************************************
  ******************************************************************************/
@@ -27,6 +27,12 @@
 // Custom characters row count (8th row is the same as the cursor)
 #define HD44780_CHARACTER_ROWS				8
 
+// Cursor column when its position in the LCD is not known
+#define HD44780_CURSOR_UNKNOWN				0xFF
+
+// DDRAM address of the first column of each line
+#define HD44780_LINE_ADDRESS(line)			((line) * 0x40)
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
@@ -47,10 +53,6 @@ typedef struct {
 
 	// Rotation flag
 	bool			rotating;
-
-	// Control flag, set when a function is changing the line content so that
-	// the timer callback doesn't print anything
-	bool 			changing;
 } hd44780_line_context_t;
 
 
@@ -62,11 +64,32 @@ typedef struct {
 	// Custom characters set-up variables
 	tim_id_t	customCharTimer;	// Timer to execute each step
 	uint8_t		currentCharCode;	// Writen character codes counter
+	uint8_t		currentCharRow;		// Writen rows of the current character
 	bool		customCharsReady;	// Flag indicating the characters were written
 
 	// One context for each line for independent management
 	hd44780_line_context_t	lineContexts[HD44780_LINE_COUNT];
 
+	// Characters to be shown, and shadow copy of the LCD DDRAM. Services only write
+	// the screen, and the flush sends the cells where both of them differ.
+	uint8_t			screen[HD44780_LINE_COUNT][HD44780_COL_COUNT];
+	uint8_t			shadow[HD44780_LINE_COUNT][HD44780_COL_COUNT];
+
+	// Cursor used by the cursor-dependent services
+	uint8_t			cursorLine;
+	uint8_t			cursorCol;
+
+	// Position of the LCD address counter, to skip setting it when it already points to a changed cell
+	uint8_t			lcdCursorLine;
+	uint8_t			lcdCursorCol;
+
+	// Timer to flush again the cells left when the port was full
+	tim_id_t		flushTimer;
+
+	// Control flag, set when a service is changing the screen so that
+	// the timer callbacks don't flush anything
+	volatile bool	changing;
+
 } hd44780_lcd_context_t;
 
 /*******************************************************************************
@@ -78,21 +101,47 @@ typedef struct {
  ******************************************************************************/
 
 /**
- * @brief Writes a new special character to the LCD CGRAM.
+ * @brief Writes a new special character to the LCD CGRAM, from the first row not written yet.
  * @param code 	character code of the new custom character
+ * @returns		True if the whole character was written
  */
-static void writeCustomChar(uint8_t code);
+static bool writeCustomChar(uint8_t code);
 
 /**
  * @brief Sets the cursor position. Next write operation will be displayed at the given place
  * @param line	Cursor position line, can be 0 or 1
  * @param col	Cursor position column, can be 0 through 15
- * @returns 	True if it is a valid cursor position
+ * @returns 	True if it is a valid cursor position and it was written
  */
 static bool HD44780SetCursor(uint8_t line, uint8_t col);
 
+/**
+ * @brief Writes characters to the screen, from the given position up to the end of the line.
+ * 		  The cursor of the cursor-dependent services is left after the last character.
+ * @param line		Line, can be 0 or 1
+ * @param col		First column, can be 0 through 15
+ * @param buffer	Characters to be written
+ * @param len		Amount of characters to be written
+ */
+static void HD44780ScreenWrite(uint8_t line, uint8_t col, const uint8_t * buffer, size_t len);
+
+/**
+ * @brief Sends the cells of the screen which differ from the shadow DDRAM. The address counter
+ * 		  is only set before a changed cell it is not already pointing to, so each run of
+ * 		  changed cells costs a single cursor set. If the port gets full, the cells left keep
+ * 		  differing from the shadow and are flushed again on the next tick.
+ */
+static void HD44780Flush(void);
+
+/**
+ * @brief Fills a line of the screen with the window of the rotating string at its current position.
+ * @param line	Line being rotated
+ */
+static void HD44780ScreenRotate(uint8_t line);
+
 // TIMER CALLBACKS
 static void customTimerCallback(void);
+static void flushTimerCallback(void);
 static void line1TimerCallback(void);
 static void line2TimerCallback(void);
 
@@ -200,6 +249,13 @@ void HD44780LcdInit(void)
 			context.lineContexts[i].timerCallback = timerCallbacks[i];
 		}
 		context.customCharTimer = timerGetId();
+		context.flushTimer = timerGetId();
+
+		// The LCD is cleared by its initialization
+		memset(context.screen, ' ', sizeof(context.screen));
+		memset(context.shadow, ' ', sizeof(context.shadow));
+		context.lcdCursorLine = 0;
+		context.lcdCursorCol = HD44780_CURSOR_UNKNOWN;
 
 		// Set flags
 		context.initialized = true;
@@ -216,53 +272,47 @@ bool HD44780LcdInitReady(void)
 
 void HD44780WriteChar(uint8_t line, uint8_t col, uint8_t character)
 {
-	// Stop rotating
-	context.lineContexts[line].rotating = false;
-
-	// Set cursor position, check it is valid
-	if (HD44780SetCursor(line, col) )
-	{
-		// Write character
-		HD44780WriteData(character);
-	}
+	HD44780WriteString(line, col, &character, 1);
 }
 
 void HD44780WriteString(uint8_t line, uint8_t col, uint8_t * buffer, size_t len)
 {
-	size_t charAmount;
+	if ((line < HD44780_LINE_COUNT) && (col < HD44780_COL_COUNT))
+	{
+		context.changing = true;
 
-	// Stop rotating
-	context.lineContexts[line].rotating = false;
+		// Stop rotating
+		context.lineContexts[line].rotating = false;
 
-	// Set cursor position, check it is valid
-	if ( HD44780SetCursor(line, col) )
-	{
-		// Get number of characters to be written, min{len, TOTAL_COLS}
-		charAmount = (len + col) < HD44780_COL_COUNT ? len : (HD44780_COL_COUNT - col);
+		// Write the characters which fit in the line
+		HD44780ScreenWrite(line, col, buffer, len);
+		HD44780Flush();
 
-		// Write each character to the display
-		for (uint8_t i = 0 ; i < charAmount ; i++)
-		{
-			HD44780WriteData(buffer[i]);
-		}
+		context.changing = false;
 	}
 }
 
 void HD44780WriteNewLine(uint8_t line, uint8_t * buffer, size_t len)
 {
+	uint8_t spaces[HD44780_COL_COUNT];
+
 	if (line < HD44780_LINE_COUNT)
 	{
-		// Write given characters from line beggining
-		HD44780WriteString(line, 0, buffer, len);
+		context.changing = true;
+
+		// Stop rotating
+		context.lineContexts[line].rotating = false;
 
-		// Complete with spaces if necessary
+		// Write given characters from line beggining, and complete with spaces if necessary
+		HD44780ScreenWrite(line, 0, buffer, len);
 		if (len < HD44780_COL_COUNT)
 		{
-			for (uint8_t i = 0 ; i < (HD44780_COL_COUNT - len) ; i++ )
-			{
-				HD44780WriteData(' ');
-			}
+			memset(spaces, ' ', sizeof(spaces));
+			HD44780ScreenWrite(line, len, spaces, HD44780_COL_COUNT - len);
 		}
+		HD44780Flush();
+
+		context.changing = false;
 	}
 }
 
@@ -270,15 +320,15 @@ void HD44780WriteRotatingString(uint8_t line, uint8_t * buffer, size_t len, uint
 {
 	hd44780_line_context_t * pLineContext = &(context.lineContexts[line]);
 
-	// Set changing flag to prevent callback from writing to the display
-	pLineContext->changing = true;
-
 	// Write string beggining
 	HD44780WriteNewLine(line, buffer, len);
 
 	// If rotation is needed
 	if (len > HD44780_COL_COUNT)
 	{
+		// Set changing flag to prevent callback from writing to the display
+		context.changing = true;
+
 		size_t bufLen = len < HD44780_MAX_LINE_LENGTH ? len : HD44780_MAX_LINE_LENGTH;
 
 		// Copy to internal buffer, save length
@@ -289,31 +339,28 @@ void HD44780WriteRotatingString(uint8_t line, uint8_t * buffer, size_t len, uint
 		pLineContext->bufferPos = 1;
 
 		// Start timer
-		timerStart(pLineContext->idTimer, TIMER_MS2TICKS(ms), TIM_MODE_PERIODIC, pLineContext->timerCallback);
+		timerStartDeferred(pLineContext->idTimer, TIMER_MS2TICKS(ms), TIM_MODE_PERIODIC, pLineContext->timerCallback);
 
 		// Set rotation flag
 		pLineContext->rotating = true;
-	}
-
-	// Clear changing flag
-	pLineContext->changing = false;
 
+		// Clear changing flag
+		context.changing = false;
+	}
 }
 
 // WRITING CURSOR-DEPENDENT SERVICES
 
 void HD44780WriteCharAtCursor(uint8_t character)
 {
-	// Write character
-	HD44780WriteData(character);
+	HD44780WriteStringAtCursor(&character, 1);
 }
 
 void HD44780WriteStringAtCursor(uint8_t * buffer, size_t len)
 {
-	// Write each character to the display
-	for (uint8_t i = 0 ; i < len ; i++)
+	if (context.cursorCol < HD44780_COL_COUNT)
 	{
-		HD44780WriteData(buffer[i]);
+		HD44780WriteString(context.cursorLine, context.cursorCol, buffer, len);
 	}
 }
 
@@ -323,23 +370,19 @@ void HD44780ClearLine(uint8_t line)
 {
 	uint8_t aux;
 
-	// Stop rotating
-	context.lineContexts[line].rotating = false;
-
-	// Write new line with len = 0, will complete with spaces
+	// Write new line with len = 0, will complete with spaces and stop rotating
 	HD44780WriteNewLine(line, &aux, 0);
 }
 
 void HD44780ClearDisplay(void)
 {
-	// Stop rotating both lines
+	// Clear both lines, only the cells which are not already blank are sent
 	for (uint8_t i = 0 ; i < HD44780_LINE_COUNT ; i++)
 	{
-		context.lineContexts[i].rotating = false;
+		HD44780ClearLine(i);
 	}
-
-	// Write instruction
-	HD44780WriteInstruction(HD44780_CLEAR_DISPLAY);
+	context.cursorLine = 0;
+	context.cursorCol = 0;
 }
 
 
@@ -354,35 +397,106 @@ bool HD44780SetCursor(uint8_t line, uint8_t col)
 	bool ret = false;
 	if ((line < HD44780_LINE_COUNT) && (col < HD44780_COL_COUNT))
 	{
-		uint8_t cursorAddress = col + line * 0x40;
-		HD44780WriteInstruction(HD44780_SET_DDRAM_ADD(cursorAddress));
-		ret = true;
+		uint8_t cursorAddress = col + HD44780_LINE_ADDRESS(line);
+		ret = HD44780WriteInstruction(HD44780_SET_DDRAM_ADD(cursorAddress));
+		context.lcdCursorLine = line;
+		context.lcdCursorCol = ret ? col : HD44780_CURSOR_UNKNOWN;
 	}
 
 	return ret;
 }
 
-void writeCustomChar(uint8_t code)
+void HD44780ScreenWrite(uint8_t line, uint8_t col, const uint8_t * buffer, size_t len)
+{
+	// Get number of characters to be written, min{len, TOTAL_COLS - col}
+	size_t charAmount = (len + col) < HD44780_COL_COUNT ? len : (HD44780_COL_COUNT - col);
+
+	memcpy(&context.screen[line][col], buffer, charAmount);
+	context.cursorLine = line;
+	context.cursorCol = col + charAmount;
+}
+
+void HD44780Flush(void)
+{
+	bool sent = true;
+
+	for (uint8_t line = 0 ; sent && (line < HD44780_LINE_COUNT) ; line++)
+	{
+		for (uint8_t col = 0 ; sent && (col < HD44780_COL_COUNT) ; col++)
+		{
+			uint8_t character = context.screen[line][col];
+			if (character != context.shadow[line][col])
+			{
+				// Start of a run of changed cells, unless the address counter is already here
+				if ((context.lcdCursorLine != line) || (context.lcdCursorCol != col))
+				{
+					sent = HD44780SetCursor(line, col);
+				}
+
+				// The address counter increments after each write. If the port is full, the cell
+				// is left changed and the cursor is set again before the next write.
+				sent = sent && HD44780WriteData(character);
+				if (sent)
+				{
+					context.shadow[line][col] = character;
+					context.lcdCursorCol++;
+				}
+				else
+				{
+					context.lcdCursorCol = HD44780_CURSOR_UNKNOWN;
+				}
+			}
+		}
+	}
+
+	if (!sent)
+	{
+		timerStartDeferred(context.flushTimer, 1, TIM_MODE_SINGLESHOT, flushTimerCallback);
+	}
+}
+
+void HD44780ScreenRotate(uint8_t line)
 {
-	// Write CGRAM address (6 bits), upper 3 bits determine character code
-	HD44780WriteInstruction(HD44780_SET_CGRAM_ADD((code & 0x07) << 3) );
+	hd44780_line_context_t * pLineContext = &(context.lineContexts[line]);
+	uint8_t period = pLineContext->bufferSize + HD44780_SPACE_BETWEEN_ROTATIONS;
+	uint8_t index = pLineContext->bufferPos;
+
+	for (uint8_t i = 0 ; i < HD44780_COL_COUNT ; i++)
+	{
+		// Message, and spaces between the end of the message and the beggining
+		context.screen[line][i] = (index < pLineContext->bufferSize) ? pLineContext->buffer[index] : ' ';
+		index = (index + 1 < period) ? index + 1 : 0;
+	}
+}
 
-	// Write CGRAM data, once for each row of the character.
-	for ( uint8_t i = 0 ; i < HD44780_CHARACTER_ROWS ; i++ )
+bool writeCustomChar(uint8_t code)
+{
+	// Write CGRAM address (6 bits), upper 3 bits determine character code and lower 3 bits the row
+	bool sent = HD44780WriteInstruction(HD44780_SET_CGRAM_ADD(((code & 0x07) << 3) + context.currentCharRow) );
+
+	// Write CGRAM data, once for each row of the character. The rows left when the port
+	// gets full are written on the next step.
+	while ( sent && (context.currentCharRow < HD44780_CHARACTER_ROWS) )
 	{
-		HD44780WriteData(customCharacters[code][i]);
+		sent = HD44780WriteData(customCharacters[code][context.currentCharRow]);
+		context.currentCharRow += sent;
 	}
 
 	// Write a DDRAM address again so that next data write goes to DDRAM
-	HD44780WriteInstruction(HD44780_SET_DDRAM_ADD(0));
+	sent = sent && HD44780WriteInstruction(HD44780_SET_DDRAM_ADD(0));
+	context.lcdCursorLine = 0;
+	context.lcdCursorCol = sent ? 0 : HD44780_CURSOR_UNKNOWN;
+
+	return sent;
 }
 
 void onInitReady(void)
 {
 	// Initialize sequence of steps to send to the LCD
 	context.currentCharCode = 0;
+	context.currentCharRow = 0;
 	context.customCharsReady = false;
-	timerStart(context.customCharTimer, 1, TIM_MODE_PERIODIC, customTimerCallback);
+	timerStartDeferred(context.customCharTimer, 1, TIM_MODE_PERIODIC, customTimerCallback);
 }
 
 // TIMER CALLBACKS
@@ -395,13 +509,21 @@ void customTimerCallback(void)
 		timerPause(context.customCharTimer);
 		context.customCharsReady = true;
 	}
-	else
+	else if (writeCustomChar(context.currentCharCode))
 	{
-		// Write current char code to CGRAM
-		writeCustomChar(context.currentCharCode++);
+		// Next char code, a character which could not be written is completed on the next step
+		context.currentCharCode++;
+		context.currentCharRow = 0;
 	}
+}
 
-
+void flushTimerCallback(void)
+{
+	// A service changing the screen flushes it when it is done
+	if (!context.changing)
+	{
+		HD44780Flush();
+	}
 }
 
 void line1TimerCallback(void)
@@ -417,38 +539,25 @@ void line2TimerCallback(void)
 
 void timeoutHandler(uint8_t line)
 {
-	hd44780_line_context_t lineContext = context.lineContexts[line];
+	hd44780_line_context_t * pLineContext = &(context.lineContexts[line]);
 
-	if (lineContext.rotating)
+	if (pLineContext->rotating)
 	{
 		// Check if another service isn't changing something
-		if (!lineContext.changing)
+		if (!context.changing)
 		{
-			// Set cursor to the beggining of the line
-			HD44780SetCursor(line, 0);
+			// Only the cells which differ from the previous position are sent
+			HD44780ScreenRotate(line);
+			HD44780Flush();
 
-			uint8_t index;
-			// Write the entire line
-			for (uint8_t i = 0 ; i < HD44780_COL_COUNT ; i++)
-			{
-				index = ( (i + lineContext.bufferPos) % (lineContext.bufferSize + HD44780_SPACE_BETWEEN_ROTATIONS));
-				if (index < lineContext.bufferSize)
-				{	// If showing the message
-					HD44780WriteData(lineContext.buffer[index]);
-				}
-				else
-				{	// Spaces between the end of the message and the beggining
-					HD44780WriteData(' ');
-				}
-			}
 			// Increment position in the buffer
-			context.lineContexts[line].bufferPos = (lineContext.bufferPos + 1) % (lineContext.bufferSize + HD44780_SPACE_BETWEEN_ROTATIONS);
+			pLineContext->bufferPos = (pLineContext->bufferPos + 1) % (pLineContext->bufferSize + HD44780_SPACE_BETWEEN_ROTATIONS);
 		}
 	}
 	else
 	{ 	// If not rotating, ignore timeout, and stop the timer.
 		// Gets here if another service was used for this line
-		timerPause(lineContext.idTimer);
+		timerPause(pLineContext->idTimer);
 	}
 }
 
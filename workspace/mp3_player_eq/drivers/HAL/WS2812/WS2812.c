@@ -11,6 +11,10 @@
 #include "WS2812.h"
 
 #include "drivers/MCAL/pwm_dma/pwm_dma.h"
+#include "drivers/MCAL/timebase/timebase.h"
+#include "hardware.h"
+
+#include <string.h>
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -26,6 +30,18 @@
 #define WS2812_FTM_MODULO     62                                              // for 800kbps rate needed in WS2812 leds
 #define WS2812_HIGH_DUTY      42                                              // Duty value for '1' binit
 #define WS2812_LOW_DUTY       20                                              // Duty value for '0' binit
+#define WS2812_NIBBLE_WORDS   2                                               // Words of duty values per nibble
+#define WS2812_LEVEL_COUNT    256                                             // Entries of the level table
+#define WS2812_MAX_LED_COUNT  64                                              // Leds of the largest display buffer
+
+#define WS2812_FULL_FRAME_DMA                                                 // Whole display encoded once and sent in a single transfer
+// #define WS2812_BENCHMARK_MODE                                              // Cycles taken by the encoder
+
+// Two duty values packed in a word, the first one sent in the lower halfword
+#define WS2812_DUTY_PAIR(first, second)   ((uint32_t)(first) | ((uint32_t)(second) << 16))
+#define WS2812_DUTY(bit)                  ((bit) ? WS2812_HIGH_DUTY : WS2812_LOW_DUTY)
+#define WS2812_NIBBLE(n)                  { WS2812_DUTY_PAIR(WS2812_DUTY((n) & 0x8), WS2812_DUTY((n) & 0x4)), \
+                                            WS2812_DUTY_PAIR(WS2812_DUTY((n) & 0x2), WS2812_DUTY((n) & 0x1)) }
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -37,9 +53,21 @@ typedef struct {
   ws2812_pixel_t*    buffer;
   size_t      bufferSize;
 
-  /* Controller variables */
-  uint16_t 	  firstFrame[WS2812_FRAME_SIZE];
-  uint16_t    secondFrame[WS2812_FRAME_SIZE];
+  /* Controller variables, word aligned for the encoder */
+#ifdef WS2812_FULL_FRAME_DMA
+  uint16_t    wholeFrame[WS2812_MAX_LED_COUNT * WS2812_LED_SIZE + 1] __attribute__ ((aligned(4)));
+  ws2812_pixel_t lastSent[WS2812_MAX_LED_COUNT];   // Content of the last frame sent, to skip unchanged ones
+  bool        forceUpdate;                        // Frame must be sent even if unchanged
+#else
+  uint16_t 	  firstFrame[WS2812_FRAME_SIZE] __attribute__ ((aligned(4)));
+  uint16_t    secondFrame[WS2812_FRAME_SIZE] __attribute__ ((aligned(4)));
+#endif
+
+  /* Output level of each colour value, brightness and gamma folded together */
+  uint8_t     levels[WS2812_LEVEL_COUNT];
+
+  /* Statistics */
+  ws2812_stats_t stats;
   
   /* Internal controller flags */
   bool alreadyInitialized;
@@ -60,15 +88,39 @@ typedef struct {
  */
 static void pwmUpdateCallback(uint16_t *frameToUpdate, uint8_t frameCounter);
 
+/**
+ * @brief Encodes pixels as the duty values of their bits, in GRB order.
+ * @param duty    Pointer to the first word of the frame
+ * @param pixel   Pointer to the first pixel
+ * @param count   Amount of pixels
+ */
+static void ws2812EncodePixels(uint32_t* duty, const ws2812_pixel_t* pixel, size_t count);
+
+/**
+ * @brief Encodes a colour value as the duty values of its 8 bits, most significant first
+ * @param duty    Pointer to the next word of the frame
+ * @param value   Colour value
+ * @return Pointer to the word after the encoded value
+ */
+static uint32_t* ws2812EncodeByte(uint32_t* duty, uint8_t value);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+// Duty values of the 4 bits of each nibble, in transmission order
+static const uint32_t nibbleDuty[16][WS2812_NIBBLE_WORDS] = {
+  WS2812_NIBBLE(0x0), WS2812_NIBBLE(0x1), WS2812_NIBBLE(0x2), WS2812_NIBBLE(0x3),
+  WS2812_NIBBLE(0x4), WS2812_NIBBLE(0x5), WS2812_NIBBLE(0x6), WS2812_NIBBLE(0x7),
+  WS2812_NIBBLE(0x8), WS2812_NIBBLE(0x9), WS2812_NIBBLE(0xA), WS2812_NIBBLE(0xB),
+  WS2812_NIBBLE(0xC), WS2812_NIBBLE(0xD), WS2812_NIBBLE(0xE), WS2812_NIBBLE(0xF)
+};
+
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static ws2812_context_t context;
+static ws2812_context_t context __SRAM_U_BSS__;    // Frames are read by the DMA
 
 /*******************************************************************************
  *******************************************************************************
@@ -85,6 +137,13 @@ void WS2812Init(void)
     
     // Register callback for buffer update
     pwmdmaOnFrameUpdate(pwmUpdateCallback);
+
+    // Full brightness, colour values are sent as they are
+    WS2812SetBrightness(WS2812_MAX_BRIGHTNESS);
+
+#ifdef WS2812_BENCHMARK_MODE
+    timebaseInit();
+#endif
     
     // Set initialization flag
     context.alreadyInitialized = true;
@@ -93,13 +152,86 @@ void WS2812Init(void)
 
 void WS2812SetDisplayBuffer(ws2812_pixel_t* buffer, size_t size)
 {
+#ifdef WS2812_FULL_FRAME_DMA
+  if (size > WS2812_MAX_LED_COUNT)
+  {
+    size = WS2812_MAX_LED_COUNT;
+  }
+  // Content is compared with the last frame sent, so swapping buffers alone sends nothing
+  if (size != context.bufferSize)
+  {
+    context.forceUpdate = true;
+  }
+#endif
   context.buffer = buffer;
   context.bufferSize = size;
 }
 
 void WS2812Update(void)
 {
+#ifdef WS2812_FULL_FRAME_DMA
+  size_t bufferBytes = context.bufferSize * sizeof(ws2812_pixel_t);
+
+  if (!pwmdmaBusy())
+  {
+    if (!context.forceUpdate && !memcmp(context.lastSent, context.buffer, bufferBytes))
+    {
+      // Nothing changed since the last frame, the leds keep their colour
+      context.stats.framesSkipped++;
+    }
+    else
+    {
+      context.forceUpdate = false;
+      memcpy(context.lastSent, context.buffer, bufferBytes);
+
+#ifdef WS2812_BENCHMARK_MODE
+      uint64_t startCycles = timeNowCycles();
+#endif
+      ws2812EncodePixels((uint32_t*)context.wholeFrame, context.lastSent, context.bufferSize);
+#ifdef WS2812_BENCHMARK_MODE
+      context.stats.encodeCycles = timeNowCycles() - startCycles - timeOverheadCycles();
+#endif
+
+      // The line is left low after the last bit, latching the colours
+      context.wholeFrame[context.bufferSize * WS2812_LED_SIZE] = 0;
+      pwmdmaStartSingle(context.wholeFrame, context.bufferSize * WS2812_LED_SIZE + 1);
+      context.stats.framesSent++;
+    }
+  }
+#else
   pwmdmaStart(context.firstFrame, context.secondFrame, WS2812_FRAME_SIZE, context.bufferSize / WS2812_FRAME_LED_SIZE, false);
+  context.stats.framesSent++;
+#endif
+}
+
+bool WS2812Busy(void)
+{
+  return pwmdmaBusy();
+}
+
+void WS2812SetBrightness(uint8_t brightness)
+{
+  for (uint32_t i = 0 ; i < WS2812_LEVEL_COUNT ; i++)
+  {
+    context.levels[i] = (i * brightness + WS2812_MAX_BRIGHTNESS / 2) / WS2812_MAX_BRIGHTNESS;
+  }
+#ifdef WS2812_FULL_FRAME_DMA
+  context.forceUpdate = true;
+#endif
+}
+
+void WS2812SetLevelTable(const uint8_t levels[256])
+{
+  memcpy(context.levels, levels, WS2812_LEVEL_COUNT);
+#ifdef WS2812_FULL_FRAME_DMA
+  context.forceUpdate = true;
+#endif
+}
+
+void WS2812GetStats(ws2812_stats_t* stats)
+{
+  *stats = context.stats;
+  stats->interrupts = pwmdmaGetInterruptCount();
 }
 
 /*******************************************************************************
@@ -110,31 +242,39 @@ void WS2812Update(void)
 
 static void pwmUpdateCallback(uint16_t *frameToUpdate, uint8_t frameCounter)
 {
-  uint8_t pixelComponents[3];
+#ifdef WS2812_BENCHMARK_MODE
+  uint64_t startCycles = timeNowCycles();
+#endif
 
-  for (uint8_t i = 0 ; i < WS2812_FRAME_LED_SIZE ; i++)
-  {
-    // Decoding current pixel in the frame to be updated
-    ws2812_pixel_t pixel = context.buffer[ i + frameCounter * WS2812_FRAME_LED_SIZE ];
+  ws2812EncodePixels((uint32_t*)frameToUpdate, context.buffer + frameCounter * WS2812_FRAME_LED_SIZE, WS2812_FRAME_LED_SIZE);
 
-    // Using GRB order
-    pixelComponents[0] = pixel.g;
-    pixelComponents[1] = pixel.r;
-    pixelComponents[2] = pixel.b;
+#ifdef WS2812_BENCHMARK_MODE
+  context.stats.encodeCycles = timeNowCycles() - startCycles - timeOverheadCycles();
+#endif
+}
 
-    // Decoding binits to duty value required and updating the next frame
-    for (uint8_t j = 0 ; j < WS2812_LED_RGB_SIZE ; j++)
-    {
-      for (uint8_t k = 0 ; k < 8 ; k++)
-      {
-    	uint16_t aux = (pixelComponents[j] & 0x80) ? WS2812_HIGH_DUTY : WS2812_LOW_DUTY;
-        *(frameToUpdate + i * WS2812_LED_SIZE + j * 8 + k ) = aux;
-        pixelComponents[j] <<= 1;
-      }
-    }
+static void ws2812EncodePixels(uint32_t* duty, const ws2812_pixel_t* pixel, size_t count)
+{
+  for (size_t i = 0 ; i < count ; i++, pixel++)
+  {
+    // Using GRB order, each value mapped through the level table
+    duty = ws2812EncodeByte(duty, context.levels[pixel->g]);
+    duty = ws2812EncodeByte(duty, context.levels[pixel->r]);
+    duty = ws2812EncodeByte(duty, context.levels[pixel->b]);
   }
 }
 
+static uint32_t* ws2812EncodeByte(uint32_t* duty, uint8_t value)
+{
+  const uint32_t* high = nibbleDuty[value >> 4];
+  const uint32_t* low = nibbleDuty[value & 0x0F];
+  duty[0] = high[0];
+  duty[1] = high[1];
+  duty[2] = low[0];
+  duty[3] = low[1];
+  return duty + 2 * WS2812_NIBBLE_WORDS;
+}
+
 /*******************************************************************************
  *******************************************************************************
 						            INTERRUPT SERVICE ROUTINES
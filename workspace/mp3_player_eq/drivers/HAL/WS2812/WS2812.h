@@ -12,6 +12,7 @@
  ******************************************************************************/
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -24,6 +25,14 @@ typedef struct {
   uint8_t b;
 } ws2812_pixel_t;
 
+// Statistics of the frames sent to the leds
+typedef struct {
+  uint32_t framesSent;      // Frames transferred
+  uint32_t framesSkipped;   // Updates skipped because the frame had not changed
+  uint32_t interrupts;      // DMA interrupts served
+  uint32_t encodeCycles;    // Cycles of the last encoding, only with WS2812_BENCHMARK_MODE
+} ws2812_stats_t;
+
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
@@ -35,6 +44,8 @@ typedef struct {
 #define WS2812_COLOR_GREEN    { 0, 50, 0 }
 #define WS2812_COLOR_WHITE    { 50, 50, 50 }
 
+#define WS2812_MAX_BRIGHTNESS 255
+
 /*******************************************************************************
  * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -60,6 +71,31 @@ void WS2812SetDisplayBuffer(ws2812_pixel_t* buffer, size_t size);
  */
 void WS2812Update(void);
 
+/**
+ * @brief Returns whether a frame is being transferred to the leds.
+ */
+bool WS2812Busy(void);
+
+/**
+ * @brief Gets the statistics of the frames sent since initialization.
+ * @param stats   Pointer to store the statistics
+ */
+void WS2812GetStats(ws2812_stats_t* stats);
+
+/**
+ * @brief Sets the brightness of the leds, scaling every colour value sent.
+ *        Replaces any level table set before.
+ * @param brightness  From 0 to WS2812_MAX_BRIGHTNESS, which sends the values as they are
+ */
+void WS2812SetBrightness(uint8_t brightness);
+
+/**
+ * @brief Sets the output level of each colour value, to apply gamma correction
+ *        and brightness together. It is applied when encoding, at no extra cost.
+ * @param levels  Level sent for each colour value
+ */
+void WS2812SetLevelTable(const uint8_t levels[256]);
+
 /*******************************************************************************
  ******************************************************************************/
 
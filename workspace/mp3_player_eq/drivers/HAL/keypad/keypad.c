@@ -12,10 +12,12 @@
 #include "keypad.h"
 #include "../../MCAL/systick/systick.h"
 #include "../../MCAL/gpio/gpio.h"
+#include "../../MCAL/timebase/timebase.h"
 #include "../../../board/board.h"
 #include "../button/button.h"
 #include "../encoder/encoder.h"
 #include "../timer/timer.h"
+#include "hardware.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -25,6 +27,14 @@
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
+// Rotation of an encoder, accumulated by its interrupts until the application takes it
+typedef struct {
+	int32_t		delta;			// Detents since the last take, positive clockwise
+	int8_t		direction;		// Direction of the last detent
+	uint32_t	velocity;		// Average of the detents per second
+	uint64_t	lastDetent;		// Time of the last detent, in core cycles
+} keypad_encoder_context_t;
+
 /*******************************************************************************
  * VARIABLES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -48,6 +58,13 @@ static void onNextButtonPressed(void);
 
 static void onLeftEncoderTimeout(void);
 
+/**
+ * @brief Accumulates a detent of an encoder and updates its velocity estimate.
+ * @param source		Encoder of the keypad
+ * @param direction		Direction of the detent, 1 clockwise and -1 counter clockwise
+ */
+static void keypadRotate(keypad_source_t source, int8_t direction);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
@@ -60,6 +77,7 @@ static keypad_callback_t userCallback;
 static bool alreadyInit = false;
 static bool leftEncoderWasPressed = false;
 static tim_id_t	timerId;
+static keypad_encoder_context_t encoders[KEYPAD_ENCODER_RIGHT + 1];
 
 /*******************************************************************************
  *******************************************************************************
@@ -74,9 +92,10 @@ void keypadInit(void)
 		// Raise the already initialized flag for the keypad driver
 		alreadyInit = true;
 
-		// Initializes the timer
+		// Initializes the timer, and the time base of the velocity estimate
 		timerInit();
 		timerId = timerGetId();
+		timebaseInit();
 
 		// Initializes buttons
 		buttonInit();
@@ -98,6 +117,22 @@ void keypadSubscribe(keypad_callback_t keypadCallback)
 	userCallback = keypadCallback;
 }
 
+keypad_rotation_t keypadTakeRotation(keypad_source_t source)
+{
+	keypad_encoder_context_t* encoder = &encoders[source];
+	keypad_rotation_t rotation;
+	uint32_t primask = __get_PRIMASK();
+
+	// The encoder interrupts would lose a detent between the read and the clear
+	__disable_irq();
+	rotation.delta = encoder->delta;
+	rotation.velocity = encoder->velocity;
+	encoder->delta = 0;
+	__set_PRIMASK(primask);
+
+	return rotation;
+}
+
 /*******************************************************************************
  *******************************************************************************
                         LOCAL FUNCTION DEFINITIONS
@@ -111,6 +146,7 @@ static void onLeftEncoderClockwise(void)
 		.id = KEYPAD_ROTATION_CLKW
 	};
 
+	keypadRotate(KEYPAD_ENCODER_LEFT, 1);
 	if (userCallback)
 	{
 		userCallback(event);
@@ -124,6 +160,7 @@ static void onLeftEncoderCounterClockwise(void)
 		.id = KEYPAD_ROTATION_COUNTER_CLKW
 	};
 
+	keypadRotate(KEYPAD_ENCODER_LEFT, -1);
 	if (userCallback)
 	{
 		userCallback(event);
@@ -158,6 +195,7 @@ static void onRightEncoderClockwise(void)
 		.id = KEYPAD_ROTATION_CLKW
 	};
 
+	keypadRotate(KEYPAD_ENCODER_RIGHT, 1);
 	if (userCallback)
 	{
 		userCallback(event);
@@ -171,6 +209,7 @@ static void onRightEncoderCounterClockwise(void)
 		.id = KEYPAD_ROTATION_COUNTER_CLKW
 	};
 
+	keypadRotate(KEYPAD_ENCODER_RIGHT, -1);
 	if (userCallback)
 	{
 		userCallback(event);
@@ -247,4 +286,29 @@ static void onLeftEncoderTimeout(void)
 	}
 }
 
+static void keypadRotate(keypad_source_t source, int8_t direction)
+{
+	keypad_encoder_context_t* encoder = &encoders[source];
+	uint64_t now = timeNowCycles();
+	uint64_t interval = now - encoder->lastDetent;
+
+	// A pause or a change of direction restarts the estimate, the first rate measured afterwards
+	// seeds it, and the rate of each later detent is averaged with the previous ones
+	if ((interval >= TIMEBASE_US2CYCLES(KEYPAD_VELOCITY_IDLE_MS * 1000ULL)) || (direction != encoder->direction))
+	{
+		encoder->velocity = 0;
+	}
+	else if (encoder->velocity == 0)
+	{
+		encoder->velocity = TIMEBASE_CLOCK_HZ / (uint32_t)interval;
+	}
+	else
+	{
+		encoder->velocity = (encoder->velocity * (KEYPAD_VELOCITY_SMOOTHING - 1) + TIMEBASE_CLOCK_HZ / (uint32_t)interval) / KEYPAD_VELOCITY_SMOOTHING;
+	}
+	encoder->lastDetent = now;
+	encoder->direction = direction;
+	encoder->delta += direction;
+}
+
 /******************************************************************************/
@@ -20,6 +20,8 @@
  ******************************************************************************/
 
 #define KEYPAD_DOUBLE_PRESS_MS		(450)
+#define KEYPAD_VELOCITY_IDLE_MS		(250)		// Pause between detents that restarts the velocity estimate
+#define KEYPAD_VELOCITY_SMOOTHING	(4)			// Detents averaged by the velocity estimate
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -47,6 +49,12 @@ typedef struct {
 	keypad_ev_id_t  id;
 } keypad_events_t;
 
+// Rotation of an encoder since it was last taken
+typedef struct {
+	int32_t		delta;		// Detents rotated, positive clockwise
+	uint32_t	velocity;	// Estimate of the detents per second
+} keypad_rotation_t;
+
 typedef void (*keypad_callback_t)(keypad_events_t);
 
 /*******************************************************************************
@@ -64,4 +72,11 @@ void keypadInit(void);
  */
 void keypadSubscribe(keypad_callback_t keypadCallback);
 
+/**
+ * @brief Takes the rotation of an encoder accumulated since the last call. Rotation events
+ * 		  are raised on every detent, so the consumer can take many detents at once.
+ * @param source	Encoder of the keypad
+ */
+keypad_rotation_t keypadTakeRotation(keypad_source_t source);
+
 #endif /* KEYPAD_H_ */
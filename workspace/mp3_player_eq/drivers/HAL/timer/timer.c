@@ -8,7 +8,10 @@
  * INCLUDE HEADER FILES
  ******************************************************************************/
 #include "timer.h"
-#include "../../MCAL/systick/SysTick.h"
+#include "../../MCAL/systick/systick.h"
+#include "../../MCAL/lptmr/lptmr.h"
+#include "../work_queue/work_queue.h"
+#include "hardware.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -20,20 +23,35 @@
 
 #define TIMER_DEVELOPMENT_MODE    1
 
+// The LPTMR interrupts at the next deadline, instead of the SysTick on every tick. It saves no wakeups
+// while the SysTick keeps running at 1kHz for the buttons, the time base and the scheduler
+// #define TIMER_TICKLESS_MODE
+
+#if defined(TIMER_TICKLESS_MODE) && TIMER_TICK_MS != (1000U/LPTMR_CLOCK_HZ)
+#error Las frecuencias no coinciden!!
+#endif
+
 #define TIMER_ID_INTERNAL   0
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
+/*
+ * Running timers are kept in a list sorted by expiration, where each timer counts
+ * its ticks after the previous one. Only the first timer of the list is decremented
+ * on each tick, and timers expiring together follow it with zero ticks.
+ */
 typedef struct {
 	ttick_t             period;
-	ttick_t             cnt;
+	ttick_t             delta;      // Ticks after the expiration of the previous timer of the list
     tim_callback_t      callback;
+    tim_id_t            next;       // Next timer of the list, TIMER_INVALID_ID for the last one
     uint8_t             mode        : 1;
     uint8_t             running     : 1;
     uint8_t             expired     : 1;
-    uint8_t             unused      : 5;
+    uint8_t             deferred    : 1;    // The callback is posted to the work queue
+    uint8_t             unused      : 4;
 } timer_t;
 
 /*******************************************************************************
@@ -49,6 +67,56 @@ typedef struct {
  */
 static void timer_isr(void);
 
+/**
+ * @brief Begin to run a new timer
+ * @param id ID of the timer to start
+ * @param ticks time until timer expires, in ticks
+ * @param mode SINGLESHOT or PERIODIC
+ * @param callback Function to be call when timer expires
+ * @param deferred Whether the callback is posted to the work queue
+ */
+static void timerConfigure(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback, bool deferred);
+
+/**
+ * @brief Inserts a timer in the list of running timers.
+ * @param id ID of the timer
+ * @param ticks time until the timer expires, in ticks
+ */
+static void timerListInsert(tim_id_t id, ttick_t ticks);
+
+/**
+ * @brief Removes a timer from the list of running timers, if it is in the list.
+ * @param id ID of the timer
+ */
+static void timerListRemove(tim_id_t id);
+
+/**
+ * @brief Counts the elapsed ticks on the list, expiring the timers reached. Called with interrupts masked.
+ * @param elapsed ticks elapsed
+ * @param primask interrupt mask the callbacks are called with
+ * @param deferAll post every callback to the work queue, when not called from the timer interrupt
+ */
+static void timerAdvance(ttick_t elapsed, uint32_t primask, bool deferAll);
+
+#ifdef TIMER_TICKLESS_MODE
+/**
+ * @brief Returns the ticks counted by the LPTMR since the list was last advanced, and moves the base to them.
+ */
+static ttick_t timerElapsed(void);
+#endif
+
+/**
+ * @brief Starts a change of the list of running timers, from outside the timer interrupt.
+ * @return Interrupt mask to be restored when the change ends
+ */
+static uint32_t timerChangeBegin(void);
+
+/**
+ * @brief Ends a change of the list of running timers, programming the next deadline when tickless.
+ * @param primask Interrupt mask returned by timerChangeBegin()
+ */
+static void timerChangeEnd(uint32_t primask);
+
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -60,6 +128,12 @@ static void timer_isr(void);
 
 static timer_t timers[TIMERS_MAX_CANT];
 static tim_id_t timers_cant = TIMER_ID_INTERNAL+1;
+static tim_id_t head = TIMER_INVALID_ID;        // First timer to expire
+static bool     advancing = false;              // Timers are being expired, changes are accounted by timerAdvance()
+
+#ifdef TIMER_TICKLESS_MODE
+static uint16_t base;                           // LPTMR count the list was last advanced to
+#endif
 
 /*******************************************************************************
  *******************************************************************************
@@ -73,7 +147,12 @@ void timerInit(void)
     if (yaInit)
         return;
     
+#ifdef TIMER_TICKLESS_MODE
+    lptmrInit(timer_isr); // init peripheral
+#else
     systickInit(timer_isr); // init peripheral
+#endif
+    workQueueInit();
     
     yaInit = true;
 }
@@ -96,23 +175,12 @@ tim_id_t timerGetId(void)
 
 void timerStart(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback)
 {
-#ifdef TIMER_DEVELOPMENT_MODE
-    if ((id < timers_cant) && (mode < CANT_TIM_MODES))
-#endif // TIMER_DEVELOPMENT_MODE
-    {
-        // disable timer
-        timers[id].running = 0;
-
-        // configure timer
-        timers[id].period = ticks;
-        timers[id].cnt = ticks;
-        timers[id].callback = callback;
-        timers[id].mode = mode;
-        timers[id].expired = 0;
+    timerConfigure(id, ticks, mode, callback, false);
+}
 
-        // enable timer
-        timers[id].running = 1;
-    }
+void timerStartDeferred(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback)
+{
+    timerConfigure(id, ticks, mode, callback, true);
 }
 
 void timerResume(tim_id_t id)
@@ -121,13 +189,17 @@ void timerResume(tim_id_t id)
     if (id < timers_cant)
 #endif // TIMER_DEVELOPMENT_MODE
     {
+        uint32_t primask = timerChangeBegin();
+
         // Si esta pausado el timer
         if (!timers[id].running)
         {
             // Reanudo el timer
-            timers[id].cnt = timers[id].period;
             timers[id].running = 1;
+            timerListInsert(id, timers[id].period);
         }
+
+        timerChangeEnd(primask);
     }
 }
 
@@ -137,11 +209,16 @@ void timerPause(tim_id_t id)
     if (id < timers_cant)
 #endif // TIMER_DEVELOPMENT_MODE
     {
+        uint32_t primask = timerChangeBegin();
+
         // Apago el timer
+        timerListRemove(id);
         timers[id].running = 0;
 
         // y bajo el flag
         timers[id].expired = 0;
+
+        timerChangeEnd(primask);
     }
 }
 
@@ -151,15 +228,20 @@ void timerRestart(tim_id_t id)
     if (id < timers_cant)
 #endif // TIMER_DEVELOPMENT_MODE
     {
+        uint32_t primask = timerChangeBegin();
+
         // disable timer
+        timerListRemove(id);
         timers[id].running = 0;
 
         // configure timer
-        timers[id].cnt = timers[id].period;
         timers[id].expired = 0;
 
         // enable timer
         timers[id].running = 1;
+        timerListInsert(id, timers[id].period);
+
+        timerChangeEnd(primask);
     }
 }
 
@@ -191,43 +273,208 @@ void timerDelay(ttick_t ticks)
  *******************************************************************************
  ******************************************************************************/
 
+static void timerConfigure(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback, bool deferred)
+{
+#ifdef TIMER_DEVELOPMENT_MODE
+    if ((id < timers_cant) && (mode < CANT_TIM_MODES))
+#endif // TIMER_DEVELOPMENT_MODE
+    {
+        uint32_t primask = timerChangeBegin();
+
+        // disable timer
+        timerListRemove(id);
+        timers[id].running = 0;
+
+        // configure timer
+        timers[id].period = ticks;
+        timers[id].callback = callback;
+        timers[id].mode = mode;
+        timers[id].deferred = deferred;
+        timers[id].expired = 0;
+
+        // enable timer
+        timers[id].running = 1;
+        timerListInsert(id, ticks);
+
+        timerChangeEnd(primask);
+    }
+}
+
 static void timer_isr(void)
 {
-    // decremento los timers activos
-    uint8_t timerIndex;
-    for (timerIndex = 0 ; timerIndex < timers_cant ; timerIndex++)
+    // The ticks are taken and the list is advanced with interrupts masked, so a change made
+    // by a higher priority interrupt never accounts them again
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+#ifdef TIMER_TICKLESS_MODE
+    // The compare was reached, or raised early, the counter tells the ticks elapsed
+    ttick_t elapsed = timerElapsed();
+#else
+    // Only the first timer of the list is decremented
+    ttick_t elapsed = 1;
+#endif
+
+    advancing = true;
+    timerAdvance(elapsed, primask, false);
+    advancing = false;
+
+    timerChangeEnd(primask);
+}
+
+static void timerAdvance(ttick_t elapsed, uint32_t primask, bool deferAll)
+{
+    // Interrupts calling timerStart() can't change the list while it is being walked
+    while (head != TIMER_INVALID_ID)
     {
+        tim_id_t timerIndex = head;
         timer_t* currentTimer = &timers[timerIndex];
-        if (currentTimer->running)
+
+        if (currentTimer->delta > elapsed)
         {
-            currentTimer->cnt--;
-            // si hubo timeout!
-            if (currentTimer->cnt == 0)
-            {
-            	// Important: first update state so that if timerStart()
-				// is called in the callback, this block doesn't deletes
-            	// the configuration
-                // 1) update state
-                if (currentTimer->mode == TIM_MODE_SINGLESHOT)
-                {
-                    currentTimer->expired = 1;
-                    currentTimer->running = 0;
-                }
-                else
-                {
-                    currentTimer->cnt = currentTimer->period;
-                    currentTimer->expired = 1;
-                }
-
-            	// 2) execute action: callback or set flag
-                if (currentTimer->callback)
-                {
-                    currentTimer->callback();
-                }
+            currentTimer->delta -= elapsed;
+            break;
+        }
+
+        // si hubo timeout!
+        elapsed -= currentTimer->delta;
+        head = currentTimer->next;
+
+        // Important: first update state so that if timerStart()
+        // is called in the callback, this block doesn't deletes
+        // the configuration
+        // 1) update state
+        if (currentTimer->mode == TIM_MODE_SINGLESHOT)
+        {
+            currentTimer->expired = 1;
+            currentTimer->running = 0;
+        }
+        else
+        {
+            currentTimer->expired = 1;
+            timerListInsert(timerIndex, currentTimer->period);
+        }
 
+        // 2) execute action: callback or set flag
+        if (currentTimer->callback && (currentTimer->deferred || deferAll))
+        {
+            workQueuePost(currentTimer->callback);
+        }
+        else if (currentTimer->callback)
+        {
+            // Called with the interrupts of the timer interrupt, the list is consistent here
+            __set_PRIMASK(primask);
+            currentTimer->callback();
+            __disable_irq();
+        }
+    }
+}
+
+static void timerListInsert(tim_id_t id, ttick_t ticks)
+{
+    tim_id_t* link = &head;
+
+    // A timer can't expire in the current tick
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+
+    // After the timers expiring before or together with it
+    while ((*link != TIMER_INVALID_ID) && (timers[*link].delta <= ticks))
+    {
+        ticks -= timers[*link].delta;
+        link = &timers[*link].next;
+    }
+
+    timers[id].delta = ticks;
+    timers[id].next = *link;
+    if (*link != TIMER_INVALID_ID)
+    {
+        timers[*link].delta -= ticks;
+    }
+    *link = id;
+}
+
+static void timerListRemove(tim_id_t id)
+{
+    tim_id_t* link = &head;
+
+    while ((*link != TIMER_INVALID_ID) && (*link != id))
+    {
+        link = &timers[*link].next;
+    }
+
+    if (*link == id)
+    {
+        // The next timer keeps its expiration
+        *link = timers[id].next;
+        if (*link != TIMER_INVALID_ID)
+        {
+            timers[*link].delta += timers[id].delta;
+        }
+    }
+}
+
+#ifdef TIMER_TICKLESS_MODE
+static ttick_t timerElapsed(void)
+{
+    uint16_t count = lptmrCount();
+    ttick_t elapsed = (uint16_t)(count - base);
+
+    base = count;
+    return elapsed;
+}
+#endif
+
+static uint32_t timerChangeBegin(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+#ifdef TIMER_TICKLESS_MODE
+    // Account the ticks counted since the list was last advanced, a compare found pending
+    // is served here and its interrupt is cleared when the next deadline is programmed.
+    // The caller may be in the middle of its own work, or in an interrupt, so the timers
+    // expired here have their callbacks posted to the work queue.
+    if (!advancing)
+    {
+        ttick_t elapsed = timerElapsed();
+        advancing = true;
+        timerAdvance(elapsed, primask, true);
+        advancing = false;
+    }
+#endif
+
+    return primask;
+}
+
+static void timerChangeEnd(uint32_t primask)
+{
+#ifdef TIMER_TICKLESS_MODE
+    // Program the first deadline, changes made while expiring timers are programmed afterwards
+    if (!advancing)
+    {
+        if (head == TIMER_INVALID_ID)
+        {
+            lptmrCancel();
+        }
+        else
+        {
+            // From the count the list was advanced to, the ticks counted since are not lost
+            ttick_t ticks = timers[head].delta < LPTMR_MAX_TICKS ? timers[head].delta : LPTMR_MAX_TICKS;
+            lptmrSetCompare((uint16_t)(base + ticks));
+
+            // A deadline reached while being programmed is not compared until the counter wraps around
+            if ((uint16_t)(lptmrCount() - base) >= ticks)
+            {
+                lptmrRaise();
             }
         }
     }
+#endif
+
+    __set_PRIMASK(primask);
 }
 
 /******************************************************************************/
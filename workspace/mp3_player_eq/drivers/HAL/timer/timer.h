@@ -72,6 +72,17 @@ tim_id_t timerGetId(void);
 void timerStart(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback);
 
 
+/**
+ * @brief Begin to run a new timer, whose callback is posted to the work queue
+ *        instead of being called from the timer interrupt
+ * @param id ID of the timer to start
+ * @param ticks time until timer expires, in ticks
+ * @param mode SINGLESHOT or PERIODIC
+ * @param callback Function to be run by the work queue when timer expires
+ */
+void timerStartDeferred(tim_id_t id, ttick_t ticks, uint8_t mode, tim_callback_t callback);
+
+
 /**
  * @brief Finish to run a timer
  * @param id ID of the timer to stop
@@ -0,0 +1,145 @@
+/***************************************************************************//**
+  @file     trace.c
+  @brief    Trace of timestamped records, written from interrupts and the main loop
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "trace.h"
+#include "../../MCAL/timebase/timebase.h"
+#include "hardware.h"
+
+#include <stdio.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TRACE_MASK          (TRACE_SIZE - 1)
+
+#if (TRACE_SIZE & TRACE_MASK) != 0
+#error TRACE_SIZE must be a power of two
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * The trace always runs, overwriting its oldest records, so that the last
+ * moments before a glitch can be dumped. A record is written with interrupts
+ * masked, for a few cycles, so the order of the records is their time order.
+ */
+typedef struct {
+#ifdef TRACE_ENABLED
+  trace_record_t      records[TRACE_SIZE];
+#endif
+  uint32_t            head;               // Records written since initialization
+  volatile bool       dumpRequested;
+  volatile bool       dumping;            // Records are not written while dumping
+  bool                alreadyInit;
+} trace_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static trace_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void traceInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+    // Time base, for the timestamp of the records
+    timebaseInit();
+  }
+}
+
+void traceRecord(trace_id_t id, uint16_t arg, uint32_t payload)
+{
+#ifdef TRACE_ENABLED
+  uint32_t primask = __get_PRIMASK();
+  trace_record_t* record;
+
+  __disable_irq();
+  if (!context.dumping)
+  {
+    record = &context.records[context.head++ & TRACE_MASK];
+    record->timestamp = timeNowCycles();
+    record->id = id;
+    record->arg = arg;
+    record->payload = payload;
+  }
+  __set_PRIMASK(primask);
+#endif
+}
+
+void traceRequestDump(void)
+{
+  context.dumpRequested = true;
+}
+
+void traceRun(void)
+{
+  if (context.dumpRequested)
+  {
+    context.dumpRequested = false;
+    traceDump();
+  }
+}
+
+void traceDump(void)
+{
+#ifdef TRACE_ENABLED
+  trace_record_t* record;
+  uint32_t first;
+
+  context.dumping = true;
+
+  // Read by trace_report.py, the timestamp is printed as two words for printf
+  // implementations without 64 bits support
+  first = context.head > TRACE_SIZE ? context.head - TRACE_SIZE : 0;
+  printf("trace begin %lu %lu\n", (unsigned long)TIMEBASE_CLOCK_HZ, (unsigned long)(context.head - first));
+  for (uint32_t i = first ; i != context.head ; i++)
+  {
+    record = &context.records[i & TRACE_MASK];
+    printf("%08lx%08lx %u %u %08lx\n",
+           (unsigned long)(record->timestamp >> 32), (unsigned long)(record->timestamp & 0xFFFFFFFF),
+           (unsigned)record->id, (unsigned)record->arg, (unsigned long)record->payload);
+  }
+  printf("trace end %lu\n", (unsigned long)first);
+
+  context.dumping = false;
+#endif
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
@@ -0,0 +1,135 @@
+/***************************************************************************//**
+  @file     trace.h
+  @brief    Trace of timestamped records, written from interrupts and the main loop
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef HAL_TRACE_TRACE_H_
+#define HAL_TRACE_TRACE_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TRACE_SIZE                  256         // Records kept, the oldest are overwritten, must be a power of two
+
+// Subsystems traced, the trace points of the others are compiled out
+#define TRACE_ENABLE_EVENTS                     // Events raised, dropped and dispatched
+#define TRACE_ENABLE_AUDIO                      // DAC buffers played and refilled
+#define TRACE_ENABLE_UI                         // Strings written to the LCD
+// #define TRACE_ENABLE_WORK_QUEUE              // Deferred work run
+#define TRACE_ENABLE_SCHEDULER                  // Tasks run over their budget
+
+#if defined(TRACE_ENABLE_EVENTS) || defined(TRACE_ENABLE_AUDIO) || defined(TRACE_ENABLE_UI) || defined(TRACE_ENABLE_WORK_QUEUE) || \
+    defined(TRACE_ENABLE_SCHEDULER)
+#define TRACE_ENABLED
+#endif
+
+#ifdef TRACE_ENABLE_EVENTS
+#define TRACE_EVENTS(id, arg, payload)      traceRecord((id), (arg), (payload))
+#else
+#define TRACE_EVENTS(id, arg, payload)
+#endif
+
+#ifdef TRACE_ENABLE_AUDIO
+#define TRACE_AUDIO(id, arg, payload)       traceRecord((id), (arg), (payload))
+#else
+#define TRACE_AUDIO(id, arg, payload)
+#endif
+
+#ifdef TRACE_ENABLE_UI
+#define TRACE_UI(id, arg, payload)          traceRecord((id), (arg), (payload))
+#else
+#define TRACE_UI(id, arg, payload)
+#endif
+
+#ifdef TRACE_ENABLE_WORK_QUEUE
+#define TRACE_WORK_QUEUE(id, arg, payload)  traceRecord((id), (arg), (payload))
+#else
+#define TRACE_WORK_QUEUE(id, arg, payload)
+#endif
+
+#ifdef TRACE_ENABLE_SCHEDULER
+#define TRACE_SCHEDULER(id, arg, payload)   traceRecord((id), (arg), (payload))
+#else
+#define TRACE_SCHEDULER(id, arg, payload)
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Trace points, miscellaneous/Trace/trace_report.py reads their names from here
+typedef enum {
+  TRACE_EVENT_RAISED,           // Event pushed by an interrupt, arg is its class in the upper byte and the event in the lower one
+  TRACE_EVENT_DROPPED,          // Event lost because its ring was full, arg as raised
+  TRACE_EVENT_DISPATCHED,       // Event taken by the main loop, arg as raised and payload is its latency in cycles
+  TRACE_AUDIO_FRAME_FINISHED,   // DAC buffer played, payload is the frame to be refilled
+  TRACE_AUDIO_REFILL_BEGIN,     // Decoding of a frame started, payload is the frame
+  TRACE_AUDIO_REFILL_END,       // Frame ready to be played, payload is the frame
+  TRACE_UI_LCD_WRITE,           // String written to the LCD, arg is the line
+  TRACE_WORK_BEGIN,             // Deferred work started, payload is the work
+  TRACE_WORK_END,               // Deferred work finished, payload is the work
+  TRACE_TASK_OVER_BUDGET,       // Task still running past its budget, found by the SysTick, arg is the task and payload the cycles so far
+  TRACE_TASK_OVERRUN,           // Task run over its budget, arg is the task and payload the cycles it took
+
+  TRACE_ID_COUNT
+} trace_id_t;
+
+typedef struct {
+  uint64_t    timestamp;        // Time base, in core cycles
+  uint16_t    id;               // Trace point
+  uint16_t    arg;
+  uint32_t    payload;
+} trace_record_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the trace, and the time base of its records.
+ */
+void traceInit(void);
+
+/**
+ * @brief Writes a record to the trace. Can be called from any interrupt or from the
+ *        application, use the macro of the subsystem so that it can be compiled out.
+ * @param id        Trace point
+ * @param arg       Argument of the trace point
+ * @param payload   Payload of the trace point
+ */
+void traceRecord(trace_id_t id, uint16_t arg, uint32_t payload);
+
+/**
+ * @brief Requests a dump of the trace, done by the next traceRun(). Can be called from
+ *        an interrupt, or from the debugger with "call traceRequestDump()".
+ */
+void traceRequestDump(void);
+
+/**
+ * @brief Dumps the trace when requested. Called from the main loop.
+ */
+void traceRun(void);
+
+/**
+ * @brief Prints the records of the trace, oldest first, through the semihosting
+ *        console. Nothing is recorded while dumping.
+ */
+void traceDump(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* HAL_TRACE_TRACE_H_ */
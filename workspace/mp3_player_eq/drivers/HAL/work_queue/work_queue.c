@@ -0,0 +1,264 @@
+/***************************************************************************//**
+  @file     work_queue.c
+  @brief    Deferred work queue, runs the work posted by interrupts out of them
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "work_queue.h"
+#include "../../MCAL/timebase/timebase.h"
+#include "../trace/trace.h"
+#include "hardware.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// #define WORK_QUEUE_PENDSV        // Work is run by the PendSV exception, which still preempts the main loop
+
+#define WORK_QUEUE_MASK     (WORK_QUEUE_SIZE - 1)
+
+#if (WORK_QUEUE_SIZE & WORK_QUEUE_MASK) != 0
+#error WORK_QUEUE_SIZE must be a power of two
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * Producers reserve a slot moving the tail with LDREX/STREX, so any interrupt can
+ * post while another one is posting, and mark it as ready once it is written.
+ * The consumer stops at the first slot not ready yet, and releases each slot
+ * before moving the head, which is only written by it.
+ */
+typedef struct {
+  work_callback_t           work;
+  uint64_t                  postedCycles;     // Time base when posted
+  volatile bool             ready;            // Written by the producer, the consumer can take it
+} work_item_t;
+
+typedef struct {
+  work_item_t               items[WORK_QUEUE_SIZE];
+  volatile uint32_t         head;             // Next item to be run
+  volatile uint32_t         tail;             // Next slot to be reserved
+  work_queue_stats_t        stats;
+  bool                      alreadyInit;
+} work_queue_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Runs the work waiting in the queue.
+ * @param maxWork       Most work to be run
+ * @param budgetCycles  Time the run must end within, the work that would not fit waits for the next run
+ * @return True if any work was run
+ */
+static bool workQueueDrain(uint32_t maxWork, uint64_t budgetCycles);
+
+/**
+ * @brief Increments a counter shared by interrupts of different priorities.
+ * @param counter   Counter to be incremented
+ */
+static void workQueueIncrement(volatile uint32_t* counter);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static work_queue_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void workQueueInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+    context.stats.latencyMin = UINT32_MAX;
+
+    // Time base, to measure the latency of the work
+    timebaseInit();
+
+#ifdef WORK_QUEUE_PENDSV
+    // Lowest priority, the work never preempts an interrupt
+    NVIC_SetPriority(PendSV_IRQn, (1U << __NVIC_PRIO_BITS) - 1U);
+#endif
+  }
+}
+
+bool workQueuePost(work_callback_t work)
+{
+  work_item_t* item;
+  uint32_t tail;
+
+  // The work is not run again while it waits, it will see whatever was changed before posting it
+  for (uint32_t i = context.head ; i != context.tail ; i++)
+  {
+    item = &context.items[i & WORK_QUEUE_MASK];
+    if (item->ready && item->work == work)
+    {
+      workQueueIncrement(&context.stats.coalesced);
+      return true;
+    }
+  }
+
+  // Reserve a slot, retried when another interrupt reserved one in the meantime
+  do
+  {
+    tail = __LDREXW(&context.tail);
+    if (tail - context.head >= WORK_QUEUE_SIZE)
+    {
+      __CLREX();
+      workQueueIncrement(&context.stats.dropped);
+      return false;
+    }
+  } while (__STREXW(tail + 1, &context.tail));
+
+  // Write it, and only then let the consumer take it
+  item = &context.items[tail & WORK_QUEUE_MASK];
+  item->work = work;
+  item->postedCycles = timeNowCycles();
+  __DMB();
+  item->ready = true;
+
+#ifdef WORK_QUEUE_PENDSV
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#endif
+
+  return true;
+}
+
+bool workQueueRun(void)
+{
+#ifndef WORK_QUEUE_PENDSV
+  return workQueueDrain(WORK_QUEUE_RUN_MAX, TIMEBASE_US2CYCLES(WORK_QUEUE_RUN_US));
+#else
+  return false;
+#endif
+}
+
+work_queue_stats_t workQueueGetStats(void)
+{
+  return context.stats;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static bool workQueueDrain(uint32_t maxWork, uint64_t budgetCycles)
+{
+  work_item_t* item;
+  work_callback_t work;
+  uint32_t latency;
+  uint32_t head = context.head;
+  uint32_t pending = context.tail - head;
+  uint64_t start = timeNowCycles();
+  uint64_t now;
+  uint64_t elapsed;
+  bool ran = false;
+
+  if (pending > context.stats.maxPending)
+  {
+    context.stats.maxPending = pending;
+  }
+
+  while (head != context.tail)
+  {
+    // A producer preempted while writing its slot runs the queue again when it finishes
+    item = &context.items[head & WORK_QUEUE_MASK];
+    if (!item->ready)
+    {
+      break;
+    }
+
+    // The work left, including the one posted while running, waits for the next run. The cost of a
+    // work is only known once run, so the budget must leave room for the longest one
+    now = timeNowCycles();
+    elapsed = now - start;
+    if (!maxWork-- || (ran && ((elapsed >= budgetCycles) || (budgetCycles - elapsed < context.stats.longestWork))))
+    {
+      context.stats.yielded++;
+      break;
+    }
+
+    // Take the work and release the slot
+    work = item->work;
+    latency = now - item->postedCycles;
+    item->ready = false;
+    __DMB();
+    context.head = ++head;
+
+    // Statistics
+    context.stats.run++;
+    context.stats.latencyLast = latency;
+    context.stats.latencyTotal += latency;
+    if (latency < context.stats.latencyMin)
+    {
+      context.stats.latencyMin = latency;
+    }
+    if (latency > context.stats.latencyMax)
+    {
+      context.stats.latencyMax = latency;
+    }
+
+    TRACE_WORK_QUEUE(TRACE_WORK_BEGIN, 0, (uint32_t)(uintptr_t)work);
+    work();
+    TRACE_WORK_QUEUE(TRACE_WORK_END, 0, (uint32_t)(uintptr_t)work);
+    ran = true;
+
+    // Including the taking of the work, all of it happens within the budget
+    elapsed = timeNowCycles() - now;
+    if (elapsed > context.stats.longestWork)
+    {
+      context.stats.longestWork = elapsed;
+    }
+  }
+
+  return ran;
+}
+
+static void workQueueIncrement(volatile uint32_t* counter)
+{
+  uint32_t value;
+  do
+  {
+    value = __LDREXW(counter) + 1;
+  } while (__STREXW(value, counter));
+}
+
+/*******************************************************************************
+ *******************************************************************************
+						            INTERRUPT SERVICE ROUTINES
+ *******************************************************************************
+ ******************************************************************************/
+
+#ifdef WORK_QUEUE_PENDSV
+__ISR__ PendSV_Handler(void)
+{
+  // Preempted by every interrupt, it runs all the work
+  workQueueDrain(UINT32_MAX, UINT64_MAX);
+}
+#endif
+
+/******************************************************************************/
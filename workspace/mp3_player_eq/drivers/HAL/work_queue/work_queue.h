@@ -0,0 +1,87 @@
+/***************************************************************************//**
+  @file     work_queue.h
+  @brief    Deferred work queue, runs the work posted by interrupts out of them
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef HAL_WORK_QUEUE_WORK_QUEUE_H_
+#define HAL_WORK_QUEUE_WORK_QUEUE_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define WORK_QUEUE_SIZE     16          // Work waiting to be run, must be a power of two
+#define WORK_QUEUE_RUN_US   2000        // Time after which workQueueRun() leaves the work left for its next call
+#define WORK_QUEUE_RUN_MAX  WORK_QUEUE_SIZE // Most work run by each call to workQueueRun()
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Work to be run, posted by an interrupt or by the application
+typedef void (*work_callback_t)(void);
+
+// Statistics of the work run, latencies are measured in core cycles from the post to the run
+typedef struct {
+  uint32_t    run;                // Work run
+  uint32_t    coalesced;          // Posts of a work already waiting in the queue
+  uint32_t    dropped;            // Posts lost because the queue was full
+  uint32_t    maxPending;         // Most work found waiting in the queue
+  uint32_t    yielded;            // Calls to workQueueRun() that left work waiting, for its budget
+  uint32_t    longestWork;        // Cycles taken by the longest work run, the budget leaves room for it
+  uint32_t    latencyLast;
+  uint32_t    latencyMin;
+  uint32_t    latencyMax;
+  uint64_t    latencyTotal;       // Divided by run gives the average latency
+} work_queue_stats_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the work queue, and the time base used to measure its latency.
+ */
+void workQueueInit(void);
+
+/**
+ * @brief Posts a work to be run out of the current interrupt. Can be called from any
+ *        interrupt or from the application, without disabling interrupts.
+ *        A work already waiting in the queue is not posted again, it runs once.
+ * @param work    Work to be run
+ * @return True if the work is waiting in the queue, false if the queue was full
+ */
+bool workQueuePost(work_callback_t work);
+
+/**
+ * @brief Runs the work waiting in the queue, in the order it was posted. Called from the
+ *        main loop, does nothing when the work is run by the PendSV exception.
+ *        Stops after WORK_QUEUE_RUN_MAX works, or before a work as long as the longest
+ *        one run would end after WORK_QUEUE_RUN_US, so a burst of work or a work posting
+ *        itself can't hold the main loop. The call keeps the budget, unless the first
+ *        work of the call or one longer than any before runs over it.
+ * @return True if any work was run
+ */
+bool workQueueRun(void);
+
+/**
+ * @brief Returns the statistics of the work run since initialization.
+ */
+work_queue_stats_t workQueueGetStats(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* HAL_WORK_QUEUE_WORK_QUEUE_H_ */
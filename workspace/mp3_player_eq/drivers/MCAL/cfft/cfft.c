@@ -1,5 +1,5 @@
 /***************************************************************************//**
-  @file     equaliser.c
+  @file     cfft.c
   @brief    ...
   @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
  ******************************************************************************/
@@ -10,7 +10,7 @@
 
 #include "cfft.h"
 #include "arm_const_structs.h"
-#include <stdio.h>
+#include <string.h>
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -30,6 +30,7 @@
 
 static arm_cfft_instance_f32 * cfftSizeToInstance(cfft_size_t size);
 static uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance);
+static uint32_t cfftSizeToLength(cfft_size_t size);
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -40,6 +41,8 @@ static uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance);
  ******************************************************************************/
 
 arm_cfft_instance_f32 * cfftInstance;
+static arm_rfft_fast_instance_f32 rfftInstance;
+static arm_rfft_instance_q15 rfftInstanceQ15;
 
 /*******************************************************************************
  *******************************************************************************
@@ -69,6 +72,52 @@ void cfftGetMag(float32_t * inputF32, float32_t * outputF32)
   arm_cmplx_mag_f32(inputF32, outputF32, cfftInstanceToSize(cfftInstance));
 }
 
+bool rfftInit(cfft_size_t size)
+{
+  return arm_rfft_fast_init_f32(&rfftInstance, cfftSizeToLength(size)) == ARM_MATH_SUCCESS;
+}
+
+void rfft(float32_t * inputF32, float32_t * outputF32)
+{
+  arm_rfft_fast_f32(&rfftInstance, inputF32, outputF32, false);
+}
+
+void rfftGetMagBins(float32_t * spectrumF32, const uint32_t * bins, uint32_t binCount, float32_t * outputF32)
+{
+  uint32_t halfSize = rfftInstance.fftLenRFFT / 2;
+  float32_t re, im;
+
+  for (uint32_t i = 0 ; i < binCount ; i++)
+  {
+    if (bins[i] == 0)
+    {
+      // DC is packed in the real part of the first bin
+      outputF32[i] = fabsf(spectrumF32[0]);
+    }
+    else if (bins[i] >= halfSize)
+    {
+      // Nyquist is packed in the imaginary part of the first bin
+      outputF32[i] = fabsf(spectrumF32[1]);
+    }
+    else
+    {
+      re = spectrumF32[2 * bins[i]];
+      im = spectrumF32[2 * bins[i] + 1];
+      arm_sqrt_f32(re * re + im * im, &outputF32[i]);
+    }
+  }
+}
+
+bool rfftInitQ15(cfft_size_t size)
+{
+  return arm_rfft_init_q15(&rfftInstanceQ15, cfftSizeToLength(size), false, true) == ARM_MATH_SUCCESS;
+}
+
+void rfftQ15(q15_t * inputQ15, q15_t * outputQ15)
+{
+  arm_rfft_q15(&rfftInstanceQ15, inputQ15, outputQ15);
+}
+
 /*******************************************************************************
  *******************************************************************************
                         LOCAL FUNCTION DEFINITIONS
@@ -111,6 +160,11 @@ uint32_t cfftInstanceToSize(arm_cfft_instance_f32 * instance)
   return size;
 }
 
+uint32_t cfftSizeToLength(cfft_size_t size)
+{
+  return 16UL << size;
+}
+
 /*******************************************************************************
  *******************************************************************************
 						            INTERRUPT SERVICE ROUTINES
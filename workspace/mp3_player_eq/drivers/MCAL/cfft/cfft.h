@@ -1,5 +1,5 @@
 /***************************************************************************//**
-  @file     equaliser.h
+  @file     cfft.h
   @brief    ...
   @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
  ******************************************************************************/
@@ -72,6 +72,48 @@ void icfft(float32_t * inputF32, float32_t * outputF32, bool doBitReverse);
  */
 void cfftGetMag(float32_t * inputF32, float32_t * outputF32);
 
+/**
+ * @brief Initialises the real FFT. Real FFT sizes start at CFFT_32.
+ * @param size  Size of the real FFT to compute, in real samples.
+ * @return True if the size is supported.
+ */
+bool rfftInit(cfft_size_t size);
+
+/**
+ * @brief Compute the FFT of the real data given. The input buffer is used as
+ *        scratch and is modified. The output holds size/2 complex bins, where the
+ *        real part of the first one is the DC bin and its imaginary part is the
+ *        real valued bin at size/2.
+ * @param inputF32      Buffer with size real input samples.
+ * @param outputF32     Buffer to store the size output values.
+ */
+void rfft(float32_t * inputF32, float32_t * outputF32);
+
+/**
+ * @brief Compute the magnitude of only the requested bins of a real FFT output.
+ * @param spectrumF32   Output of the real FFT.
+ * @param bins          Index of the bins to compute, from 0 to size/2.
+ * @param binCount      Amount of bins requested.
+ * @param outputF32     Buffer to store the binCount magnitudes.
+ */
+void rfftGetMagBins(float32_t * spectrumF32, const uint32_t * bins, uint32_t binCount, float32_t * outputF32);
+
+/**
+ * @brief Initialises the Q15 real FFT. Real FFT sizes start at CFFT_32.
+ * @param size  Size of the real FFT to compute, in real samples.
+ * @return True if the size is supported.
+ */
+bool rfftInitQ15(cfft_size_t size);
+
+/**
+ * @brief Compute the FFT of the real Q15 data given. The input buffer is used as
+ *        scratch and is modified. The output is downscaled by the FFT size, and
+ *        holds the size complex bins of the spectrum.
+ * @param inputQ15      Buffer with size real input samples.
+ * @param outputQ15     Buffer to store the 2 * size output values.
+ */
+void rfftQ15(q15_t * inputQ15, q15_t * outputQ15);
+
 /*******************************************************************************
  ******************************************************************************/
 
@@ -67,7 +67,7 @@ static void onMajorLoop(void);
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static dacdma_context_t dacdmaContext;
+static dacdma_context_t dacdmaContext __SRAM_U_BSS__;    // Holds the TCDs read by the DMA
 
 /*******************************************************************************
  *******************************************************************************
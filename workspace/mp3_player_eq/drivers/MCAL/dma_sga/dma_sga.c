@@ -121,6 +121,11 @@ __ISR__ DMA0_IRQHandler(void)
   DMA_IRQDispatcher(DMA_CHANNEL_0);
 }
 
+__ISR__ DMA2_IRQHandler(void)
+{
+  DMA_IRQDispatcher(DMA_CHANNEL_2);
+}
+
 void DMA_IRQDispatcher(uint8_t channel)
 {
   uint16_t status = DMA0->INT;
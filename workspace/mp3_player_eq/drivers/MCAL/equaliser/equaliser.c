@@ -18,6 +18,9 @@
 
 #define BLOCK_SIZE          32
 #define NUM_TAPS            65
+#define NUM_TAPS_Q15        66    // arm_fir_init_q15 only accepts an even number of taps, the first one is zero
+
+#define Q15_MAX_SHIFT       7     // Maximum headroom (in bits) reserved for the combined Q15 coefficients
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -31,6 +34,12 @@
  * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+/**
+ * @brief Computes the coefficients of the single FIR filter equivalent to the
+ *        parallel bandpass bank, weighting each band with its current gain.
+ *        Updates both the floating point and the Q15 coefficients.
+ */
+static void eqUpdateCoefficients(void);
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -43,9 +52,11 @@
 static uint32_t eqFrameSize;
 static uint32_t blockSize = BLOCK_SIZE;
 
-static float32_t firStateF32[BLOCK_SIZE + NUM_TAPS - 1];      // State of the FIR filter. Needed for initialisation.
+static float32_t firStateF32[BLOCK_SIZE + NUM_TAPS - 1];      // State of the floating point FIR filter.
+static q15_t firStateQ15[NUM_TAPS_Q15 + BLOCK_SIZE];          // State of the Q15 FIR filter, arm_fir_init_q15() clears numTaps + blockSize.
 
-arm_fir_instance_f32 parallelFilter[BLOCK_SIZE];       // EQ filter implemented as parallel bandpass FIR filters.
+static arm_fir_instance_f32 eqFilterF32;                      // EQ filter, the parallel bandpass bank collapsed into one FIR filter.
+static arm_fir_instance_q15 eqFilterQ15;                      // Q15 version of the same EQ filter.
 
 static const float32_t eqFirCoeffs32[EQ_NUM_OF_FILTERS][NUM_TAPS] __attribute__((aligned(32))) =     // Coefficients of each bandpass FIR filter. Computed with MATLAB.
 {
@@ -64,7 +75,11 @@ static float32_t eqGains32[EQ_NUM_OF_FILTERS] =                  // Multiplier o
   1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f
 };
 
-static float32_t outputAux[NUM_TAPS];
+// Coefficients of the combined filter, sum of each band coefficients weighted by its gain.
+// Q15 coefficients are scaled down by 2^eqShiftQ15 to fit in [-1, 1), output is scaled back up.
+static float32_t eqCoeffsF32[NUM_TAPS] __attribute__((aligned(32)));
+static q15_t eqCoeffsQ15[NUM_TAPS_Q15] __attribute__((aligned(32)));
+static int8_t eqShiftQ15;
 
 /*******************************************************************************
  *******************************************************************************
@@ -74,11 +89,12 @@ static float32_t outputAux[NUM_TAPS];
 
 void eqInit(uint32_t frameSize)
 {	
-	// Call FIR init function to initialise the instance structure.
-	for (uint32_t j=0; j < EQ_NUM_OF_FILTERS; j++)
-	{
-		arm_fir_init_f32(&(parallelFilter[j]), NUM_TAPS, (float32_t *)&eqFirCoeffs32[0], &firStateF32[0], blockSize);
-	}
+	// Compute the combined filter for the default gains
+	eqUpdateCoefficients();
+
+	// Call FIR init functions to initialise the instance structures.
+	arm_fir_init_f32(&eqFilterF32, NUM_TAPS, eqCoeffsF32, firStateF32, blockSize);
+	arm_fir_init_q15(&eqFilterQ15, NUM_TAPS_Q15, eqCoeffsQ15, firStateQ15, blockSize);
 
   eqFrameSize = frameSize;
 }
@@ -88,14 +104,22 @@ void eqFilterFrame(float32_t * inputF32, float32_t * outputF32)
 	// Call the FIR process function for every blockSize samples.
 	for (uint32_t i=0; i < eqFrameSize/BLOCK_SIZE; i++)
 	{
-	  for (uint32_t j=0; j < EQ_NUM_OF_FILTERS; j++)
-	  {
-	  	arm_fir_f32(&(parallelFilter[j]), inputF32 + (i * BLOCK_SIZE), outputAux, blockSize);
-	  	for (uint32_t k=0; k < BLOCK_SIZE; k++)
-	  	{
-	  		outputF32[k + (i * BLOCK_SIZE)] += eqGains32[k] * outputAux[k];
-	  	}
-	  }
+		arm_fir_f32(&eqFilterF32, inputF32 + (i * BLOCK_SIZE), outputF32 + (i * BLOCK_SIZE), blockSize);
+	}
+}
+
+void eqFilterFrameQ15(q15_t * inputQ15, q15_t * outputQ15)
+{
+	// Call the FIR process function for every blockSize samples.
+	for (uint32_t i=0; i < eqFrameSize/BLOCK_SIZE; i++)
+	{
+		arm_fir_fast_q15(&eqFilterQ15, inputQ15 + (i * BLOCK_SIZE), outputQ15 + (i * BLOCK_SIZE), blockSize);
+	}
+
+	// Undo the coefficient scaling, saturating the output
+	if (eqShiftQ15)
+	{
+		arm_shift_q15(outputQ15, eqShiftQ15, outputQ15, eqFrameSize);
 	}
 }
 
@@ -105,11 +129,16 @@ void eqSetFilterGains(float32_t gains[EQ_NUM_OF_FILTERS])
   {
     eqGains32[i] = gains[i];
   }
+  eqUpdateCoefficients();
 }
 
 void eqSetFilterGain(float32_t gain, uint8_t filterNum)
 {
-  eqGains32[filterNum] = gain;
+  if (filterNum < EQ_NUM_OF_FILTERS)
+  {
+    eqGains32[filterNum] = gain;
+    eqUpdateCoefficients();
+  }
 }
 
 /*******************************************************************************
@@ -118,6 +147,43 @@ void eqSetFilterGain(float32_t gain, uint8_t filterNum)
  *******************************************************************************
  ******************************************************************************/
 
+static void eqUpdateCoefficients(void)
+{
+  float32_t maxCoeff = 0.0f;
+  float32_t scale = 1.0f;
+
+  // The bank is linear, so the sum of the gain weighted bandpass filters is a single FIR filter
+  for (uint32_t n = 0; n < NUM_TAPS; n++)
+  {
+    float32_t coeff = 0.0f;
+    for (uint32_t k = 0; k < EQ_NUM_OF_FILTERS; k++)
+    {
+      coeff += eqGains32[k] * eqFirCoeffs32[k][n];
+    }
+    eqCoeffsF32[n] = coeff;
+    if (fabsf(coeff) > maxCoeff)
+    {
+      maxCoeff = fabsf(coeff);
+    }
+  }
+
+  // Find the smallest power of two that keeps the Q15 coefficients below 1.0
+  eqShiftQ15 = 0;
+  while (maxCoeff * scale >= 1.0f && eqShiftQ15 < Q15_MAX_SHIFT)
+  {
+    scale *= 0.5f;
+    eqShiftQ15++;
+  }
+
+  // The extra tap needed by the Q15 filter is the first one, left at zero. CMSIS takes the
+  // coefficients in time reversed order, so a zero last would delay the output by a sample
+  eqCoeffsQ15[0] = 0;
+  for (uint32_t n = 0; n < NUM_TAPS; n++)
+  {
+    eqCoeffsQ15[n + 1] = (q15_t)__SSAT((q31_t)(eqCoeffsF32[n] * scale * 32768.0f), 16);
+  }
+}
+
 /*******************************************************************************
  *******************************************************************************
 						            INTERRUPT SERVICE ROUTINES
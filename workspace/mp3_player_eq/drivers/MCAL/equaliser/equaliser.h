@@ -45,13 +45,20 @@ void eqInit(uint32_t frameSize);
 void eqFilterFrame(float32_t * inputF32, float32_t * outputF32);
 
 /**
- * @brief Sets all equaliser filter gains.
+ * @brief Compute the equaliser filter on the Q15 data given, using the fast Q15 FIR.
+ * @param inputQ15  Pointer to input data to filter.
+ * @param outputQ15 Pointer to where the filtered data should be saved.
+ */
+void eqFilterFrameQ15(q15_t * inputQ15, q15_t * outputQ15);
+
+/**
+ * @brief Sets all equaliser filter gains. Recomputes the equaliser filter coefficients.
  * @param gains  Array with the filter gains for each of the equaliser bands.
  */
 void eqSetFilterGains(float32_t gains[EQ_NUM_OF_FILTERS]);
 
 /**
- * @brief Sets equaliser number filterNum to the gain given.
+ * @brief Sets equaliser number filterNum to the gain given. Recomputes the equaliser filter coefficients.
  * @param gain        Filter gain for filter number filterNum.
  * @param filterNum   Number of filter to apply the gain to.
  */
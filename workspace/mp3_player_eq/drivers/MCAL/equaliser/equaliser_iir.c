@@ -11,6 +11,7 @@
 #include "equaliser_iir.h"
 #include "arm_math.h"
 #include "math_helper.h"
+#include "sram_sections.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -399,7 +400,7 @@ static const float32_t  equaliserCoeff[IIR_EQ_BANDS][IIR_EQ_GAIN_LEVELS][IIR_EQ_
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static eq_iir_context_t context;
+static eq_iir_context_t context __SRAM_L_BSS__;
 
 /*******************************************************************************
  *******************************************************************************
@@ -45,10 +45,11 @@ void eqIirInit(void);
 void eqIirFilterFrame(q15_t * inputF32, q15_t * outputF32);
 
 /**
- * @brief Sets all equaliser filter gains.
- * @param gains  Array with the filter gains for each of the equaliser bands.
+ * @brief Sets the gain of one of the equaliser bands.
+ * @param band   Number of the band to apply the gain to.
+ * @param gain   Gain level of the band.
  */
-void eqIirSetFilterGains(uint32_t band, uint32_t gain);
+void eqIirSetFilterGain(uint32_t band, uint32_t gain);
 
 
 
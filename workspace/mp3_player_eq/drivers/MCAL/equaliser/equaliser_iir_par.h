@@ -45,10 +45,11 @@ void eqIirParInit(void);
 void eqIirParFilterFrame(uint16_t * inputF32, uint16_t * outputF32);
 
 /**
- * @brief Sets all equaliser filter gains.
- * @param gains  Array with the filter gains for each of the equaliser bands.
+ * @brief Sets the gain of one of the equaliser bands.
+ * @param band   Number of the band to apply the gain to.
+ * @param gain   Gain level of the band.
  */
-void eqIirParSetFilterGains(uint32_t band, uint32_t gain);
+void eqIirParSetFilterGain(uint32_t band, uint32_t gain);
 
 
 
@@ -0,0 +1,149 @@
+/***************************************************************************//**
+  @file     filterbank.c
+  @brief    Octave filter bank, band energies of a signal without any FFT
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "filterbank.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define FILTERBANK_BLOCK_SIZE     64        // Samples filtered per call to the biquads
+#define FILTERBANK_COEFF_COUNT    5         // Coefficients of a biquad, {b0, b1, b2, a1, a2}
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  // One biquad bandpass per band, all fed with the same input
+  arm_biquad_cascade_df2T_instance_f32 filters[FILTERBANK_BAND_COUNT];
+  float32_t coeffs[FILTERBANK_BAND_COUNT][FILTERBANK_COEFF_COUNT];
+  float32_t states[FILTERBANK_BAND_COUNT][2];
+
+  // Working buffers of a block
+  float32_t input[FILTERBANK_BLOCK_SIZE];
+  float32_t output[FILTERBANK_BLOCK_SIZE];
+
+  bool      alreadyInit;
+} filterbank_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Computes the coefficients of a constant peak gain bandpass biquad, in the
+ *        order and with the signs of the CMSIS-DSP biquads.
+ * @param lowHz     Lower edge of the band, where the response is 3dB down
+ * @param highHz    Upper edge of the band, where the response is 3dB down
+ * @param coeffs    Array to store the coefficients
+ */
+static void filterbankDesignBand(float32_t lowHz, float32_t highHz, float32_t coeffs[FILTERBANK_COEFF_COUNT]);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Edges of the octave bands, the last entry closes the highest band. They are the
+// edges of the spectrum analyser bands, 43Hz bins from 1 to 176, so both sources
+// of the visualiser show the same bands.
+static const float32_t BAND_EDGES_HZ[FILTERBANK_BAND_COUNT + 1] = {
+  43.07f, 86.13f, 172.27f, 344.53f, 689.06f, 1378.13f, 2756.25f, 5512.50f, 7579.69f
+};
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static filterbank_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void filterbankInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+    for (uint32_t band = 0 ; band < FILTERBANK_BAND_COUNT ; band++)
+    {
+      filterbankDesignBand(BAND_EDGES_HZ[band], BAND_EDGES_HZ[band + 1], context.coeffs[band]);
+      arm_biquad_cascade_df2T_init_f32(&context.filters[band], 1, context.coeffs[band], context.states[band]);
+    }
+  }
+}
+
+void filterbankAnalyse(const q15_t * samples, uint32_t count, uint32_t bands[FILTERBANK_BAND_COUNT])
+{
+  float32_t power[FILTERBANK_BAND_COUNT] = { 0.0f };
+  float32_t blockPower, energy;
+  uint32_t blockSize;
+
+  // Filter the input block by block, only accumulating the power of each band
+  for (uint32_t i = 0 ; i < count ; i += blockSize)
+  {
+    blockSize = (count - i) < FILTERBANK_BLOCK_SIZE ? (count - i) : FILTERBANK_BLOCK_SIZE;
+    arm_q15_to_float((q15_t*)samples + i, context.input, blockSize);
+    for (uint32_t band = 0 ; band < FILTERBANK_BAND_COUNT ; band++)
+    {
+      arm_biquad_cascade_df2T_f32(&context.filters[band], context.input, context.output, blockSize);
+      arm_power_f32(context.output, blockSize, &blockPower);
+      power[band] += blockPower;
+    }
+  }
+
+  for (uint32_t band = 0 ; band < FILTERBANK_BAND_COUNT ; band++)
+  {
+    // A full scale tone has a mean square value of 1/2, so it maps to UINT32_MAX
+    energy = count ? 2.0f * power[band] / count * (float32_t)UINT32_MAX : 0.0f;
+    bands[band] = energy < (float32_t)UINT32_MAX ? (uint32_t)energy : UINT32_MAX;
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void filterbankDesignBand(float32_t lowHz, float32_t highHz, float32_t coeffs[FILTERBANK_COEFF_COUNT])
+{
+  float32_t centreHz, q, omega, alpha, a0;
+
+  // Centred on the geometric mean of the edges, with their distance as bandwidth
+  arm_sqrt_f32(lowHz * highHz, &centreHz);
+  q = centreHz / (highHz - lowHz);
+  omega = 2.0f * PI * centreHz / FILTERBANK_SAMPLE_RATE;
+  alpha = arm_sin_f32(omega) / (2.0f * q);
+  a0 = 1.0f + alpha;
+
+  // b1 is zero and b2 is -b0, so the response is 0dB at the centre frequency
+  coeffs[0] = alpha / a0;
+  coeffs[1] = 0.0f;
+  coeffs[2] = -alpha / a0;
+  coeffs[3] = 2.0f * arm_cos_f32(omega) / a0;
+  coeffs[4] = -(1.0f - alpha) / a0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+						            INTERRUPT SERVICE ROUTINES
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
@@ -0,0 +1,57 @@
+/***************************************************************************//**
+  @file     filterbank.h
+  @brief    Octave filter bank, band energies of a signal without any FFT
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef MCAL_FILTERBANK_FILTERBANK_H_
+#define MCAL_FILTERBANK_FILTERBANK_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "arm_math.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define FILTERBANK_BAND_COUNT     8         // Amount of octave bands computed
+#define FILTERBANK_SAMPLE_RATE    44100     // Sample rate of the analysed signal, in Hz
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initialises the filter bank, computing the coefficients of its bands.
+ */
+void filterbankInit(void);
+
+/**
+ * @brief Computes the energy of each octave band of a block of samples, from the lowest
+ *        to the highest frequency. The bands are the same as the ones of the spectrum
+ *        analyser, and their energies are on the same scale: UINT32_MAX is the energy
+ *        of a full scale tone. The filters keep their state between calls.
+ * @param samples   Samples to analyse, at the filter bank sample rate.
+ * @param count     Amount of samples.
+ * @param bands     Array to store the band energies.
+ */
+void filterbankAnalyse(const q15_t * samples, uint32_t count, uint32_t bands[FILTERBANK_BAND_COUNT]);
+
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* MCAL_FILTERBANK_FILTERBANK_H_ */
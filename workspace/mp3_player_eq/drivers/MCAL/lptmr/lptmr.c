@@ -0,0 +1,114 @@
+/***************************************************************************//**
+  @file     lptmr.c
+  @brief    Low power timer driver, free running counter clocked by the 1kHz LPO with a compare
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "lptmr.h"
+#include "MK64F12.h"
+#include "hardware.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define LPTMR_LPO_CLOCK     1           // Prescaler clock select of the LPO
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static lptmr_callback_t compareCallback;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void lptmrInit(lptmr_callback_t callback)
+{
+  // Clock gating for LPTMR peripheral
+  SIM->SCGC5 |= SIM_SCGC5_LPTMR(1);
+
+  // Time counter mode, free running, without the compare interrupt
+  LPTMR0->CSR = LPTMR_CSR_TCF(1);
+  LPTMR0->PSR = LPTMR_PSR_PCS(LPTMR_LPO_CLOCK) | LPTMR_PSR_PBYP(1);
+  LPTMR0->CMR = 0;
+  LPTMR0->CSR = LPTMR_CSR_TFC(1) | LPTMR_CSR_TEN(1);
+
+  compareCallback = callback;
+  NVIC_EnableIRQ(LPTMR0_IRQn);
+}
+
+uint16_t lptmrCount(void)
+{
+  // The counter is latched by writing it before reading it
+  LPTMR0->CNR = 0;
+  return (uint16_t)LPTMR0->CNR;
+}
+
+void lptmrSetCompare(uint16_t count)
+{
+  // The flag is set when the counter increments from the compare. The timer stays enabled,
+  // disabling it would reset the counter and lose the fraction of tick counted
+  LPTMR0->CMR = (uint16_t)(count - 1);
+  LPTMR0->CSR = LPTMR_CSR_TCF(1) | LPTMR_CSR_TIE(1) | LPTMR_CSR_TFC(1) | LPTMR_CSR_TEN(1);
+  NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+}
+
+void lptmrCancel(void)
+{
+  LPTMR0->CSR = LPTMR_CSR_TCF(1) | LPTMR_CSR_TFC(1) | LPTMR_CSR_TEN(1);
+  NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+}
+
+void lptmrRaise(void)
+{
+  NVIC_SetPendingIRQ(LPTMR0_IRQn);
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/*******************************************************************************
+ *******************************************************************************
+						            INTERRUPT SERVICE ROUTINES
+ *******************************************************************************
+ ******************************************************************************/
+
+__ISR__ LPTMR0_IRQHandler(void)
+{
+  // Clear the flag, keeping the timer running
+  LPTMR0->CSR |= LPTMR_CSR_TCF(1);
+
+  if (compareCallback)
+  {
+    compareCallback();
+  }
+}
+
+/******************************************************************************/
@@ -0,0 +1,71 @@
+/***************************************************************************//**
+  @file     lptmr.h
+  @brief    Low power timer driver, one-shot compare clocked by the 1kHz LPO
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef MCAL_LPTMR_LPTMR_H_
+#define MCAL_LPTMR_LPTMR_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define LPTMR_CLOCK_HZ      1000U       // LPO clock, one tick per millisecond
+#define LPTMR_MAX_TICKS     0x7FFFU     // Longest compare, half the 16 bits counter so that reaching it is unambiguous
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Callback called from the interrupt when the compare is reached
+typedef void (*lptmr_callback_t)(void);
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the LPTMR, clocked by the LPO without prescaler. The counter runs
+ *        freely from then on, it is never reset, so no tick is lost when the compare changes.
+ * @param callback  Function called when the compare is reached
+ */
+void lptmrInit(lptmr_callback_t callback);
+
+/**
+ * @brief Returns the count of the free running counter, latched when read.
+ */
+uint16_t lptmrCount(void);
+
+/**
+ * @brief Programs the compare to interrupt when the counter reaches the given count, clearing
+ *        any compare pending. A count already reached is only compared again after wrapping around.
+ * @param count     Count of the interrupt, at most LPTMR_MAX_TICKS after the current one
+ */
+void lptmrSetCompare(uint16_t count);
+
+/**
+ * @brief Disables the compare interrupt, and clears any compare pending. The counter keeps running.
+ */
+void lptmrCancel(void);
+
+/**
+ * @brief Raises the compare interrupt, for a count reached while it was being programmed.
+ */
+void lptmrRaise(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* MCAL_LPTMR_LPTMR_H_ */
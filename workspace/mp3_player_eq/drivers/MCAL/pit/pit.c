@@ -68,6 +68,11 @@ void pitSetInterval(pit_channel_t channel, uint32_t ticks)
   PIT->CHANNEL[channel].LDVAL = ticks; // load cnt value
   PIT->CHANNEL[channel].TFLG = PIT_TFLG_TIF(1);
 }
+
+uint32_t pitGetCount(pit_channel_t channel)
+{
+  return PIT->CHANNEL[channel].CVAL; // current cnt value
+}
 /*******************************************************************************
  *******************************************************************************
                         LOCAL FUNCTION DEFINITIONS
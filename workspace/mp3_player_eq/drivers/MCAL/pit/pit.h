@@ -72,6 +72,14 @@ void pitStart(pit_channel_t channel);
 */
 void pitStop(pit_channel_t channel);
 
+/*
+* pitGetCount()
+* @brief  reads PIT channel counter, counting down from the interval to zero
+* @param  channel PIT channel to read
+*
+*/
+uint32_t pitGetCount(pit_channel_t channel);
+
 
 
 /*******************************************************************************
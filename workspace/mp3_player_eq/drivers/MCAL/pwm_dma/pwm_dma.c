@@ -31,6 +31,9 @@ typedef struct {
   /* Status and control fields of the context */
   bool                      alreadyInitialized;
   pwmdma_update_callback_t  updateCallback;
+  bool                      single;           // Whole frame sent in one major loop
+  volatile bool             busy;             // Transfer in progress
+  uint32_t                  interruptCount;   // Major loop interrupts served
 
   /* Data Frames ping pong buffers and index */
   uint16_t*                 frames[2];
@@ -65,11 +68,22 @@ static uint8_t pwmdmaFtm2DmaChannel(ftm_instance_t ftmInstance, ftm_channel_t ft
 
 static void onMajorLoop(void);
 
+/**
+ * @brief Configures the DMA request source and arbitration, loads the first TCD and
+ *        starts the PWM, which triggers the transfers.
+ */
+static void pwmdmaLaunch(void);
+
+/**
+ * @brief Stops the PWM once the last duty value has been transferred.
+ */
+static void pwmdmaFinish(void);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static pwmdma_context_t context;
+static pwmdma_context_t context __SRAM_U_BSS__;    // Holds the TCDs read by the DMA
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -129,6 +143,8 @@ void pwmdmaStart(uint16_t* firstFrame, uint16_t* secondFrame, size_t frameSize,
   context.loop = loop;
   context.framesCopied = 0;
   context.currentFrame = 0;
+  context.single = false;
+  context.busy = true;
 
   // Ask the user to update the content of the first two frames 
   // used for transfering data with DMA controller
@@ -169,6 +185,61 @@ void pwmdmaStart(uint16_t* firstFrame, uint16_t* secondFrame, size_t frameSize,
   context.dmaConfig.tcds[0].DLAST_SGA = (uint32_t) &(context.dmaConfig.tcds[1]);
   context.dmaConfig.tcds[1].DLAST_SGA = (uint32_t) &(context.dmaConfig.tcds[0]);
 
+  pwmdmaLaunch();
+}
+
+void pwmdmaStartSingle(uint16_t* frame, size_t frameSize)
+{
+  FTM_Type * ftmInstances[] = FTM_BASE_PTRS;
+
+  // Save the configuration of the transfer
+  context.frames[0] = frame;
+  context.frameSize = frameSize;
+  context.totalFrames = 1;
+  context.loop = false;
+  context.single = true;
+  context.busy = true;
+
+  // Destination address: FTM CnV for duty change, incrementing the source only
+  context.dmaConfig.tcds[0].SADDR = (uint32_t)(frame);
+  context.dmaConfig.tcds[0].DADDR = (uint32_t)(&(ftmInstances[context.ftmInstance]->CONTROLS[context.ftmChannel].CnV));
+  context.dmaConfig.tcds[0].SOFF = sizeof(uint16_t);
+  context.dmaConfig.tcds[0].DOFF = 0;
+  context.dmaConfig.tcds[0].SLAST = 0;
+  context.dmaConfig.tcds[0].DLAST_SGA = 0;
+
+  // Set transfer size to 16bits (CnV size)
+  context.dmaConfig.tcds[0].ATTR = DMA_ATTR_SSIZE(1) | DMA_ATTR_DSIZE(1);
+  context.dmaConfig.tcds[0].NBYTES_MLNO = (0x01) * (0x02);
+
+  // One interrupt at the end of the whole frame, no more requests after it
+  context.dmaConfig.tcds[0].CSR = DMA_CSR_INTMAJOR(1) | DMA_CSR_DREQ(1);
+
+  // The whole frame is a single major loop
+  context.dmaConfig.tcds[0].BITER_ELINKNO = frameSize;
+  context.dmaConfig.tcds[0].CITER_ELINKNO = frameSize;
+
+  pwmdmaLaunch();
+}
+
+bool pwmdmaBusy(void)
+{
+  return context.busy;
+}
+
+uint32_t pwmdmaGetInterruptCount(void)
+{
+  return context.interruptCount;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void pwmdmaLaunch(void)
+{
   // Disable period triggering, mux selects FTM
   context.dmaConfig.pitEn = 0;
   context.dmaConfig.muxSource = pwmdmaFtm2DmaChannel(context.ftmInstance, context.ftmChannel);
@@ -185,13 +256,24 @@ void pwmdmaStart(uint16_t* firstFrame, uint16_t* secondFrame, size_t frameSize,
   ftmPwmSetEnable(context.ftmInstance, context.ftmChannel, true);
 }
 
-/*******************************************************************************
- *******************************************************************************
-                        LOCAL FUNCTION DEFINITIONS
- *******************************************************************************
- ******************************************************************************/
+static void pwmdmaFinish(void)
+{
+  ftmPwmSetEnable(context.ftmInstance, context.ftmChannel, false);
+  ftmStop(context.ftmInstance);
+  context.busy = false;
+}
+
 void onMajorLoop(void)
 {
+    context.interruptCount++;
+
+    /* Whole frame transferred */
+    if (context.single)
+    {
+      pwmdmaFinish();
+      return;
+    }
+
     /* Completed major loop */
     context.currentFrame = !context.currentFrame;   // Ping pong buffer switch
 
@@ -221,8 +303,7 @@ void onMajorLoop(void)
       }
       else if (context.framesCopied == context.totalFrames)
       {
-         ftmPwmSetEnable(context.ftmInstance, context.ftmChannel, false);
-    	 ftmStop(context.ftmInstance);
+         pwmdmaFinish();
       }
     }
 }
@@ -60,6 +60,24 @@ void pwmdmaOnFrameUpdate(pwmdma_update_callback_t callback);
  */ 
 void pwmdmaStart(uint16_t* firstFrame, uint16_t* secondFrame, size_t frameSize, size_t totalFrames, bool loop);
 
+/**
+ * @brief Starts the PWM, sending a whole frame in a single DMA major loop with
+ *        only one interrupt at its end. The update callback is not used.
+ * @param frame         Pointer to the frame, must not change until the transfer ends
+ * @param frameSize     Size of the frame, up to 32767 duty values
+ */
+void pwmdmaStartSingle(uint16_t* frame, size_t frameSize);
+
+/**
+ * @brief Returns whether a transfer is in progress.
+ */
+bool pwmdmaBusy(void);
+
+/**
+ * @brief Returns the amount of DMA major loop interrupts served since initialization.
+ */
+uint32_t pwmdmaGetInterruptCount(void);
+
 
 /*******************************************************************************
  ******************************************************************************/
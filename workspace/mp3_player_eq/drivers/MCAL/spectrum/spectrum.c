@@ -0,0 +1,187 @@
+/***************************************************************************//**
+  @file     spectrum.c
+  @brief    Spectrum analyser, octave band energies of a decimated signal
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "spectrum.h"
+#include "drivers/MCAL/cfft/cfft.h"
+#include "sram_sections.h"
+
+#include <string.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SPECTRUM_FFT_SIZE         SPECTRUM_SNAPSHOT_SIZE
+#define SPECTRUM_FFT_CFFT_SIZE    CFFT_512
+#define SPECTRUM_BLOCK_SIZE       256                 // Input samples decimated per filter call
+#define SPECTRUM_HALF_BAND_TAPS   19
+#define SPECTRUM_POWER_SHIFT      3                   // A full scale tone, over the 3 bins of the Hann main lobe, is 1.25dB below UINT32_MAX
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  // Decimation
+  arm_fir_decimate_instance_q15 decimator;
+  q15_t     decimatorState[SPECTRUM_HALF_BAND_TAPS + SPECTRUM_BLOCK_SIZE - 1];
+  q15_t     block[SPECTRUM_BLOCK_SIZE];
+  q15_t     decimated[SPECTRUM_BLOCK_SIZE / SPECTRUM_DECIMATION];
+
+  // Last decimated samples, circular buffer
+  q15_t     history[SPECTRUM_FFT_SIZE];
+  uint32_t  historyIndex;
+
+  // Analysis
+  q15_t     fftInput[SPECTRUM_FFT_SIZE];
+  q15_t     fftOutput[SPECTRUM_FFT_SIZE * 2];
+
+  bool      alreadyInit;
+} spectrum_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+// Half-band lowpass filter, Blackman windowed sinc. Every other coefficient is zero.
+static const q15_t HALF_BAND_COEFFS[SPECTRUM_HALF_BAND_TAPS] = {
+  11, 0, -151, 0, 709, 0, -2397, 0, 10018, 16387, 10018, 0, -2397, 0, 709, 0, -151, 0, 11
+};
+
+// First FFT bin of each octave band, the last entry closes the highest band.
+// At 44.1kHz, decimated by 2, each bin is 43Hz wide: the bands go from 43Hz to 7.6kHz.
+// The highest band stops short of the 11kHz Nyquist frequency, where the half-band
+// filter is 6dB down and folds the content above it back. Up to 7.6kHz the passband
+// is within 0.4dB and the images of the content above 14.5kHz are 27dB down.
+static const uint16_t BAND_FIRST_BIN[SPECTRUM_BAND_COUNT + 1] = {
+  1, 2, 4, 8, 16, 32, 64, 128, 176
+};
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static spectrum_context_t context __SRAM_L_BSS__;
+static q15_t              hannWindow[SPECTRUM_FFT_SIZE] __SRAM_L_BSS__;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void spectrumInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+    // Half-band decimator
+    arm_fir_decimate_init_q15(&context.decimator, SPECTRUM_HALF_BAND_TAPS, SPECTRUM_DECIMATION,
+                              HALF_BAND_COEFFS, context.decimatorState, SPECTRUM_BLOCK_SIZE);
+
+    // Hann window table
+    for (uint32_t i = 0 ; i < SPECTRUM_FFT_SIZE ; i++)
+    {
+      float32_t value = 0.5f * (1.0f - arm_cos_f32(2.0f * PI * i / SPECTRUM_FFT_SIZE));
+      hannWindow[i] = (q15_t)__SSAT((q31_t)(value * 32768.0f), 16);
+    }
+
+    rfftInitQ15(SPECTRUM_FFT_CFFT_SIZE);
+  }
+}
+
+void spectrumFeed(const int16_t * samples, uint32_t count, uint32_t stride)
+{
+  uint32_t blockSize, decimatedSize, copySize;
+
+  while (count)
+  {
+    // Take one block of samples out of the interleaved input
+    blockSize = count < SPECTRUM_BLOCK_SIZE ? count : SPECTRUM_BLOCK_SIZE;
+    for (uint32_t i = 0 ; i < blockSize ; i++)
+    {
+      context.block[i] = samples[i * stride];
+    }
+    samples += blockSize * stride;
+    count -= blockSize;
+
+    // Decimate it and append the result to the history
+    arm_fir_decimate_fast_q15(&context.decimator, context.block, context.decimated, blockSize);
+    decimatedSize = blockSize / SPECTRUM_DECIMATION;
+    for (uint32_t i = 0 ; i < decimatedSize ; i += copySize)
+    {
+      copySize = SPECTRUM_FFT_SIZE - context.historyIndex;
+      if (copySize > decimatedSize - i)
+      {
+        copySize = decimatedSize - i;
+      }
+      memcpy(context.history + context.historyIndex, context.decimated + i, copySize * sizeof(q15_t));
+      context.historyIndex = (context.historyIndex + copySize) % SPECTRUM_FFT_SIZE;
+    }
+  }
+}
+
+void spectrumGetSnapshot(q15_t snapshot[SPECTRUM_SNAPSHOT_SIZE])
+{
+  uint32_t oldest = SPECTRUM_FFT_SIZE - context.historyIndex;
+
+  // Unroll the history, oldest sample first
+  memcpy(snapshot, context.history + context.historyIndex, oldest * sizeof(q15_t));
+  memcpy(snapshot + oldest, context.history, context.historyIndex * sizeof(q15_t));
+}
+
+void spectrumAnalyse(const q15_t snapshot[SPECTRUM_SNAPSHOT_SIZE], uint32_t bands[SPECTRUM_BAND_COUNT])
+{
+  uint64_t power;
+  q31_t re, im;
+
+  // Apply the window, the FFT input is also used as scratch
+  arm_mult_q15((q15_t*)snapshot, hannWindow, context.fftInput, SPECTRUM_FFT_SIZE);
+
+  rfftQ15(context.fftInput, context.fftOutput);
+
+  // Sum the power of every bin in each band
+  for (uint32_t band = 0 ; band < SPECTRUM_BAND_COUNT ; band++)
+  {
+    power = 0;
+    for (uint32_t bin = BAND_FIRST_BIN[band] ; bin < BAND_FIRST_BIN[band + 1] ; bin++)
+    {
+      re = context.fftOutput[2 * bin];
+      im = context.fftOutput[2 * bin + 1];
+      // Each square fits, but their sum can reach 2^31
+      power += (uint32_t)(re * re) + (uint32_t)(im * im);
+    }
+    power <<= SPECTRUM_POWER_SHIFT;
+    bands[band] = power > UINT32_MAX ? UINT32_MAX : (uint32_t)power;
+  }
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/*******************************************************************************
+ *******************************************************************************
+						            INTERRUPT SERVICE ROUTINES
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
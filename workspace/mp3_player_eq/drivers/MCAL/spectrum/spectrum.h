@@ -0,0 +1,71 @@
+/***************************************************************************//**
+  @file     spectrum.h
+  @brief    Spectrum analyser, octave band energies of a decimated signal
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef MCAL_SPECTRUM_SPECTRUM_H_
+#define MCAL_SPECTRUM_SPECTRUM_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "arm_math.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SPECTRUM_BAND_COUNT       8     // Amount of octave bands computed
+#define SPECTRUM_DECIMATION       2     // Decimation factor applied before the FFT
+#define SPECTRUM_SNAPSHOT_SIZE    512   // Decimated samples analysed at once, size of the FFT
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initialises the spectrum analyser.
+ */
+void spectrumInit(void);
+
+/**
+ * @brief Feeds samples to the analyser, which are decimated and stored.
+ * @param samples   Input samples, only one of every stride samples is used.
+ * @param count     Amount of samples to feed, must be a multiple of SPECTRUM_DECIMATION.
+ * @param stride    Distance between consecutive samples, the channel count for interleaved data.
+ */
+void spectrumFeed(const int16_t * samples, uint32_t count, uint32_t stride);
+
+/**
+ * @brief Copies the last decimated samples fed, from the oldest to the newest one.
+ * @param snapshot  Array to store the samples.
+ */
+void spectrumGetSnapshot(q15_t snapshot[SPECTRUM_SNAPSHOT_SIZE]);
+
+/**
+ * @brief Computes the energy of each octave band of a snapshot, from the lowest to the
+ *        highest frequency. Energies are the sum of the bin powers, scaled so that
+ *        UINT32_MAX is the energy of a full scale tone.
+ * @param snapshot  Decimated samples to analyse, as given by spectrumGetSnapshot.
+ * @param bands     Array to store the band energies.
+ */
+void spectrumAnalyse(const q15_t snapshot[SPECTRUM_SNAPSHOT_SIZE], uint32_t bands[SPECTRUM_BAND_COUNT]);
+
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* MCAL_SPECTRUM_SPECTRUM_H_ */
@@ -16,6 +16,8 @@
 
 #include "lib/queue/queue.h"
 
+#include "drivers/MCAL/dma_sga/dma_sga.h"
+
 #include "hardware.h"
 
 /*******************************************************************************
@@ -27,6 +29,11 @@
 #define TX_QUEUE_MAX_SIZE       400           // Maximum size of the FIFO for transmitter
 #define RX_QUEUE_MAX_SIZE       5	          // Maximum size of the FIFO for the receiver
 
+#define SPI_DMA_INSTANCE        SPI_INSTANCE_0  // Only SPI0 has its own transmit DMA request
+#define SPI_DMA_CHANNEL         DMA_CHANNEL_2
+#define SPI_DMA_MUX_SOURCE      15              // DMAMUX source of the SPI0 transmit request
+#define SPI_DMA_BUFFER_SIZE     128             // Frames sent in each DMA transfer
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
@@ -77,6 +84,10 @@ typedef struct {
   
   // Flags
   bool transferComplete;
+  volatile bool dmaActive;                        // DMA transfer in progress, fed from the software queue
+
+  // Statistics
+  uint32_t          interruptCount;
 
   // Callbacks
   spi_callback_t    onTransferCompleted;
@@ -127,6 +138,13 @@ static bool smartSend(spi_id_t id, spi_slave_id_t slave, const uint16_t message[
  */
 static void softQueue2HardFIFO(spi_id_t id);
 
+/**
+ * @brief Moves the software queue to the DMA buffer as PUSHR command words, and starts
+ *        the DMA transfer to the hardware FIFO. Only the last word ends the queue, so the
+ *        whole buffer raises a single interrupt.
+ */
+static void softQueue2Dma(spi_id_t id);
+
 /*******************************************************************************
  *******************************************************************************
 						      PROTOTYPES FOR INTERRUPT SERVICE ROUTINES
@@ -165,6 +183,10 @@ static spi_instance_t spiInstances[SPI_INSTANCE_AMOUNT] = {
 
 static uint8_t spiIrqs[] = SPI_IRQS;
 
+// PUSHR command words read by the DMA, and the configuration of its channel
+static uint32_t               spiDmaBuffer[SPI_DMA_BUFFER_SIZE] __SRAM_U_BSS__;
+static dma_sga_channel_cfg_t  spiDmaConfig __SRAM_U_BSS__;
+
 // Look-up table for the SPI Prescaler
 static uint8_t spiPrescaler[] = {
   2,
@@ -224,9 +246,16 @@ void spiInit(spi_id_t id, spi_slave_id_t slave, spi_cfg_t config)
 	  }
   }
 
-  // Configuration of the MCR register
+  // Save the configuration, the DMA is only available in one instance
+  if (id != SPI_DMA_INSTANCE)
+  {
+    config.txDma = SPI_TX_DMA_DIS;
+  }
+  spiInstances[id].config = config;
+
+  // Configuration of the MCR register, the receiver FIFO is disabled when transmitting with the DMA
   spiPointers[id]->MCR = SPI_MCR_PCSIS(config.slaveSelectPolarity == SPI_SS_INACTIVE_HIGH ? 0x3F : 0x00);
-  spiPointers[id]->MCR |= SPI_MCR_HALT(1) | SPI_MCR_MSTR(1) | SPI_MCR_DIS_TXF(0) | SPI_MCR_DIS_RXF(0) | SPI_MCR_CLR_RXF(1) | SPI_MCR_CLR_TXF(1);
+  spiPointers[id]->MCR |= SPI_MCR_HALT(1) | SPI_MCR_MSTR(1) | SPI_MCR_DIS_TXF(0) | SPI_MCR_DIS_RXF(config.txDma) | SPI_MCR_CLR_RXF(1) | SPI_MCR_CLR_TXF(1);
 
   // Computing the settings required to set the SPI peripheral with the given baud rate
   baud_rate_cfg_t settings = computeBaudRateSettings(config.baudRate);
@@ -241,7 +270,16 @@ void spiInit(spi_id_t id, spi_slave_id_t slave, spi_cfg_t config)
 
   // Clear the flags and enable the interruption for the SPI peripheral
   spiPointers[id]->SR = SPI_SR_EOQF(1) | SPI_SR_TCF(1) | SPI_SR_TFUF(1) | SPI_SR_TFFF(1) | SPI_SR_RFOF(1) | SPI_SR_RFDF(1);
-  spiPointers[id]->RSER = SPI_RSER_RFDF_RE(1) | SPI_RSER_EOQF_RE(1);
+  if (config.txDma == SPI_TX_DMA_EN)
+  {
+    // Only the end of queue interrupt, the transmit FIFO requests are enabled on each transfer
+    spiPointers[id]->RSER = SPI_RSER_EOQF_RE(1);
+    dmasgaInit();
+  }
+  else
+  {
+    spiPointers[id]->RSER = SPI_RSER_RFDF_RE(1) | SPI_RSER_EOQF_RE(1);
+  }
   NVIC_EnableIRQ(spiIrqs[id]);
 
   // Start the SPI peripheral
@@ -302,6 +340,11 @@ bool spiTransferComplete(spi_id_t id)
 	return result;
 }
 
+uint32_t spiGetInterruptCount(spi_id_t id)
+{
+  return spiInstances[id].interruptCount;
+}
+
 void spiOnTransferCompleted(spi_id_t id, spi_callback_t callback)
 {
   spiInstances[id].onTransferCompleted = callback;
@@ -341,9 +384,18 @@ bool smartSend(spi_id_t id, spi_slave_id_t slave, const uint16_t message[], size
     }
   }
 
+  // With the DMA, the queue is sent as a whole when no transfer is in progress,
+  // otherwise it is sent when the current transfer ends.
+  if (spiInstances[id].config.txDma == SPI_TX_DMA_EN)
+  {
+    if (!spiInstances[id].dmaActive)
+    {
+      softQueue2Dma(id);
+    }
+  }
   // If the transmission is not currently active (TXRXS is set), the firsts elements in the software queue
   // should be sent to the hardware FIFO to start the transmission.
-  if ( (spiPointers[id]->SR & SPI_SR_TXRXS_MASK ) != SPI_SR_TXRXS_MASK )
+  else if ( (spiPointers[id]->SR & SPI_SR_TXRXS_MASK ) != SPI_SR_TXRXS_MASK )
   {
     softQueue2HardFIFO(id);
     spiPointers[id]->MCR = (spiPointers[id]->MCR & ~SPI_MCR_HALT_MASK) | SPI_MCR_HALT(0);
@@ -367,6 +419,58 @@ void softQueue2HardFIFO(spi_id_t id)
   }
 }
 
+void softQueue2Dma(spi_id_t id)
+{
+  queue_t* txQueue = &(spiInstances[id].txQueue);
+  size_t count = size(txQueue);
+
+  if (count > SPI_DMA_BUFFER_SIZE)
+  {
+    count = SPI_DMA_BUFFER_SIZE;
+  }
+
+  // Command words, the end of queue is only flagged on the last one
+  for (size_t i = 0 ; i < count ; i++)
+  {
+    spi_package_t* package = (spi_package_t*)pop(txQueue);
+    spiDmaBuffer[i] = SPI_PUSHR_CONT(spiInstances[id].config.continuousPcs) | SPI_PUSHR_CTAS(0b000) | SPI_PUSHR_EOQ(i == count - 1) |
+                      SPI_PUSHR_CTCNT(1) | SPI_PUSHR_PCS(package->slaves) | SPI_PUSHR_TXDATA(package->frame);
+  }
+
+  if (count)
+  {
+    spiInstances[id].dmaActive = true;
+
+    // Words from the buffer to PUSHR, one for each transmit FIFO request
+    spiDmaConfig.tcds[0].SADDR = (uint32_t)(spiDmaBuffer);
+    spiDmaConfig.tcds[0].DADDR = (uint32_t)(&(spiPointers[id]->PUSHR));
+    spiDmaConfig.tcds[0].SOFF = sizeof(uint32_t);
+    spiDmaConfig.tcds[0].DOFF = 0;
+    spiDmaConfig.tcds[0].SLAST = 0;
+    spiDmaConfig.tcds[0].DLAST_SGA = 0;
+    spiDmaConfig.tcds[0].ATTR = DMA_ATTR_SSIZE(2) | DMA_ATTR_DSIZE(2);
+    spiDmaConfig.tcds[0].NBYTES_MLNO = sizeof(uint32_t);
+    spiDmaConfig.tcds[0].BITER_ELINKNO = count;
+    spiDmaConfig.tcds[0].CITER_ELINKNO = count;
+
+    // No interrupt from the DMA, the end of queue flag of the SPI ends the transfer
+    spiDmaConfig.tcds[0].CSR = DMA_CSR_DREQ(1);
+
+    spiDmaConfig.pitEn = 0;
+    spiDmaConfig.muxSource = SPI_DMA_MUX_SOURCE;
+    spiDmaConfig.fpArb = 0;
+    spiDmaConfig.ecp = 0;
+    spiDmaConfig.dpa = 0;
+    spiDmaConfig.priority = 2;
+
+    // The transmit FIFO requests are disabled while the channel is configured
+    spiPointers[id]->RSER &= ~(SPI_RSER_TFFF_RE_MASK | SPI_RSER_TFFF_DIRS_MASK);
+    dmasgaChannelConfig(SPI_DMA_CHANNEL, spiDmaConfig);
+    spiPointers[id]->RSER |= SPI_RSER_TFFF_RE(1) | SPI_RSER_TFFF_DIRS(1);
+    spiPointers[id]->MCR = (spiPointers[id]->MCR & ~SPI_MCR_HALT_MASK) | SPI_MCR_HALT(0);
+  }
+}
+
 static baud_rate_cfg_t computeBaudRateSettings(uint32_t baudRate)
 {
   baud_rate_cfg_t setting = { .BR = 0 , .DBR = 0 , .PBR = 0 };
@@ -426,6 +530,7 @@ static void SPI_IRQDispatcher(spi_id_t id)
 {
   // Read Status Register
   uint32_t sr = spiPointers[id]->SR;
+  spiInstances[id].interruptCount++;
 
   // If last package was sent
   if (sr & SPI_SR_EOQF_MASK)
@@ -448,6 +553,13 @@ static void SPI_IRQDispatcher(spi_id_t id)
 
 static void SPI_EOQFDispatcher(spi_id_t id)
 {
+  if (spiInstances[id].dmaActive)
+  {
+    // The whole DMA buffer was sent
+    spiPointers[id]->RSER &= ~(SPI_RSER_TFFF_RE_MASK | SPI_RSER_TFFF_DIRS_MASK);
+    spiInstances[id].dmaActive = false;
+  }
+
   if (isEmpty(&(spiInstances[id].txQueue)))
   {
     spiPointers[id]->MCR = (spiPointers[id]->MCR & ~SPI_MCR_HALT_MASK) | SPI_MCR_HALT(1);
@@ -460,6 +572,11 @@ static void SPI_EOQFDispatcher(spi_id_t id)
       spiInstances[id].transferComplete = true;
     }
   }
+  else if (spiInstances[id].config.txDma == SPI_TX_DMA_EN)
+  {
+    // Frames queued during the transfer
+    softQueue2Dma(id);
+  }
   else
   {
     softQueue2HardFIFO(id);
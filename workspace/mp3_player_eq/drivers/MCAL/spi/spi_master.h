@@ -73,6 +73,13 @@ typedef enum {
   SPI_CONTINUOUS_PCS_EN
 } spi_continuous_pcs_t;
 
+// Whether the transmitter is fed by the DMA, only available in SPI_INSTANCE_0.
+// Transmit only, the receive services can't be used with it.
+typedef enum {
+  SPI_TX_DMA_DIS,
+  SPI_TX_DMA_EN
+} spi_tx_dma_t;
+
 // Declaring the SPI configuration
 typedef struct{
   uint32_t          baudRate;
@@ -82,6 +89,7 @@ typedef struct{
   uint8_t           clockPhase            : 1;
   uint8_t           endianness            : 1;
   uint8_t           continuousPcs         : 1;
+  uint8_t           txDma                 : 1;
 } spi_cfg_t;
 
 /*******************************************************************************
@@ -168,6 +176,12 @@ void spiReceiveFlush(spi_id_t id);
  */
 bool spiTransferComplete(spi_id_t id);
 
+/**
+ * @brief Returns the amount of interrupts served by the SPI module since its initialization.
+ * @param id		  SPI module id
+ */
+uint32_t spiGetInterruptCount(spi_id_t id);
+
 /********************************
  * EVENT-DRIVEN STATUS SERVICES *
  *******************************/
@@ -0,0 +1,190 @@
+/***************************************************************************//**
+  @file     timebase.c
+  @brief    Monotonic 64 bits time base, counting core clock cycles
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "timebase.h"
+
+#include <stdbool.h>
+
+#ifdef __arm__
+#include "../systick/systick.h"
+#include "../pit/pit.h"
+#include "hardware.h"
+#else
+#include <time.h>
+#endif
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TIMEBASE_OVERHEAD_SAMPLES   8
+
+#define TIMEBASE_PIT_CHANNEL        PIT_CHANNEL_3   // Free running, clocked by the bus while the core sleeps
+#define TIMEBASE_CYCLES_PER_PIT     ((uint32_t)(TIMEBASE_CLOCK_HZ / PIT_CLOCK_HZ))
+
+#if defined(__arm__) && TIMEBASE_CLOCK_HZ != __CORE_CLOCK__
+#error Las frecuencias no coinciden!!
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * The DWT cycle counter wraps around every 42.9 seconds at 100MHz. The upper
+ * word is incremented whenever the counter is found below its last reading,
+ * which the SysTick does every millisecond, so no wrap around is missed.
+ * The counter stops while the core sleeps, the cycles slept are kept apart.
+ */
+typedef struct {
+  uint32_t        upper;            // Wrap arounds of the cycle counter
+  uint32_t        lastLower;        // Last reading of the cycle counter
+  uint64_t        slept;            // Cycles slept that the cycle counter missed
+  uint32_t        overhead;         // Cycles taken by timeNowCycles()
+  bool            alreadyInit;
+} timebase_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+#ifdef __arm__
+/**
+ * @brief Reads the time base on every SysTick, to account the wrap arounds of the cycle counter.
+ */
+static void timebaseTick(void);
+#endif
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static timebase_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void timebaseInit(void)
+{
+  uint64_t start;
+  uint32_t elapsed;
+
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+#ifdef __arm__
+    // Cycle counter, never written so that it stays monotonic
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    context.lastLower = DWT->CYCCNT;
+    systickInit(timebaseTick);
+
+    // Bus clock counter measuring the sleeps, a sleep shorter than its wrap around of 85 seconds is a subtraction
+    pitInit(TIMEBASE_PIT_CHANNEL);
+    pitSetInterval(TIMEBASE_PIT_CHANNEL, UINT32_MAX);
+    pitStart(TIMEBASE_PIT_CHANNEL);
+#endif
+
+    // Shortest of some back to back calls, the longer ones were interrupted
+    context.overhead = UINT32_MAX;
+    for (uint8_t i = 0 ; i < TIMEBASE_OVERHEAD_SAMPLES ; i++)
+    {
+      start = timeNowCycles();
+      elapsed = timeNowCycles() - start;
+      if (elapsed < context.overhead)
+      {
+        context.overhead = elapsed;
+      }
+    }
+  }
+}
+
+uint64_t timeNowCycles(void)
+{
+#ifdef __arm__
+  uint32_t primask = __get_PRIMASK();
+  uint32_t lower;
+  uint64_t now;
+
+  // An interrupt reading the counter in between would account the same wrap around twice
+  __disable_irq();
+  lower = DWT->CYCCNT;
+  if (lower < context.lastLower)
+  {
+    context.upper++;
+  }
+  context.lastLower = lower;
+  now = (((uint64_t)context.upper << 32) | lower) + context.slept;
+  __set_PRIMASK(primask);
+
+  return now;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * TIMEBASE_CLOCK_HZ + (uint64_t)now.tv_nsec * TIMEBASE_CYCLES_PER_US / 1000U;
+#endif
+}
+
+uint64_t timeNowUs(void)
+{
+  return TIMEBASE_CYCLES2US(timeNowCycles());
+}
+
+void timebaseWaitForEvent(void)
+{
+#ifdef __arm__
+  uint32_t pitBefore = pitGetCount(TIMEBASE_PIT_CHANNEL);
+  uint32_t cyclesBefore = DWT->CYCCNT;
+  uint64_t slept;
+  uint32_t counted;
+
+  __WFE();
+
+  // The PIT counts down, the cycles counted while sleeping are not added twice
+  slept = (uint64_t)(pitBefore - pitGetCount(TIMEBASE_PIT_CHANNEL)) * TIMEBASE_CYCLES_PER_PIT;
+  counted = DWT->CYCCNT - cyclesBefore;
+  if (slept > counted)
+  {
+    context.slept += slept - counted;
+  }
+#endif
+}
+
+uint32_t timeOverheadCycles(void)
+{
+  return context.overhead;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+#ifdef __arm__
+static void timebaseTick(void)
+{
+  timeNowCycles();
+}
+#endif
+
+/******************************************************************************/
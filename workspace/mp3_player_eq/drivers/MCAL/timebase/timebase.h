@@ -0,0 +1,73 @@
+/***************************************************************************//**
+  @file     timebase.h
+  @brief    Monotonic 64 bits time base, counting core clock cycles
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef MCAL_TIMEBASE_TIMEBASE_H_
+#define MCAL_TIMEBASE_TIMEBASE_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TIMEBASE_CLOCK_HZ           100000000U      // Core clock, counted by the DWT cycle counter
+#define TIMEBASE_CYCLES_PER_US      (TIMEBASE_CLOCK_HZ / 1000000U)
+
+#define TIMEBASE_CYCLES2US(cycles)  ((cycles) / TIMEBASE_CYCLES_PER_US)
+#define TIMEBASE_US2CYCLES(us)      ((us) * TIMEBASE_CYCLES_PER_US)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Starts the DWT cycle counter, and extends it to 64 bits on every SysTick.
+ *        Off target, the time base is read from the monotonic clock of the host.
+ */
+void timebaseInit(void);
+
+/**
+ * @brief Returns the core clock cycles elapsed since the time base started. Can be
+ *        called from any interrupt, it never wraps around.
+ */
+uint64_t timeNowCycles(void);
+
+/**
+ * @brief Returns the microseconds elapsed since the time base started.
+ */
+uint64_t timeNowUs(void);
+
+/**
+ * @brief Sleeps until the next event or interrupt, like __WFE(), and accounts the sleep.
+ *        The cycle counter is clocked by the core, which is gated while it sleeps, so
+ *        the sleep is measured by a free running PIT channel and the cycles the counter
+ *        missed are added to the time base. Called with the interrupts masked, so they
+ *        read the time base once the sleep is accounted.
+ */
+void timebaseWaitForEvent(void);
+
+/**
+ * @brief Returns the cycles taken by timeNowCycles() itself, measured when initialized.
+ *        Subtracted from a measurement made with two calls, it leaves the time measured.
+ */
+uint32_t timeOverheadCycles(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* MCAL_TIMEBASE_TIMEBASE_H_ */
@@ -0,0 +1,122 @@
+/*******************************************************************************
+  @file     spsc_ring.c
+  @brief    Lock-free ring buffer, for one producer and one consumer
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "spsc_ring.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+spsc_ring_t createSpscRing(void* buffer, size_t capacity, size_t elementSize)
+{
+	spsc_ring_t ring = {
+		.buffer = buffer,
+		.mask = capacity - 1,
+		.elementWords = elementSize / sizeof(uint32_t),
+		.head = 0,
+		.tail = 0
+	};
+	return ring;
+}
+
+bool spscRingPush(spsc_ring_t* ring, const void* element)
+{
+	const uint32_t* source = element;
+	uint32_t* slot;
+	uint32_t head = ring->head;
+	bool succeed = false;
+
+	// The acquire ordering keeps the slot from being written before the consumer released it
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) <= ring->mask)
+	{
+		slot = ring->buffer + (head & ring->mask) * ring->elementWords;
+		for (uint32_t i = 0 ; i < ring->elementWords ; i++)
+		{
+			slot[i] = source[i];
+		}
+
+		// The release ordering makes the element visible before the head
+		__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+		succeed = true;
+	}
+
+	// Return the succeed status
+	return succeed;
+}
+
+bool spscRingPop(spsc_ring_t* ring, void* element)
+{
+	uint32_t* destination = element;
+	const uint32_t* slot;
+	uint32_t tail = ring->tail;
+	bool succeed = false;
+
+	// The acquire ordering keeps the slot from being read before the producer wrote it
+	if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != tail)
+	{
+		slot = ring->buffer + (tail & ring->mask) * ring->elementWords;
+		for (uint32_t i = 0 ; i < ring->elementWords ; i++)
+		{
+			destination[i] = slot[i];
+		}
+
+		// The release ordering finishes reading the slot before the producer can reuse it
+		__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+		succeed = true;
+	}
+
+	// Return the succeed status
+	return succeed;
+}
+
+uint32_t spscRingSize(spsc_ring_t* ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+bool spscRingIsEmpty(spsc_ring_t* ring)
+{
+	return spscRingSize(ring) == 0;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/*******************************************************************************
+ ******************************************************************************/
@@ -0,0 +1,93 @@
+/*******************************************************************************
+  @file     spsc_ring.h
+  @brief    Lock-free ring buffer, for one producer and one consumer
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// Checks the capacity and the element of a ring when building, createSpscRing() can't report them
+#define SPSC_RING_CHECK(capacity, elementSize)																	\
+	_Static_assert(((capacity) > 0) && (((capacity) & ((capacity) - 1)) == 0), #capacity " is not a power of two");	\
+	_Static_assert(((elementSize) > 0) && ((elementSize) % sizeof(uint32_t) == 0), #elementSize " is not a multiple of four bytes")
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// The producer only writes the head and the consumer only writes the tail, so an
+// interrupt can push while the main loop pops without masking interrupts. Both
+// indexes run freely and are masked when accessing the buffer, so the capacity
+// must be a power of two and every slot can be used. Elements are copied in and
+// out by words, so their size must be a multiple of four bytes.
+typedef struct {
+	uint32_t*			buffer;			// Pointer to the array reserved in memory
+	uint32_t			mask;			// Capacity minus one
+	uint32_t			elementWords;	// Size of the element, in words
+	volatile uint32_t	head;			// Elements pushed, written by the producer
+	volatile uint32_t	tail;			// Elements popped, written by the consumer
+} spsc_ring_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Creates a ring instance from the buffer and size specified by user. Both sizes
+ * 		  are checked with SPSC_RING_CHECK() where the buffer is declared.
+ * @param buffer		Pointer to the array reserved in memory, word aligned
+ * @param capacity		Amount of elements in the array, a power of two
+ * @param elementSize	Size in bytes of the element, a multiple of four
+ */
+spsc_ring_t createSpscRing(void* buffer, size_t capacity, size_t elementSize);
+
+/**
+ * @brief Copies an element into the ring, returns false if the ring was full.
+ * 		  Only called by the producer.
+ * @param ring		Pointer to the ring instance
+ * @param element	Pointer to the element to be pushed
+ */
+bool spscRingPush(spsc_ring_t* ring, const void* element);
+
+/**
+ * @brief Copies the next element out of the ring, returns false if the ring was empty.
+ * 		  Only called by the consumer.
+ * @param ring		Pointer to the ring instance
+ * @param element	Pointer to where the element is copied
+ */
+bool spscRingPop(spsc_ring_t* ring, void* element);
+
+/**
+ * @brief Returns the amount of elements in the ring. Exact for the consumer, as the
+ * 		  producer can only push more.
+ * @param ring		Pointer to the ring instance
+ */
+uint32_t spscRingSize(spsc_ring_t* ring);
+
+/**
+ * @brief Returns whether the ring is empty or not
+ * @param ring		Pointer to the ring instance
+ */
+bool spscRingIsEmpty(spsc_ring_t* ring);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* SPSC_RING_H_ */
@@ -0,0 +1,93 @@
+/*******************************************************************************
+  @file     triple_buffer.c
+  @brief    Lock-free triple buffer, for one writer and one reader
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "triple_buffer.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define TRIPLE_BUFFER_INDEX_MASK	0x03
+#define TRIPLE_BUFFER_FRESH			0x04
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+triple_buffer_t createTripleBuffer(void* first, void* second, void* third)
+{
+	triple_buffer_t tb = {
+		.buffers = { first, second, third },
+		.back = 0,
+		.middle = 1,
+		.front = 2
+	};
+	return tb;
+}
+
+void* tripleBufferWriteBuffer(triple_buffer_t* tb)
+{
+	return tb->buffers[tb->back];
+}
+
+void tripleBufferPublish(triple_buffer_t* tb)
+{
+	// The release ordering makes the buffer contents visible before its index
+	uint8_t previous = __atomic_exchange_n(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+	tb->back = previous & TRIPLE_BUFFER_INDEX_MASK;
+}
+
+bool tripleBufferAcquire(triple_buffer_t* tb)
+{
+	bool fresh = false;
+	if (__atomic_load_n(&tb->middle, __ATOMIC_ACQUIRE) & TRIPLE_BUFFER_FRESH)
+	{
+		uint8_t previous = __atomic_exchange_n(&tb->middle, tb->front, __ATOMIC_ACQ_REL);
+		tb->front = previous & TRIPLE_BUFFER_INDEX_MASK;
+		fresh = true;
+	}
+	return fresh;
+}
+
+void* tripleBufferReadBuffer(triple_buffer_t* tb)
+{
+	return tb->buffers[tb->front];
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/*******************************************************************************
+ ******************************************************************************/
@@ -0,0 +1,80 @@
+/*******************************************************************************
+  @file     triple_buffer.h
+  @brief    Lock-free triple buffer, for one writer and one reader
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// The writer always owns the back buffer and the reader the front buffer, so
+// neither of them ever waits. Publishing swaps the back buffer with the middle
+// one, and acquiring swaps the middle buffer with the front one, when it holds
+// fresh data. Each swap is a single atomic exchange of the middle index.
+typedef struct {
+	void*				buffers[3];		// Pointers to the arrays reserved in memory
+	uint8_t				back;			// Index of the buffer being written, owned by the writer
+	uint8_t				front;			// Index of the buffer being read, owned by the reader
+	volatile uint8_t	middle;			// Index of the buffer in between, plus the fresh data flag
+} triple_buffer_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Creates a triple buffer instance from the three buffers given by the user
+ * @param first		Pointer to the first array reserved in memory
+ * @param second	Pointer to the second array reserved in memory
+ * @param third		Pointer to the third array reserved in memory
+ */
+triple_buffer_t createTripleBuffer(void* first, void* second, void* third);
+
+/**
+ * @brief Returns the buffer the writer should fill before publishing it
+ * @param tb		Pointer to the triple buffer instance
+ */
+void* tripleBufferWriteBuffer(triple_buffer_t* tb);
+
+/**
+ * @brief Publishes the write buffer, which becomes the latest data. Only called by the writer.
+ * @param tb		Pointer to the triple buffer instance
+ */
+void tripleBufferPublish(triple_buffer_t* tb);
+
+/**
+ * @brief Takes the latest published data, if there is any newer than the current
+ * 		  read buffer, and returns whether it did. Only called by the reader.
+ * @param tb		Pointer to the triple buffer instance
+ */
+bool tripleBufferAcquire(triple_buffer_t* tb);
+
+/**
+ * @brief Returns the buffer the reader owns, with the data last acquired
+ * @param tb		Pointer to the triple buffer instance
+ */
+void* tripleBufferReadBuffer(triple_buffer_t* tb);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif
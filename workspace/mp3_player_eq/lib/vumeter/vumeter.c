@@ -8,17 +8,23 @@
  * INCLUDE HEADER FILES
  ******************************************************************************/
 
-#include "drivers/HAL/timer/timer.h"
 #include "vumeter.h"
-#include <math.h>
+
+#include <string.h>
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
-#define GRAPHIC_MODE_MASK  	0xF
+#define GRAPHIC_MODE_MASK  	0x3F
 #define SCALE_MODE_MASK		0xC0
-#define NUMBER_OF_ROWS		8
+
+// Level smoothing, levels are handled with 8 fractional bits
+#define LEVEL_FRACTION		8
+#define LEVEL_ATTACK		192		// Fraction of the rise applied per frame, out of 256
+#define LEVEL_RELEASE		48		// Fraction of the fall applied per frame, out of 256
+#define PEAK_HOLD			10		// Frames the peak marker is held
+#define PEAK_FALL			2		// Levels the peak marker falls per frame
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -28,14 +34,25 @@
  * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static void modeDispatcher(vumeter_modes_t mode, pixel_t* col);
+/**
+ * @brief Computes the value thresholds of each amount of rows, for the scale of the vumeter.
+ * @param vumeter	Vumeter state
+ */
+static void vumeterBuildThresholds(vumeter_t* vumeter);
 
 /**
- * @brief Generates matrix for bar vumeter
- * @param stream 	Array of digits, length DISPLAY_LENGTH
+ * @brief Computes the rows and colour of each rank of a bar, for the graphic mode of the vumeter.
+ * @param vumeter	Vumeter state
  */
-static void barMode(pixel_t* col);
-static void centreMode(pixel_t* col);
+static void vumeterBuildRows(vumeter_t* vumeter);
+
+/**
+ * @brief Pushes a row to the waterfall history, and draws the history on the matrix.
+ * @param vumeter	Vumeter state
+ * @param matrix	Row major matrix
+ * @param heights	Rows lit by the value of each column
+ */
+static void vumeterDrawWaterfall(vumeter_t* vumeter, pixel_t* matrix, const uint8_t* heights);
 
 /*******************************************************************************
  * VARIABLES WITH GLOBAL SCOPE
@@ -45,7 +62,19 @@ static void centreMode(pixel_t* col);
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-const pixel_t vumeterPixelColours[NUMBER_OF_ROWS] = {
+// Lowest power of each level of the logarithmic scale, 0.75dB apart. Full scale is UINT32_MAX.
+static const uint32_t vumeterLevelThresholds[VUMETER_LEVEL_MAX] = {
+	68071u, 80902u, 96152u, 114277u, 135819u, 161421u, 191849u, 228013u,
+	270994u, 322077u, 382789u, 454946u, 540704u, 642628u, 763765u, 907737u,
+	1078847u, 1282212u, 1523912u, 1811173u, 2152583u, 2558349u, 3040604u, 3613765u,
+	4294967u, 5104578u, 6066803u, 7210408u, 8569586u, 10184973u, 12104863u, 14386656u,
+	17098573u, 20321692u, 24152376u, 28705153u, 34116138u, 40547106u, 48190326u, 57274309u,
+	68070644u, 80902112u, 96152341u, 114277271u, 135818791u, 161420936u, 191849142u, 228013133u,
+	270994116u, 322077110u, 382789363u, 454946011u, 540704347u, 642628321u, 763765191u, 907736630u,
+	1078847007u, 1282212071u, 1523911903u, 1811172691u, 2152582777u, 2558349425u, 3040603991u, 3613764616u
+};
+
+static const pixel_t vumeterPixelColours[VUMETER_MAX_ROWS] = {
 	{255,0,0},
 	{255,0,0},
 	{255,0,0},
@@ -56,13 +85,12 @@ const pixel_t vumeterPixelColours[NUMBER_OF_ROWS] = {
 	{0, 255, 0},
 };
 
+static const pixel_t clearPixel = {0,0,0};
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static uint8_t normalizedValue;
-static uint8_t amountOfCols;
 
 /*******************************************************************************
  *******************************************************************************
@@ -70,36 +98,137 @@ static uint8_t amountOfCols;
  *******************************************************************************
  ******************************************************************************/
 
-void vumeterMultiple(pixel_t* input, float* colValues, uint8_t colQty, double fullScale, vumeter_modes_t mode)
+void vumeterInit(vumeter_t* vumeter, uint8_t rows, uint8_t cols, uint32_t fullScale, vumeter_modes_t mode)
 {
-	for(int i = 0; i < colQty; i++)
+	// At least one pixel, the tables of the mode divide by the rows
+	vumeter->rows = rows > VUMETER_MAX_ROWS ? VUMETER_MAX_ROWS : (rows ? rows : 1);
+	vumeter->cols = cols > VUMETER_MAX_COLS ? VUMETER_MAX_COLS : (cols ? cols : 1);
+	vumeter->fullScale = fullScale;
+	memset(vumeter->smoothLevel, 0, sizeof(vumeter->smoothLevel));
+	memset(vumeter->peakLevel, 0, sizeof(vumeter->peakLevel));
+	memset(vumeter->peakHold, 0, sizeof(vumeter->peakHold));
+	vumeterSetMode(vumeter, mode);
+}
+
+void vumeterSetMode(vumeter_t* vumeter, vumeter_modes_t mode)
+{
+	vumeter->mode = mode;
+	vumeterBuildThresholds(vumeter);
+	vumeterBuildRows(vumeter);
+
+	// Empty waterfall history
+	for(uint8_t i = 0; i < vumeter->rows; i++)
 	{
-		vumeterSingle(input + i, colValues[i], colQty, fullScale, mode);
+		for(uint8_t j = 0; j < vumeter->cols; j++)
+		{
+			vumeter->history[i][j] = clearPixel;
+		}
 	}
+	vumeter->historyHead = 0;
 }
 
-void vumeterSingle(pixel_t* col, float value, uint8_t colQty, double fullScale, vumeter_modes_t vumeterMode)
+void vumeterDraw(vumeter_t* vumeter, pixel_t* matrix, const uint32_t* values)
 {
-	vumeter_modes_t graphicMode = vumeterMode & GRAPHIC_MODE_MASK;
-	vumeter_modes_t scaleMode = vumeterMode & SCALE_MODE_MASK;
-	amountOfCols = colQty;
+	vumeter_modes_t graphicMode = vumeter->mode & GRAPHIC_MODE_MASK;
+	uint8_t heights[VUMETER_MAX_COLS];
+
+	for(uint8_t j = 0; j < vumeter->cols; j++)
+	{
+		heights[j] = vumeterValueToRows(vumeter, values[j]);
+		if(vumeter->halfHeight)
+		{
+			heights[j] /= 2;
+		}
+	}
 
-	if(scaleMode == LOGARITHMIC_MODE)
+	if(graphicMode == WATERFALL_MODE)
 	{
-		if(value < 1)
+		vumeterDrawWaterfall(vumeter, matrix, heights);
+		return;
+	}
+
+	// Column by column over a black matrix, each rank of the bar has a single colour and lights one or two rows
+	memset(matrix, 0, vumeter->rows * vumeter->cols * sizeof(pixel_t));
+	for(uint8_t j = 0; j < vumeter->cols; j++)
+	{
+		uint8_t rank = (graphicMode == DOT_MODE && heights[j]) ? heights[j] - 1 : 0;
+		for(; rank < heights[j]; rank++)
 		{
-			normalizedValue = 0;
+			pixel_t colour = vumeter->rankColour[rank];
+			matrix[vumeter->rankRows[rank][0] * vumeter->cols + j] = colour;
+			if(vumeter->halfHeight)
+			{
+				matrix[vumeter->rankRows[rank][1] * vumeter->cols + j] = colour;
+			}
+		}
+	}
+}
+
+uint8_t vumeterValueToRows(const vumeter_t* vumeter, uint32_t value)
+{
+	// Amount of thresholds below the value, counted without branches
+	uint8_t rows = 0;
+	for(uint8_t i = 0; i < vumeter->rows; i++)
+	{
+		rows += (value >= vumeter->rowThresholds[i]);
+	}
+	return rows;
+}
+
+uint8_t vumeterPowerToLevel(uint32_t power)
+{
+	// Binary search of the amount of thresholds below the power
+	uint8_t low = 0;
+	uint8_t high = VUMETER_LEVEL_MAX;
+	while(low < high)
+	{
+		uint8_t middle = (low + high) / 2;
+		if(power >= vumeterLevelThresholds[middle])
+		{
+			low = middle + 1;
 		}
 		else
 		{
-			normalizedValue = (int)(log10(value) / log10(fullScale) * NUMBER_OF_ROWS + 0.5);
+			high = middle;
 		}
 	}
-	else if(scaleMode == LINEAR_MODE)
+	return low;
+}
+
+void vumeterUpdateLevels(vumeter_t* vumeter, const uint32_t* powers, vumeter_level_t* levels)
+{
+	uint32_t target;
+
+	for(uint8_t j = 0; j < vumeter->cols; j++)
 	{
-		normalizedValue = (int)(value / fullScale * NUMBER_OF_ROWS + 0.5);
+		// Smooth the level, rising fast and falling slowly
+		target = (uint32_t)vumeterPowerToLevel(powers[j]) << LEVEL_FRACTION;
+		if(target > vumeter->smoothLevel[j])
+		{
+			vumeter->smoothLevel[j] += ((target - vumeter->smoothLevel[j]) * LEVEL_ATTACK) >> 8;
+		}
+		else
+		{
+			vumeter->smoothLevel[j] -= ((vumeter->smoothLevel[j] - target) * LEVEL_RELEASE) >> 8;
+		}
+		levels[j].level = (vumeter->smoothLevel[j] + (1 << (LEVEL_FRACTION - 1))) >> LEVEL_FRACTION;
+
+		// Hold the peak, then let it fall
+		if(levels[j].level >= vumeter->peakLevel[j])
+		{
+			vumeter->peakLevel[j] = levels[j].level;
+			vumeter->peakHold[j] = PEAK_HOLD;
+		}
+		else if(vumeter->peakHold[j])
+		{
+			vumeter->peakHold[j]--;
+		}
+		else
+		{
+			vumeter->peakLevel[j] = vumeter->peakLevel[j] > PEAK_FALL ? vumeter->peakLevel[j] - PEAK_FALL : 0;
+		}
+		levels[j].peak = vumeter->peakLevel[j] > levels[j].level ? vumeter->peakLevel[j] : levels[j].level;
 	}
-	modeDispatcher(graphicMode, col);
 }
 
 /*******************************************************************************
@@ -108,43 +237,78 @@ void vumeterSingle(pixel_t* col, float value, uint8_t colQty, double fullScale,
  *******************************************************************************
  ******************************************************************************/
 
-static void modeDispatcher(vumeter_modes_t mode, pixel_t* col)
+static void vumeterBuildThresholds(vumeter_t* vumeter)
 {
-	switch (mode)
+	uint64_t fullScale = vumeter->fullScale;
+	uint8_t rows = vumeter->rows;
+
+	for(uint8_t i = 0; i < rows; i++)
 	{
-		case BAR_MODE:
-			barMode(col);
-			break;
-		case CENTRE_MODE:
-			centreMode(col);
-			break;
-		default:
-			break;
+		if((vumeter->mode & SCALE_MODE_MASK) == LOGARITHMIC_MODE)
+		{
+			// Row i is lit from the middle level of the row, the power is scaled from UINT32_MAX to the full scale
+			uint8_t levelsPerRow = VUMETER_LEVEL_MAX / rows;
+			uint64_t power = vumeterLevelThresholds[levelsPerRow * i + levelsPerRow / 2 - 1];
+			vumeter->rowThresholds[i] = (power * fullScale + UINT32_MAX - 1) / UINT32_MAX;
+		}
+		else
+		{
+			// Row i is lit from the middle of the row, rounding the value to the nearest row
+			vumeter->rowThresholds[i] = ((2 * i + 1) * fullScale + 2 * rows - 1) / (2 * rows);
+		}
 	}
 }
 
-static void barMode(pixel_t* col)
+static void vumeterBuildRows(vumeter_t* vumeter)
 {
-	// Filling the colour matrix for bar mode
-	for(uint8_t i = 0; i < normalizedValue; i++)
+	vumeter_modes_t graphicMode = vumeter->mode & GRAPHIC_MODE_MASK;
+	uint8_t rows = vumeter->rows;
+	uint8_t half = rows / 2;
+
+	vumeter->halfHeight = (graphicMode == CENTRE_MODE) || (graphicMode == MIRRORED_MODE);
+	for(uint8_t i = 0; i < rows; i++)
 	{
-		col[amountOfCols*i].r = vumeterPixelColours[i].r;
-		col[amountOfCols*i].g = vumeterPixelColours[i].g;
-		col[amountOfCols*i].b = vumeterPixelColours[i].b;
+		switch(graphicMode)
+		{
+			case CENTRE_MODE:
+				vumeter->rankRows[i][0] = half + i;
+				vumeter->rankRows[i][1] = half - 1 - i;
+				break;
+			case MIRRORED_MODE:
+				vumeter->rankRows[i][0] = i;
+				vumeter->rankRows[i][1] = rows - 1 - i;
+				break;
+			default:
+				vumeter->rankRows[i][0] = i;
+				vumeter->rankRows[i][1] = i;
+				break;
+		}
+		vumeter->rankColour[i] = vumeterPixelColours[i * VUMETER_MAX_ROWS / rows];
 	}
 }
 
-static void centreMode(pixel_t* col)
+static void vumeterDrawWaterfall(vumeter_t* vumeter, pixel_t* matrix, const uint8_t* heights)
 {
-	// Filling the colour matrix for centre mode
-	for(uint8_t i = 0; i < normalizedValue/2; i++)
+	uint8_t rows = vumeter->rows;
+	pixel_t* newest;
+
+	// The oldest row of the ring is overwritten with the newest one, no row is moved
+	vumeter->historyHead = (vumeter->historyHead + 1 < rows) ? vumeter->historyHead + 1 : 0;
+	newest = vumeter->history[vumeter->historyHead];
+	for(uint8_t j = 0; j < vumeter->cols; j++)
+	{
+		newest[j] = heights[j] ? vumeter->rankColour[heights[j] - 1] : clearPixel;
+	}
+
+	// Newest row on the last row of the matrix, the older ones before it
+	uint8_t index = vumeter->historyHead;
+	for(uint8_t i = 0; i < rows; i++)
 	{
-		col[amountOfCols*NUMBER_OF_ROWS/2 + i*amountOfCols].r = vumeterPixelColours[i].r;
-		col[amountOfCols*NUMBER_OF_ROWS/2 + i*amountOfCols].g = vumeterPixelColours[i].g;
-		col[amountOfCols*NUMBER_OF_ROWS/2 + i*amountOfCols].b = vumeterPixelColours[i].b;
-		col[amountOfCols*(NUMBER_OF_ROWS/2 - 1) - i*amountOfCols].r = vumeterPixelColours[i].r;
-		col[amountOfCols*(NUMBER_OF_ROWS/2 - 1) - i*amountOfCols].g = vumeterPixelColours[i].g;
-		col[amountOfCols*(NUMBER_OF_ROWS/2 - 1) - i*amountOfCols].b = vumeterPixelColours[i].b;
+		index = (index + 1 < rows) ? index + 1 : 0;
+		for(uint8_t j = 0; j < vumeter->cols; j++)
+		{
+			*matrix++ = vumeter->history[index][j];
+		}
 	}
 }
 
@@ -18,14 +18,23 @@
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
+#define VUMETER_LEVELS_PER_ROW	8		// Levels of vumeterPowerToLevel per row, each level is 0.75dB
+#define VUMETER_LEVEL_MAX		64		// Level of a full scale power
+
+#define VUMETER_MAX_ROWS		8		// Largest matrix a vumeter can draw
+#define VUMETER_MAX_COLS		8
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
 typedef enum {
 	// Graphic Modes
-	BAR_MODE	= 0b00000001,
-	CENTRE_MODE	= 0b00000010,
+	BAR_MODE		= 0b00000001,	// Bars growing from the first row
+	CENTRE_MODE		= 0b00000010,	// Bars growing from the centre rows to both edges
+	DOT_MODE		= 0b00000100,	// Only the top pixel of each bar
+	MIRRORED_MODE	= 0b00001000,	// Bars growing from both edges to the centre rows
+	WATERFALL_MODE	= 0b00010000,	// History of the values, one row per frame, newest on the last row
 
 	// Scale Modes
 	LINEAR_MODE = 0b01000000,
@@ -38,6 +47,38 @@ typedef struct {
   uint8_t b;
 } pixel_t;
 
+typedef struct {
+  uint8_t level;    // Smoothed level of the column, from 0 to VUMETER_LEVEL_MAX
+  uint8_t peak;     // Level of the peak marker, held and then falling
+} vumeter_level_t;
+
+/*
+ * Vumeter state. Every field is private, and set by vumeterInit. The drawing
+ * functions only use the state they are given, so many vumeters can be used at once.
+ */
+typedef struct {
+  // Configuration
+  uint8_t			rows;
+  uint8_t			cols;
+  uint32_t			fullScale;
+  vumeter_modes_t	mode;
+
+  // Tables precomputed for the mode
+  uint32_t			rowThresholds[VUMETER_MAX_ROWS];	// Lowest value lighting each amount of rows
+  uint8_t			rankRows[VUMETER_MAX_ROWS][2];		// Rows lit by each rank of a bar, the second one for split bars
+  pixel_t			rankColour[VUMETER_MAX_ROWS];		// Colour of each rank of a bar
+  bool				halfHeight;							// Bars are split in two halves
+
+  // Waterfall history, a ring of rows where historyHead is the newest one
+  pixel_t			history[VUMETER_MAX_ROWS][VUMETER_MAX_COLS];
+  uint8_t			historyHead;
+
+  // Level smoothing of each column, with 8 fractional bits, and peak markers
+  uint32_t			smoothLevel[VUMETER_MAX_COLS];
+  uint8_t			peakLevel[VUMETER_MAX_COLS];
+  uint8_t			peakHold[VUMETER_MAX_COLS];
+} vumeter_t;
+
 /*******************************************************************************
  * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -51,24 +92,54 @@ typedef struct {
  ******************************************************************************/
 
 /**
- * @brief Run the vumeter for each column of the given matrix, with the given values.
- * @param input			Input matrix
- * @param colValues		Array with the values
- * @param colQty		Amount of columns
- * @param fullScale		Full scale range
- * @param mode			Vumeter mode
+ * @brief Initializes a vumeter, computing the tables of its mode.
+ * @param vumeter		Vumeter state
+ * @param rows			Rows of the matrix, from 1 to VUMETER_MAX_ROWS, clamped to that range
+ * @param cols			Columns of the matrix, from 1 to VUMETER_MAX_COLS, clamped to that range
+ * @param fullScale		Value lighting all the rows
+ * @param mode			Graphic mode and scale mode, values must be a power when using the logarithmic scale
+ */
+void vumeterInit(vumeter_t* vumeter, uint8_t rows, uint8_t cols, uint32_t fullScale, vumeter_modes_t mode);
+
+/**
+ * @brief Changes the mode of a vumeter. The waterfall history is cleared.
+ * @param vumeter		Vumeter state
+ * @param mode			Graphic mode and scale mode
+ */
+void vumeterSetMode(vumeter_t* vumeter, vumeter_modes_t mode);
+
+/**
+ * @brief Draws one value per column in a matrix, every pixel of the matrix is written.
+ * @param vumeter		Vumeter state
+ * @param matrix		Row major matrix, of rows x cols pixels
+ * @param values		Value of each column
+ */
+void vumeterDraw(vumeter_t* vumeter, pixel_t* matrix, const uint32_t* values);
+
+/**
+ * @brief Converts a value to the amount of rows it lights, with the scale of the vumeter.
+ * @param vumeter		Vumeter state
+ * @param value			Value to convert
+ * @return Amount of rows, from 0 to the rows of the vumeter
+ */
+uint8_t vumeterValueToRows(const vumeter_t* vumeter, uint32_t value);
+
+/**
+ * @brief Converts a power to a level of the logarithmic scale, using a dB lookup table.
+ * @param power		Power, where UINT32_MAX is the full scale
+ * @return Level, from 0 to VUMETER_LEVEL_MAX, in steps of 0.75dB. Level 0 is below -48dB.
  */
-void vumeterMultiple(pixel_t* input, float* colValues, uint8_t colQty, double fullScale, vumeter_modes_t mode);
+uint8_t vumeterPowerToLevel(uint32_t power);
 
 /**
- * @brief Run the vumeter for a single column.
- * @param col
- * @param value
- * @param colQty
- * @param fullScale
- * @param vumeterMode
+ * @brief Converts the power of each column to a level, using the dB lookup table, with
+ *        attack and release smoothing and a peak marker that is held before falling.
+ *        Must be called once per displayed frame.
+ * @param vumeter	Vumeter state, keeps the smoothing of each column
+ * @param powers	Power of each column, UINT32_MAX being the full scale
+ * @param levels	Array to store the level and peak of each column
  */
-void vumeterSingle(pixel_t* col, float value, uint8_t colQty, double fullScale, vumeter_modes_t vumeterMode);
+void vumeterUpdateLevels(vumeter_t* vumeter, const uint32_t* powers, vumeter_level_t* levels);
 
 /*******************************************************************************
  * EVENT GENERATORS INTERFACE
@@ -13,16 +13,42 @@
 #include "events/events.h"
 #include "display/display.h"
 #include "ui/ui.h"
+#include "visualiser/visualiser.h"
+#include "cpu_load/cpu_load.h"
+#include "scheduler/scheduler.h"
 #include "lib/fatfs/ff.h"
+#include "drivers/HAL/work_queue/work_queue.h"
+#include "drivers/HAL/trace/trace.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
+// Budgets of the slices of the tasks, the audio refill must end well before the other
+// DAC buffer, of about 93 ms at 44.1 kHz, is played
+#define APP_AUDIO_REFILL_BUDGET_US		(20000)
+#define APP_LCD_BUDGET_US				(WORK_QUEUE_RUN_US)	// Kept by workQueueRun() itself
+#define APP_INPUT_BUDGET_US				(5000)
+#define APP_DECODER_PREFETCH_BUDGET_US	(15000)		// One frame of the decoder
+#define APP_LIBRARY_SCAN_BUDGET_US		(5000)		// A few entries of the directory
+#define APP_VISUALISER_BUDGET_US		(5000)
+
 /*******************************************************************************
  * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
+/**
+ * @brief Refills the DAC buffer played, the highest priority task.
+ * @return True if there was a buffer to be refilled
+ */
+static bool appAudioRefillTask(void);
+
+/**
+ * @brief Runs the user input and the SD card detection, through the UI and the audio.
+ * @return True if there was an event waiting
+ */
+static bool appInputTask(void);
+
 /*******************************************************************************
  * VARIABLES TYPES DEFINITIONS
  ******************************************************************************/
@@ -31,7 +57,6 @@
  * PRIVATE VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static event_t 	event;		// Application loop events
 static FATFS	fs;			// File system handler
 
 /*******************************************************************************
@@ -44,22 +69,37 @@ void appInit (void)
 {
 	// Initialization of drivers
 	boardInit();
+	cpuLoadInit();
+	schedulerInit();
  	eventsInit();
 	displayInit();
 	uiInit();
 	audioInit();
+	visualiserInit();
 
 	// FatFs mounting
 	f_mount(&fs, "", 0);
+
+	// Tasks of the main loop, by priority
+	schedulerAddTask(appAudioRefillTask, APP_AUDIO_REFILL_BUDGET_US, CPU_LOAD_AUDIO);
+	schedulerAddTask(workQueueRun, APP_LCD_BUDGET_US, CPU_LOAD_WORK_QUEUE);
+	schedulerAddTask(appInputTask, APP_INPUT_BUDGET_US, CPU_LOAD_UI);
+	schedulerAddTask(audioPrefetch, APP_DECODER_PREFETCH_BUDGET_US, CPU_LOAD_AUDIO);
+	schedulerAddTask(uiScan, APP_LIBRARY_SCAN_BUDGET_US, CPU_LOAD_UI);
+	schedulerAddTask(visualiserRun, APP_VISUALISER_BUDGET_US, CPU_LOAD_VISUALISER);
 }
 
 void appRun (void)
 {
-	event = eventsGetNextEvent();
-	if (event.id != EVENTS_NONE)
+	// Dump of the trace, when requested from the debugger
+	cpuLoadSwitch(CPU_LOAD_OTHER);
+	traceRun();
+
+	// Nothing left to do until the next interrupt
+	if (!schedulerRun())
 	{
-		uiRun(event);
-		audioRun(event);
+		cpuLoadSwitch(CPU_LOAD_OTHER);
+		eventsWait();
 	}
 }
 
@@ -69,6 +109,35 @@ void appRun (void)
  *******************************************************************************
  ******************************************************************************/
 
+static bool appAudioRefillTask(void)
+{
+	event_t event = eventsGetNextEventOfClass(EVENTS_CLASS_AUDIO);
+
+	if (event.id != EVENTS_NONE)
+	{
+		audioRun(event);
+	}
+
+	return event.id != EVENTS_NONE;
+}
+
+static bool appInputTask(void)
+{
+	event_t event = eventsGetNextEventOfClass(EVENTS_CLASS_INPUT);
+
+	if (event.id == EVENTS_NONE)
+	{
+		event = eventsGetNextEventOfClass(EVENTS_CLASS_HOUSEKEEPING);
+	}
+
+	if (event.id != EVENTS_NONE)
+	{
+		uiRun(event);
+		audioRun(event);
+	}
+
+	return event.id != EVENTS_NONE;
+}
 
 /*******************************************************************************
  ******************************************************************************/
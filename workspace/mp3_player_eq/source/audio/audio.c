@@ -17,15 +17,19 @@
 
 #include "drivers/HAL/HD44780_LCD/HD44780_LCD.h"
 #include "drivers/MCAL/equaliser/equaliser_iir.h"
+#include "drivers/MCAL/equaliser/equaliser.h"
 #include "drivers/MCAL/dac_dma/dac_dma.h"
-#include "drivers/MCAL/cfft/cfft.h"
 #include "drivers/HAL/timer/timer.h"
+#include "drivers/HAL/trace/trace.h"
 #include "drivers/MCAL/gpio/gpio.h"
+#include "drivers/MCAL/timebase/timebase.h"
 
 #include "lib/mp3decoder/mp3decoder.h"
-#include "lib/vumeter/vumeter.h"
 #include "lib/fatfs/ff.h"
+#include "visualiser/visualiser.h"
 #include "display/display.h"
+#include "memory/memory_plan.h"
+#include "hardware.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -37,18 +41,19 @@
 #define AUDIO_LCD_ROTATION_TIME_MS  	  		(350)
 #define AUDIO_LCD_LINE_NUMBER       	  		(0)
 #define AUDIO_FRAME_SIZE 				            (4096)
-#define AUDIO_FULL_SCALE 				            (82e3)
 #define AUDIO_DEFAULT_SAMPLE_RATE       		(44100)
 #define AUDIO_MAX_FILENAME_LEN          		(128)
 #define AUDIO_BUFFER_COUNT              		(2)
 #define AUDIO_BUFFER_SIZE               		(4096)
+#define AUDIO_DECODED_BUFFER_SIZE           (MP3_DECODED_BUFFER_SIZE + 2 * AUDIO_BUFFER_SIZE)
 #define AUDIO_FLOAT_MAX                 		(1)
 #define AUDIO_MAX_VOLUME                    (100)
 #define AUDIO_VOLUME_DURATION_MS            (2000)
 
-#define AUDIO_ENABLE_FFT
 #define AUDIO_ENABLE_EQ
+// #define AUDIO_EQ_FIR                  // Equalises with the combined FIR of equaliser.h instead of the IIR cascade
 #define AUDIO_DEBUG_MODE
+// #define AUDIO_BENCHMARK_MODE       // Cycles taken by audioProcess, compare with and without SRAM_PLACEMENT
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -63,6 +68,21 @@ typedef enum {
   AUDIO_STATE_COUNT
 } audio_state_t;
 
+// Working buffers of audioProcess, overlaid by the phase they are used in
+typedef union {
+  // Filtering, from the decoded samples to the equalised ones
+  struct {
+    q15_t                   output[AUDIO_BUFFER_SIZE];
+    q15_t                   input[AUDIO_BUFFER_SIZE];
+  } filter;
+
+  // Conversion of the equalised samples, before writing the DAC frame
+  struct {
+    q15_t                   output[AUDIO_BUFFER_SIZE];    // Kept from the filtering phase
+    float32_t               outputF32[AUDIO_BUFFER_SIZE];
+  } convert;
+} audio_arena_t;
+
 typedef struct {
   // Flags
   bool                      alreadyInit;      // Whether it has been already initialized or not
@@ -76,34 +96,16 @@ typedef struct {
   uint32_t                  currentIndex;                     		// Index of the current file in the directory
   audio_state_t             currentState;                     		// State of current audio
 
-  // Audio output buffer
-  uint16_t                  audioBuffer[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SIZE];
-
-  // Display data
-  struct {
-    pixel_t                 displayMatrix[DISPLAY_COL_SIZE][DISPLAY_COL_SIZE];
-    float                   colValues[DISPLAY_COL_SIZE];
-  } display;
-  
   // MP3 data
   struct {
     mp3decoder_tag_data_t     tagData;
     mp3decoder_frame_data_t   frameData;              
     uint32_t                  sampleRate;        
-    int16_t                   buffer[MP3_DECODED_BUFFER_SIZE + 2 * AUDIO_BUFFER_SIZE];  
+    int16_t                   buffer[AUDIO_DECODED_BUFFER_SIZE];  
     uint16_t                  samples;       
+    mp3decoder_result_t       prefetchResult;     // Stops the prefetch until the next refill, or until the next song at the end of the file
   } mp3;      
   
- struct {
-   float32_t input[AUDIO_FRAME_SIZE * 2];
-   float32_t output[AUDIO_FRAME_SIZE * 2];
- } fft;
-
- struct {
-	 q15_t input[AUDIO_BUFFER_SIZE];
-   q15_t output[AUDIO_BUFFER_SIZE];
- } eq;
-
   // Volume and message buffers
   uint8_t volume;
   bool    mute;
@@ -113,6 +115,16 @@ typedef struct {
 
   bool    eqEnabled;
 
+#ifdef AUDIO_BENCHMARK_MODE
+  // Cycles taken by audioProcess, while the DMA keeps feeding the DAC and the display
+  struct {
+    uint32_t                last;
+    uint32_t                min;
+    uint32_t                max;
+    uint32_t                count;
+  } benchmark;
+#endif
+
 } audio_context_t;
 
 /*******************************************************************************
@@ -176,11 +188,6 @@ static void audioSetDisplayString(const char* message);
  */
 static void audioLcdUpdate(void);
 
-/**
- * @brief Fills matrix with colValues
- */
-static void audioFillMatrix(void);
-
 /**
  * @brief Play an audio file
  * @param file    Filename of the audio
@@ -211,18 +218,16 @@ void  onVolumeTimeout(void);
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
- 
-// Mapping the FFT bin to the led matrix columns, according to the equaliser band-pass frequency.                   
-//                                        80Hz    150Hz   330Hz   680Hz     1,2kHz    3,9kHz    12kHz     18kHz
-static const uint32_t FFT_COLUMN_BIN[] = { 2 * 4,      8 * 4,      16 * 4,       28 * 4,		56 * 4,       91 * 4,       180 * 4,		350*4};
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
 static audio_context_t  context;
-static const pixel_t    clearPixel = {0,0,0};
-static float32_t        filterOutputF32[AUDIO_FRAME_SIZE];
+static uint16_t         audioBuffer[AUDIO_BUFFER_COUNT][AUDIO_BUFFER_SIZE] __SRAM_U_BSS__;   // Read by the DMA
+static audio_arena_t    arena __SRAM_L_BSS__;                                              // Only used by the core
+
+MEMORY_CHECK_BUDGET(sizeof(context) + sizeof(audioBuffer) + sizeof(arena), MEMORY_BUDGET_AUDIO);
 
 /*******************************************************************************
  *******************************************************************************
@@ -236,10 +241,11 @@ void audioInit(void)
   {
 #ifdef AUDIO_ENABLE_EQ
     context.eqEnabled = true;
-    // eqInit(AUDIO_FRAME_SIZE);
-    // arm_float_to_q15(eqCoeffsTestFloat, eqCoeffsTest, 8*6*3);
-    // arm_biquad_cascade_df1_init_q15(&filterTest, 8*3, eqCoeffsTest, filterStateTest, 1);
+#ifdef AUDIO_EQ_FIR
+    eqInit(AUDIO_FRAME_SIZE);
+#else
     eqIirInit();
+#endif
 #endif
 
     // Raise the already initialized flag
@@ -252,22 +258,25 @@ void audioInit(void)
     context.volumeTimer = timerGetId();
     
     // Initialization of the timer
-    timerStart(timerGetId(), TIMER_MS2TICKS(AUDIO_LCD_FPS_MS), TIM_MODE_PERIODIC, audioLcdUpdate);
+    timerStartDeferred(timerGetId(), TIMER_MS2TICKS(AUDIO_LCD_FPS_MS), TIM_MODE_PERIODIC, audioLcdUpdate);
 
-    // FFT initialization
-    cfftInit(CFFT_4096);
-    
     // MP3 Decoder init
     MP3DecoderInit();
 
     // DAC DMA init
     dacdmaInit();
-    dacdmaSetBuffers(context.audioBuffer[0], context.audioBuffer[1], AUDIO_BUFFER_SIZE);
+    dacdmaSetBuffers(audioBuffer[0], audioBuffer[1], AUDIO_BUFFER_SIZE);
     dacdmaSetFreq(AUDIO_DEFAULT_SAMPLE_RATE);
 
 #ifdef AUDIO_DEBUG_MODE
     gpioMode(PIN_PROCESSING, OUTPUT);
 #endif
+
+#ifdef AUDIO_BENCHMARK_MODE
+    // Enable the cycle counter
+    timebaseInit();
+    context.benchmark.min = UINT32_MAX;
+#endif
   }
 }
 
@@ -305,6 +314,26 @@ void audioRun(event_t event)
   }
 }
 
+bool audioPrefetch(void)
+{
+  uint16_t sampleCount;
+  bool prefetched = false;
+
+  // One frame at a time, while the one after the samples waiting still fits in the buffer
+  if ((context.currentState == AUDIO_STATE_PLAYING) && (context.mp3.prefetchResult == MP3DECODER_NO_ERROR) &&
+      (context.mp3.samples + MP3_DECODED_BUFFER_SIZE <= AUDIO_DECODED_BUFFER_SIZE))
+  {
+    prefetched = true;
+    context.mp3.prefetchResult = MP3GetDecodedFrame(context.mp3.buffer + context.mp3.samples, MP3_DECODED_BUFFER_SIZE, &sampleCount);
+    if (context.mp3.prefetchResult == MP3DECODER_NO_ERROR)
+    {
+      context.mp3.samples += sampleCount;
+    }
+  }
+
+  return prefetched;
+}
+
 void audioSetFolder(const char* path, const char* file, uint8_t index)
 {
   strcpy(context.currentPath, path);
@@ -337,6 +366,7 @@ static bool audioPlay(const char* file, uint8_t index)
   {
 	// Variable initialization
     context.mp3.samples = 0;
+    context.mp3.prefetchResult = MP3DECODER_NO_ERROR;
 
     // Read ID3 tag if present
     if (!MP3GetTagData(&(context.mp3.tagData)) || !strlen((char*) context.mp3.tagData.title))
@@ -515,9 +545,10 @@ static void audioRunVolumeController(event_t event)
   switch (event.id)
   {
     case EVENTS_VOLUME_INCREASE:
+      // Every detent rotated since the last event
       if (context.volume < AUDIO_MAX_VOLUME)
       {
-        context.volume++;
+        context.volume = (AUDIO_MAX_VOLUME - context.volume) > event.data.rotation.steps ? context.volume + event.data.rotation.steps : AUDIO_MAX_VOLUME;
         sprintf(context.volumeBuffer, "Volumen %d", context.volume);
       }
       if (context.volume == AUDIO_MAX_VOLUME)
@@ -527,10 +558,7 @@ static void audioRunVolumeController(event_t event)
       break;
       
     case EVENTS_VOLUME_DECREASE:
-      if (context.volume)
-      {
-        context.volume--;
-      }
+      context.volume = context.volume > event.data.rotation.steps ? context.volume - event.data.rotation.steps : 0;
       sprintf(context.volumeBuffer, "Volumen %d", context.volume);
       break;
     
@@ -554,9 +582,10 @@ static void audioRunVolumeController(event_t event)
 
   // Show volume status on display
   audioSetDisplayString(context.volumeBuffer);
+  displayShowVolume(context.mute ? 0 : context.volume, AUDIO_MAX_VOLUME);
 
   // Start (or restart) volume timer
-  timerStart(context.volumeTimer, TIMER_MS2TICKS(AUDIO_VOLUME_DURATION_MS), TIM_MODE_SINGLESHOT, onVolumeTimeout);
+  timerStartDeferred(context.volumeTimer, TIMER_MS2TICKS(AUDIO_VOLUME_DURATION_MS), TIM_MODE_SINGLESHOT, onVolumeTimeout);
 
 }
 
@@ -564,6 +593,7 @@ void  onVolumeTimeout(void)
 {
   // Return LCD control to player
   audioSetDisplayString(context.messageBuffer);
+  displayHideVolume();
 }
 
 static void audioSetState(audio_state_t state)
@@ -586,6 +616,7 @@ static void	audioLcdUpdate(void)
       {
         HD44780WriteRotatingString(AUDIO_LCD_LINE_NUMBER, (uint8_t*)context.message, strlen(context.message), AUDIO_LCD_ROTATION_TIME_MS);
       }
+      TRACE_UI(TRACE_UI_LCD_WRITE, AUDIO_LCD_LINE_NUMBER, 0);
     }
   }
 }
@@ -596,32 +627,25 @@ static void audioSetDisplayString(const char* message)
   context.messageChanged = true;
 }
 
-static void audioFillMatrix(void)
-{
-  for(int i = 0; i < DISPLAY_COL_SIZE; i++)
-  {
-    for(int j = 0; j < DISPLAY_COL_SIZE; j++)
-    {
-      context.display.displayMatrix[i][j] = clearPixel;
-    }
-  }
-  vumeterMultiple((pixel_t*)context.display.displayMatrix, context.display.colValues, DISPLAY_COL_SIZE, AUDIO_FULL_SCALE, BAR_MODE + LINEAR_MODE);
-  displayFlip((ws2812_pixel_t*)context.display.displayMatrix);
-}
-
 void audioProcess(uint16_t* frame)
 {
   uint16_t attempts = AUDIO_PROCESSING_RETRIES;
   uint16_t sampleCount;
-  uint16_t channelCount = 1;
+  uint16_t channelCount = context.mp3.frameData.channelCount ? context.mp3.frameData.channelCount : 1;
   mp3decoder_result_t mp3Res = MP3DECODER_NO_ERROR;
   mp3decoder_frame_data_t frameData;
 
+#ifdef AUDIO_BENCHMARK_MODE
+  uint64_t startCycles = timeNowCycles();
+#endif
+
+  TRACE_AUDIO(TRACE_AUDIO_REFILL_BEGIN, 0, (uint32_t)(uintptr_t)frame);
+
 #ifdef AUDIO_DEBUG_MODE
     gpioWrite(PIN_PROCESSING, HIGH);
 #endif
 
-  // Get number of channels in next mp3 frame
+  // Get number of channels in next mp3 frame, or of the song once the prefetch has decoded its last one
   if (MP3GetNextFrameData(&frameData))
   {
     channelCount = frameData.channelCount;
@@ -629,8 +653,15 @@ void audioProcess(uint16_t* frame)
 
   while ((context.mp3.samples < channelCount * AUDIO_BUFFER_SIZE) && attempts && (mp3Res == MP3DECODER_NO_ERROR))
   {
-    // Decode next frame (STEREO output)
-    mp3Res = MP3GetDecodedFrame(context.mp3.buffer + context.mp3.samples, MP3_DECODED_BUFFER_SIZE, &sampleCount);
+    // Decode next frame (STEREO output), the decoder has closed the file if the prefetch found its end
+    if (context.mp3.prefetchResult == MP3DECODER_FILE_END)
+    {
+      mp3Res = MP3DECODER_FILE_END;
+    }
+    else
+    {
+      mp3Res = MP3GetDecodedFrame(context.mp3.buffer + context.mp3.samples, MP3_DECODED_BUFFER_SIZE, &sampleCount);
+    }
 
     if (mp3Res == MP3DECODER_NO_ERROR)
     {
@@ -660,34 +691,21 @@ void audioProcess(uint16_t* frame)
   {
     for (uint16_t i = 0; i < AUDIO_BUFFER_SIZE; i++)
     {
-      context.eq.input[i] = (uint16_t)context.mp3.buffer[channelCount * i];
-      context.eq.output[i] = 0;
+      arena.filter.input[i] = (uint16_t)context.mp3.buffer[channelCount * i];
+      arena.filter.output[i] = 0;
     }  
-    // Equalising
-    eqIirFilterFrame(context.eq.input, context.eq.output);
-    arm_q15_to_float(context.eq.output, filterOutputF32, AUDIO_FRAME_SIZE);
+    // Equalising, the input is overwritten by the conversion
+#ifdef AUDIO_EQ_FIR
+    eqFilterFrameQ15(arena.filter.input, arena.filter.output);
+#else
+    eqIirFilterFrame(arena.filter.input, arena.filter.output);
+#endif
+    arm_q15_to_float(arena.convert.output, arena.convert.outputF32, AUDIO_FRAME_SIZE);
   }
   #endif
 
-  #ifdef AUDIO_ENABLE_FFT
-  // Computing FFT
-  for (uint32_t i = 0; i < AUDIO_BUFFER_SIZE; i++)
-  {
-    context.fft.input[i*2] = (float32_t)context.mp3.buffer[i];
-		context.fft.input[i*2+1] = 0;
-		context.fft.output[i*2] = 0;
-		context.fft.output[i*2+1] = 0;
-	}
-
-  cfft(context.fft.input, context.fft.output, true);
-  cfftGetMag(context.fft.output, context.fft.input);
-  for (uint32_t i = 0 ; i < DISPLAY_COL_SIZE ; i++)
-  {
-    context.display.colValues[i] = context.fft.input[AUDIO_BUFFER_SIZE / 2 + FFT_COLUMN_BIN[i]];
-  }
-
-  audioFillMatrix();
-  #endif
+  // Snapshot for the visualiser, analysed later at the display frame rate
+  visualiserFeed(context.mp3.buffer, AUDIO_FRAME_SIZE, channelCount);
 
   double volume = (context.mute ? 0 : context.volume) / (double)AUDIO_MAX_VOLUME;
   // Write samples to output buffer
@@ -697,7 +715,7 @@ void audioProcess(uint16_t* frame)
 #ifdef AUDIO_ENABLE_EQ
     if (context.eqEnabled)
     {
-      uint16_t aux = (uint16_t)((filterOutputF32[i] * 5e4 + 0.5) * volume + (DAC_FULL_SCALE / 2));
+      uint16_t aux = (uint16_t)((arena.convert.outputF32[i] * 5e4 + 0.5) * volume + (DAC_FULL_SCALE / 2));
       frame[i] = aux;
     }
     else
@@ -712,6 +730,21 @@ void audioProcess(uint16_t* frame)
   // Update MP3 decoding buffer
   context.mp3.samples -= AUDIO_BUFFER_SIZE * channelCount;
   memmove(context.mp3.buffer, context.mp3.buffer + AUDIO_BUFFER_SIZE * channelCount, context.mp3.samples * sizeof(int16_t));
+
+  // The prefetch tries again after a decoding error
+  if (context.mp3.prefetchResult != MP3DECODER_FILE_END)
+  {
+    context.mp3.prefetchResult = MP3DECODER_NO_ERROR;
+  }
+
+  TRACE_AUDIO(TRACE_AUDIO_REFILL_END, 0, (uint32_t)(uintptr_t)frame);
+
+#ifdef AUDIO_BENCHMARK_MODE
+  context.benchmark.last = timeNowCycles() - startCycles - timeOverheadCycles();
+  context.benchmark.min = context.benchmark.last < context.benchmark.min ? context.benchmark.last : context.benchmark.min;
+  context.benchmark.max = context.benchmark.last > context.benchmark.max ? context.benchmark.last : context.benchmark.max;
+  context.benchmark.count++;
+#endif
 }
 
 void showFileTag(void)
@@ -44,6 +44,14 @@ void audioInit(void);
  */
 void audioRun(event_t event);
 
+/**
+ * @brief Decodes the next frame of the song ahead of its refill, when there is room
+ *        for it. Called when the higher priority work is done, so that the refill
+ *        only has to filter and write the samples decoded.
+ * @return True if the decoder was run
+ */
+bool audioPrefetch(void);
+
 /**
  * @brief Filename and path of current song, starts playing the audio.
  * @param path      Directory path for the audio files
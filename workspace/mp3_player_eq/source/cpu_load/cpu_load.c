@@ -0,0 +1,113 @@
+/*******************************************************************************
+  @file     cpu_load.c
+  @brief    CPU load accounting of the main loop, by subsystem
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "cpu_load.h"
+#include "drivers/MCAL/timebase/timebase.h"
+
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define CPU_LOAD_WINDOW_CYCLES    TIMEBASE_US2CYCLES(CPU_LOAD_WINDOW_MS * 1000ULL)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  uint32_t          cycles[CPU_LOAD_SLOT_COUNT];    // Accounted in the current window
+  uint8_t           load[CPU_LOAD_SLOT_COUNT];      // Percentages of the last window
+  uint64_t          lastSwitch;
+  uint64_t          windowStart;
+  cpu_load_slot_t   current;
+  bool              alreadyInit;
+} cpu_load_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static cpu_load_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void cpuLoadInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+    // Time base, the first window starts now and reads as idle until it ends
+    timebaseInit();
+    context.lastSwitch = timeNowCycles();
+    context.windowStart = context.lastSwitch;
+    context.current = CPU_LOAD_OTHER;
+    context.load[CPU_LOAD_IDLE] = 100;
+  }
+}
+
+void cpuLoadSwitch(cpu_load_slot_t slot)
+{
+  uint64_t now = timeNowCycles();
+  uint64_t window;
+
+  // The window is shorter than the wrap around of the counters
+  context.cycles[context.current] += now - context.lastSwitch;
+  context.lastSwitch = now;
+  context.current = slot;
+
+  // The load of the window is published when it ends, and a new one starts
+  window = now - context.windowStart;
+  if (window >= CPU_LOAD_WINDOW_CYCLES)
+  {
+    for (uint8_t i = 0 ; i < CPU_LOAD_SLOT_COUNT ; i++)
+    {
+      context.load[i] = (context.cycles[i] * 100ULL + window / 2) / window;
+      context.cycles[i] = 0;
+    }
+    context.windowStart = now;
+  }
+}
+
+uint8_t cpuLoadGet(cpu_load_slot_t slot)
+{
+  return context.load[slot];
+}
+
+uint8_t cpuLoadGetBusy(void)
+{
+  return 100 - context.load[CPU_LOAD_IDLE];
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
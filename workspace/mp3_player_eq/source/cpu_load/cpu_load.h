@@ -0,0 +1,74 @@
+/*******************************************************************************
+  @file     cpu_load.h
+  @brief    CPU load accounting of the main loop, by subsystem
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef CPU_LOAD_CPU_LOAD_H_
+#define CPU_LOAD_CPU_LOAD_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define CPU_LOAD_WINDOW_MS      (1000)      // Period the load is averaged over
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// What the main loop is running. Interrupts are accounted to whatever they interrupted,
+// except the ones waking the core, which run before the loop goes on.
+typedef enum {
+  CPU_LOAD_IDLE,                // Sleeping until the next interrupt
+  CPU_LOAD_WAKEUP,              // Interrupts that woke the core up
+  CPU_LOAD_WORK_QUEUE,          // Work deferred by the interrupts
+  CPU_LOAD_AUDIO,
+  CPU_LOAD_UI,
+  CPU_LOAD_VISUALISER,
+  CPU_LOAD_OTHER,               // Trace dump and the rest of the loop
+
+  CPU_LOAD_SLOT_COUNT
+} cpu_load_slot_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the accounting, and the time base it uses.
+ */
+void cpuLoadInit(void);
+
+/**
+ * @brief Accounts the cycles since the last switch to the slot being left, and starts
+ *        accounting to the new one. Only called from the main loop.
+ * @param slot    Slot the main loop is about to run
+ */
+void cpuLoadSwitch(cpu_load_slot_t slot);
+
+/**
+ * @brief Returns the percentage of the last window spent in a slot.
+ * @param slot    Slot of the main loop
+ */
+uint8_t cpuLoadGet(cpu_load_slot_t slot);
+
+/**
+ * @brief Returns the percentage of the last window the core was not sleeping.
+ */
+uint8_t cpuLoadGetBusy(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* CPU_LOAD_CPU_LOAD_H_ */
@@ -12,12 +12,16 @@
 #include "display.h"
 
 #include <stdbool.h>
+#include <string.h>
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
 
-#define FACTOR 	0.2
+#define DISPLAY_BRIGHTNESS			(51)		// Output level of a full scale colour value, out of 255
+// #define DISPLAY_GAMMA_CORRECTION				// Squares the colour values before scaling them
+#define DISPLAY_LEVEL_COUNT			(256)
+#define DISPLAY_VOLUME_ROW			(DISPLAY_ROW_SIZE - 1)
 
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
@@ -32,27 +36,45 @@
  ******************************************************************************/
 
 /*
- * @brief Callback to be called on FPS event triggered by the timer driver,
- * 		  used to update the display.
+ * @brief Callback to be run on FPS event triggered by the timer driver, out of the
+ * 		  timer interrupt, used to swap the framebuffers and update the display.
  */
 static void	onDisplayFpsUpdate(void);
 
+/*
+ * @brief Merges the spectrum layer and the overlays into the back framebuffer,
+ * 		  which is then swapped on the next vertical sync.
+ */
+static void displayCompose(void);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
 static const ws2812_pixel_t    clearPixel = WS2812_COLOR_BLACK;			// Clear byte
+static const ws2812_pixel_t    cursorPixel = { 0, 0, 250 };				// EQ band cursor
+static const ws2812_pixel_t    volumePixel = { 0, 250, 0 };				// Volume bar
 
 /*******************************************************************************
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static ws2812_pixel_t 	displayBuffer[DISPLAY_SIZE];	// Internal display buffer
+static ws2812_pixel_t 	framebuffers[2][DISPLAY_SIZE];	// Front and back framebuffers
+static ws2812_pixel_t* volatile front;					// Framebuffer being sent to the leds
+static ws2812_pixel_t* volatile back;					// Framebuffer being composed
+static volatile bool	swapPending = false;			// Back framebuffer is ready to be shown
 static bool 			alreadyInit = false;			// Internal flag for initialization process
-static bool				displayLocked = false;			// Internal flag for avoid updates when changing display content
+
+// Layers, merged into the back framebuffer only when one of them changes
+static ws2812_pixel_t	spectrumLayer[DISPLAY_SIZE];	// Base layer
 static uint8_t			currentCol;						// Column selected by user
-static uint8_t			currentValue;						// Column selected by user
-static bool				displayChanged = false;			// Internal flag for display changes
+static uint8_t			currentValue;					// Value of the column selected by user
+static uint8_t			volumeLevel;					// Columns lit by the volume bar
+static bool				volumeVisible = false;			// Whether the volume bar is shown
+
+// Output position of each pixel of the spectrum layer, mirrored while a column is selected
+static uint8_t			directMap[DISPLAY_SIZE];
+static uint8_t			mirroredMap[DISPLAY_SIZE];
 
 /*******************************************************************************
  *******************************************************************************
@@ -62,20 +84,46 @@ static bool				displayChanged = false;			// Internal flag for display changes
 
 void displayInit(void)
 {
+	uint8_t levels[DISPLAY_LEVEL_COUNT];
+
 	if (!alreadyInit)
 	{
 		// Raise the already initialized flag, to avoid multiple initialization
 		alreadyInit = true;
 		currentCol = DISPLAY_UNSELECT_COLUMN;
 		currentValue = 8;
+		front = framebuffers[0];
+		back = framebuffers[1];
+
+		// Index maps of the spectrum layer
+		for (uint32_t i = 0 ; i < DISPLAY_ROW_SIZE ; i++)
+		{
+			for (uint32_t j = 0 ; j < DISPLAY_COL_SIZE ; j++)
+			{
+				directMap[i * DISPLAY_COL_SIZE + j] = i * DISPLAY_COL_SIZE + j;
+				mirroredMap[i * DISPLAY_COL_SIZE + j] = i * DISPLAY_COL_SIZE + (DISPLAY_COL_SIZE - 1 - j);
+			}
+		}
+
+		// Brightness and gamma, applied by the WS2812 encoder
+		for (uint32_t i = 0 ; i < DISPLAY_LEVEL_COUNT ; i++)
+		{
+#ifdef DISPLAY_GAMMA_CORRECTION
+			uint32_t value = (i * i + 127) / 255;
+#else
+			uint32_t value = i;
+#endif
+			levels[i] = (value * DISPLAY_BRIGHTNESS + 127) / 255;
+		}
 
 		// Initialization of the lower layer WS2812 driver
 		WS2812Init();
-		WS2812SetDisplayBuffer(displayBuffer, DISPLAY_SIZE);
+		WS2812SetLevelTable(levels);
+		WS2812SetDisplayBuffer(front, DISPLAY_SIZE);
 
 		// Initialization of the timer driver
 		timerInit();
-		timerStart(timerGetId(), TIMER_MS2TICKS(DISPLAY_FPS_MS), TIM_MODE_PERIODIC, onDisplayFpsUpdate);
+		timerStartDeferred(timerGetId(), TIMER_MS2TICKS(DISPLAY_FPS_MS), TIM_MODE_PERIODIC, onDisplayFpsUpdate);
 
 		// Clear the display
 		displayClear();
@@ -84,70 +132,105 @@ void displayInit(void)
 
 void displayFlip(ws2812_pixel_t* buffer)
 {
-	displayLocked = true;
-	for (uint32_t i = 0; i < DISPLAY_COL_SIZE ; i++)
+	memcpy(spectrumLayer, buffer, sizeof(spectrumLayer));
+	displayCompose();
+}
+
+void displaySelectColumn(uint8_t colNumber, uint8_t colValue)
+{
+	if (currentCol != colNumber || currentValue != colValue)
 	{
-		for (uint32_t j = 0 ; j < DISPLAY_ROW_SIZE ; j++)
-		{
-			if (currentCol == DISPLAY_UNSELECT_COLUMN)
-			{
-				displayBuffer[i * DISPLAY_ROW_SIZE + j].r = buffer[i * DISPLAY_ROW_SIZE + j].r * FACTOR;
-				displayBuffer[i * DISPLAY_ROW_SIZE + j].g = buffer[i * DISPLAY_ROW_SIZE + j].g * FACTOR;
-				displayBuffer[i * DISPLAY_ROW_SIZE + j].b = buffer[i * DISPLAY_ROW_SIZE + j].b * FACTOR;
-			}
-			else
-			{
-				if (j == currentCol && i < currentValue)
-				{
-					ws2812_pixel_t pixel = WS2812_COLOR_BLUE;
-					displayBuffer[i * DISPLAY_ROW_SIZE + j] = pixel;
-				}
-				else
-				{
-					displayBuffer[i * DISPLAY_ROW_SIZE + (DISPLAY_COL_SIZE - 1 - j)].r = buffer[i * DISPLAY_ROW_SIZE + j].r * FACTOR;
-					displayBuffer[i * DISPLAY_ROW_SIZE + (DISPLAY_COL_SIZE - 1 - j)].g = buffer[i * DISPLAY_ROW_SIZE + j].g * FACTOR;
-					displayBuffer[i * DISPLAY_ROW_SIZE + (DISPLAY_COL_SIZE - 1 - j)].b = buffer[i * DISPLAY_ROW_SIZE + j].b * FACTOR;
-				}
-			}
-		}
+		currentCol = colNumber;
+		currentValue = colValue;
+		displayCompose();
 	}
-	displayLocked = false;
-	displayChanged = true;
 }
 
-void displaySelectColumn(uint8_t colNumber, uint8_t colValue)
+void displayShowVolume(uint8_t volume, uint8_t maxVolume)
+{
+	uint8_t level = maxVolume ? (volume * DISPLAY_COL_SIZE + maxVolume - 1) / maxVolume : 0;
+	if (!volumeVisible || volumeLevel != level)
+	{
+		volumeVisible = true;
+		volumeLevel = level;
+		displayCompose();
+	}
+}
+
+void displayHideVolume(void)
 {
-	currentCol = colNumber;
-	currentValue = colValue;
+	// Merged with the next spectrum frame, so it can be called from a timer callback
+	volumeVisible = false;
 }
 
 void displayClear(void)
 {
-	displayLocked = true;
-	for(int i = 0; i < DISPLAY_COL_SIZE; i++)
+	for (uint32_t i = 0 ; i < DISPLAY_SIZE ; i++)
 	{
-		for(int j = 0; j < DISPLAY_COL_SIZE; j++)
-		{
-		  displayBuffer[i * DISPLAY_ROW_SIZE + j] = clearPixel;
-		}
+		spectrumLayer[i] = clearPixel;
 	}
-	displayLocked = false;
-	displayChanged = true;
+	displayCompose();
 }
+
 /*******************************************************************************
  *******************************************************************************
                         LOCAL FUNCTION DEFINITIONS
  *******************************************************************************
  ******************************************************************************/
 
+static void displayCompose(void)
+{
+	ws2812_pixel_t* output;
+	const uint8_t* map;
+
+	// Hold the swap, the back framebuffer is only read after that
+	swapPending = false;
+	output = back;
+
+	// Spectrum layer, mirrored while a column is selected
+	map = (currentCol == DISPLAY_UNSELECT_COLUMN) ? directMap : mirroredMap;
+	for (uint32_t i = 0 ; i < DISPLAY_SIZE ; i++)
+	{
+		output[map[i]] = spectrumLayer[i];
+	}
+
+	// EQ band cursor
+	if (currentCol < DISPLAY_COL_SIZE)
+	{
+		for (uint32_t i = 0 ; i < currentValue && i < DISPLAY_ROW_SIZE ; i++)
+		{
+			output[i * DISPLAY_COL_SIZE + currentCol] = cursorPixel;
+		}
+	}
+
+	// Volume bar
+	if (volumeVisible)
+	{
+		for (uint32_t j = 0 ; j < DISPLAY_COL_SIZE ; j++)
+		{
+			output[DISPLAY_VOLUME_ROW * DISPLAY_COL_SIZE + j] = j < volumeLevel ? volumePixel : clearPixel;
+		}
+	}
+
+	swapPending = true;
+}
+
 static void	onDisplayFpsUpdate(void)
 {
-	if (!displayLocked)
+	ws2812_pixel_t* previous;
+
+	// Vertical sync, the framebuffers are swapped while the leds are not being written
+	if (!WS2812Busy())
 	{
-		if (displayChanged)
+		if (swapPending)
 		{
-			WS2812Update();
+			previous = front;
+			front = back;
+			back = previous;
+			swapPending = false;
+			WS2812SetDisplayBuffer(front, DISPLAY_SIZE);
 		}
+		WS2812Update();
 	}
 }
 
@@ -42,7 +42,8 @@ void displayInit(void);
 
 /**
  * @brief Flip the current display buffer, which must be of the fixed size
- * 		    declared by the DISPLAY_ROW_SIZE and DISPLAY_COL_SIZE.
+ * 		    declared by the DISPLAY_ROW_SIZE and DISPLAY_COL_SIZE. It becomes the
+ * 		    base layer, shown on the next frame with the overlays on top.
  * @param buffer	Pointer to the pixel matrix
  */
 void displayFlip(ws2812_pixel_t* buffer);
@@ -54,6 +55,18 @@ void displayFlip(ws2812_pixel_t* buffer);
  */
 void displaySelectColumn(uint8_t colNumber, uint8_t colValue);
 
+/**
+ * @brief Shows the volume bar over the top row of the display
+ * @param volume		Current volume
+ * @param maxVolume		Volume that lights the whole row
+ */
+void displayShowVolume(uint8_t volume, uint8_t maxVolume);
+
+/**
+ * @brief Hides the volume bar, from the next frame flipped on
+ */
+void displayHideVolume(void);
+
 /**
  * @brief Clears display
  */
@@ -8,14 +8,17 @@
  * INCLUDE HEADER FILES
  ******************************************************************************/
 
-#include "lib/event_queue/event_queue.h"
-#include "lib/queue/queue.h"
+#include "lib/spsc_ring/spsc_ring.h"
 #include "drivers/MCAL/dac_dma/dac_dma.h"
+#include "drivers/MCAL/timebase/timebase.h"
+#include "drivers/HAL/trace/trace.h"
+#include "cpu_load/cpu_load.h"
 #include "drivers/HAL/keypad/keypad.h"
 #include "drivers/HAL/sd/sd.h"
 #include "drivers/MCAL/gpio/gpio.h"
 #include "board/board.h"
 #include "events.h"
+#include "hardware.h"
 
 #include <stdbool.h>
 
@@ -25,10 +28,33 @@
 
 #define EVENT_DEBUG
 
+// Capacity of the ring of each class, powers of two
+#define EVENTS_AUDIO_RING_SIZE			4
+#define EVENTS_INPUT_RING_SIZE			16
+#define EVENTS_HOUSEKEEPING_RING_SIZE	4
+
+// Every DAC buffer can be waiting to be refilled, so frame events are never dropped
+_Static_assert(EVENTS_AUDIO_RING_SIZE >= DAC_DMA_PPBUFFER_COUNT, "EVENTS_AUDIO_RING_SIZE can't hold every DAC buffer");
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
 
+// Each class is pushed to its own ring, and popped by the main loop. The input class is
+// raised from the SysTick, by the buttons and the timers of the keypad, and from the port
+// interrupts of the encoders, which preempt the SysTick. So every push is made with the
+// interrupts masked, leaving each ring a single producer at a time.
+
+// Event as it waits in its ring, with the time it was raised
+typedef struct {
+	event_t			event;
+	uint32_t		raisedCycles;
+} events_entry_t;
+
+SPSC_RING_CHECK(EVENTS_AUDIO_RING_SIZE, sizeof(events_entry_t));
+SPSC_RING_CHECK(EVENTS_INPUT_RING_SIZE, sizeof(events_entry_t));
+SPSC_RING_CHECK(EVENTS_HOUSEKEEPING_RING_SIZE, sizeof(events_entry_t));
+
 /*******************************************************************************
  * VARIABLES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -60,9 +86,19 @@ static void onSdCardInserted(void);
 static void onFrameFinished(uint16_t* frame);
 
 /**
- * @brief Event generator which provides access to the internal events of the hardware queue.
+ * @brief Pushes an event raised by an interrupt to the ring of its class.
+ * @param eventClass	Priority class of the event
+ * @param event			Event being raised
+ * @return True if the event is waiting in the ring, false if it was dropped
  */
-static void* hardwareQueueEventGenerator(void);
+static bool eventsRaise(events_class_t eventClass, const event_t* event);
+
+/**
+ * @brief Takes the detents of the encoder of a rotation event being dispatched.
+ * @param event			Rotation event, its direction and steps are updated
+ * @return False if the detents cancelled each other and there is nothing to dispatch
+ */
+static bool eventsTakeRotation(event_t* event);
 
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
@@ -72,11 +108,13 @@ static void* hardwareQueueEventGenerator(void);
  * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
-static bool 					alreadyInit = false;													// Internal flag to detect initialization
-static event_t 				hardwareQueueBuffer[QUEUE_STANDARD_MAX_SIZE];	// Hardware queue buffer for asynchronous events
-static event_t 				eventQueueBuffer[QUEUE_STANDARD_MAX_SIZE];		// Event queue buffer used as memory buffer
-static queue_t 				hardwareQueue;																// Hardware queue handler
-static event_queue_t 	eventQueue;																		// Event queue handler
+static bool 				alreadyInit = false;								// Internal flag to detect initialization
+static events_entry_t		audioRingBuffer[EVENTS_AUDIO_RING_SIZE];
+static events_entry_t		inputRingBuffer[EVENTS_INPUT_RING_SIZE];
+static events_entry_t		housekeepingRingBuffer[EVENTS_HOUSEKEEPING_RING_SIZE];
+static spsc_ring_t			rings[EVENTS_CLASS_COUNT];							// Rings of each class, by priority
+static events_stats_t		stats[EVENTS_CLASS_COUNT];
+static volatile bool		rotationPending[KEYPAD_ENCODER_RIGHT + 1];			// Rotation event of each encoder waiting in the ring
 
 /*******************************************************************************
  *******************************************************************************
@@ -92,6 +130,22 @@ void eventsInit(void)
 		// driver more than once. Skips the initialization routine;
 		alreadyInit = true;
 
+		// Trace of the events, before any interrupt can raise them
+		traceInit();
+
+		// Initialization of the rings of each class, before any interrupt can raise events
+		rings[EVENTS_CLASS_AUDIO] = createSpscRing(audioRingBuffer, EVENTS_AUDIO_RING_SIZE, sizeof(events_entry_t));
+		rings[EVENTS_CLASS_INPUT] = createSpscRing(inputRingBuffer, EVENTS_INPUT_RING_SIZE, sizeof(events_entry_t));
+		rings[EVENTS_CLASS_HOUSEKEEPING] = createSpscRing(housekeepingRingBuffer, EVENTS_HOUSEKEEPING_RING_SIZE, sizeof(events_entry_t));
+		for (uint8_t eventClass = 0 ; eventClass < EVENTS_CLASS_COUNT ; eventClass++)
+		{
+			stats[eventClass].latencyMin = UINT32_MAX;
+		}
+
+		// Time base of the latency, and wake up from eventsWait() on any pending interrupt
+		timebaseInit();
+		SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+
 		// Initialization of the sd driver
 		sdInit();
 		sdOnCardInserted(onSdCardInserted);
@@ -105,15 +159,6 @@ void eventsInit(void)
 		dacdmaInit();
 		dacdmaSetCallback(onFrameFinished);
 
-		// Initialization of the hardware queue handler
-		hardwareQueue = createQueue(&hardwareQueueBuffer, QUEUE_STANDARD_MAX_SIZE, sizeof(event_t));
-
-		// Initialization of the event queue handler
-		eventQueue = createEventQueue(&eventQueueBuffer, QUEUE_STANDARD_MAX_SIZE, sizeof(event_t));
-
-		// Registers the event generators for the internal event queue
-		registerEventGenerator(&eventQueue, hardwareQueueEventGenerator);
-
 #ifdef EVENT_DEBUG
 		gpioMode(PIN_FRAME_FINISHED, OUTPUT);
 #endif
@@ -122,13 +167,76 @@ void eventsInit(void)
 
 event_t eventsGetNextEvent(void)
 {
-	event_t resultEvent = { .id = EVENTS_NONE };
-	void* event = getNextEvent(&eventQueue);
-	if (event)
+	event_t event = { .id = EVENTS_NONE };
+
+	// The first class with an event waiting, by priority
+	for (uint8_t eventClass = 0 ; (eventClass < EVENTS_CLASS_COUNT) && (event.id == EVENTS_NONE) ; eventClass++)
+	{
+		event = eventsGetNextEventOfClass(eventClass);
+	}
+
+	return event;
+}
+
+event_t eventsGetNextEventOfClass(events_class_t eventClass)
+{
+	events_entry_t entry = { .event = { .id = EVENTS_NONE } };
+	uint32_t latency;
+	bool found = false;
+
+	// A rotation whose detents cancelled each other is skipped, and the next one is taken
+	while (!found && spscRingPop(&rings[eventClass], &entry))
+	{
+		if (eventsTakeRotation(&entry.event))
+		{
+			events_stats_t* classStats = &stats[eventClass];
+			latency = (uint32_t)timeNowCycles() - entry.raisedCycles;
+			classStats->dispatched++;
+			classStats->latencyLast = latency;
+			classStats->latencyTotal += latency;
+			classStats->latencyMin = latency < classStats->latencyMin ? latency : classStats->latencyMin;
+			classStats->latencyMax = latency > classStats->latencyMax ? latency : classStats->latencyMax;
+			TRACE_EVENTS(TRACE_EVENT_DISPATCHED, (eventClass << 8) | entry.event.id, latency);
+			found = true;
+		}
+	}
+
+	// A skipped rotation is not returned
+	if (!found)
 	{
-		resultEvent = *(event_t*)event;
+		entry.event.id = EVENTS_NONE;
 	}
-	return resultEvent;
+
+	return entry.event;
+}
+
+void eventsWait(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	bool empty = true;
+
+	// Interrupts are masked while sleeping, a pending one still wakes the core but only
+	// runs once the sleep is accounted
+	__disable_irq();
+	for (uint8_t eventClass = 0 ; eventClass < EVENTS_CLASS_COUNT ; eventClass++)
+	{
+		empty = empty && spscRingIsEmpty(&rings[eventClass]);
+	}
+
+	// An interrupt pending since the caller checked its work set the event register, so it
+	// returns at once instead of missing it
+	if (empty)
+	{
+		cpuLoadSwitch(CPU_LOAD_IDLE);
+		timebaseWaitForEvent();
+		cpuLoadSwitch(CPU_LOAD_WAKEUP);
+	}
+	__set_PRIMASK(primask);
+}
+
+events_stats_t eventsGetStats(events_class_t eventClass)
+{
+	return stats[eventClass];
 }
 
 /*******************************************************************************
@@ -199,25 +307,31 @@ static void onKeyPadEvent(keypad_events_t event)
 		}
 	}
 
-	// Push the new event into the hardware queue
-	push(&hardwareQueue, (void*)(&newEvent));
-}
-
-static void* hardwareQueueEventGenerator(void)
-{
-	return pop(&hardwareQueue);
+	// Push the new event into the input ring. A rotation event already waiting takes
+	// the new detents when dispatched, so a fast spin raises one event instead of many.
+	if ((event.id == KEYPAD_ROTATION_CLKW) || (event.id == KEYPAD_ROTATION_COUNTER_CLKW))
+	{
+		if (!rotationPending[event.source])
+		{
+			rotationPending[event.source] = eventsRaise(EVENTS_CLASS_INPUT, &newEvent);
+		}
+	}
+	else
+	{
+		eventsRaise(EVENTS_CLASS_INPUT, &newEvent);
+	}
 }
 
 static void onSdCardRemoved(void)
 {
 	event_t event = { .id = EVENTS_SD_REMOVED };
-	push(&hardwareQueue, (void*)(&event));
+	eventsRaise(EVENTS_CLASS_HOUSEKEEPING, &event);
 }
 
 static void onSdCardInserted(void)
 {
 	event_t event = { .id = EVENTS_SD_INSERTED};
-	push(&hardwareQueue, (void*)(&event));
+	eventsRaise(EVENTS_CLASS_HOUSEKEEPING, &event);
 }
 
 static void onFrameFinished(uint16_t* frame)
@@ -225,13 +339,70 @@ static void onFrameFinished(uint16_t* frame)
 	event_t event;
 	event.id = EVENTS_FRAME_FINISHED;
 	event.data.frame = frame;
-	push(&hardwareQueue, (void*)(&event));
+	TRACE_AUDIO(TRACE_AUDIO_FRAME_FINISHED, 0, (uint32_t)(uintptr_t)frame);
+	eventsRaise(EVENTS_CLASS_AUDIO, &event);
 
 #ifdef EVENT_DEBUG
 		gpioToggle(PIN_FRAME_FINISHED);
 #endif
 }
 
+static bool eventsRaise(events_class_t eventClass, const event_t* event)
+{
+	events_entry_t entry = {
+		.event = *event,
+		.raisedCycles = (uint32_t)timeNowCycles()
+	};
+	uint32_t primask = __get_PRIMASK();
+	bool succeed;
+
+	// A producer of a higher priority can't push, nor count its drop, in the middle of this one
+	__disable_irq();
+	succeed = spscRingPush(&rings[eventClass], &entry);
+	if (!succeed)
+	{
+		stats[eventClass].dropped++;
+	}
+	__set_PRIMASK(primask);
+
+	TRACE_EVENTS(succeed ? TRACE_EVENT_RAISED : TRACE_EVENT_DROPPED, (eventClass << 8) | event->id, 0);
+
+	return succeed;
+}
+
+static bool eventsTakeRotation(event_t* event)
+{
+	keypad_source_t source;
+	keypad_rotation_t rotation;
+	uint32_t steps;
+	bool succeed = true;
+
+	if ((event->id == EVENTS_LEFT) || (event->id == EVENTS_RIGHT) || (event->id == EVENTS_VOLUME_DECREASE) || (event->id == EVENTS_VOLUME_INCREASE))
+	{
+		source = ((event->id == EVENTS_LEFT) || (event->id == EVENTS_RIGHT)) ? KEYPAD_ENCODER_LEFT : KEYPAD_ENCODER_RIGHT;
+
+		// Cleared before taking, a detent in between raises another event which finds
+		// nothing to take at worst, instead of a detent never being dispatched
+		rotationPending[source] = false;
+		rotation = keypadTakeRotation(source);
+		steps = rotation.delta < 0 ? -rotation.delta : rotation.delta;
+
+		if (source == KEYPAD_ENCODER_LEFT)
+		{
+			event->id = rotation.delta < 0 ? EVENTS_LEFT : EVENTS_RIGHT;
+		}
+		else
+		{
+			event->id = rotation.delta < 0 ? EVENTS_VOLUME_DECREASE : EVENTS_VOLUME_INCREASE;
+		}
+		event->data.rotation.steps = steps > UINT16_MAX ? UINT16_MAX : steps;
+		event->data.rotation.velocity = rotation.velocity > UINT16_MAX ? UINT16_MAX : rotation.velocity;
+		succeed = steps != 0;
+	}
+
+	return succeed;
+}
+
 /*******************************************************************************
  *******************************************************************************
 						            INTERRUPT SERVICE ROUTINES
@@ -40,8 +40,15 @@ typedef enum {
 	EVENTS_COUNT
 } event_id_t;
 
+// Rotation of an encoder, every detent since the previous event in a single one
+typedef struct {
+	uint16_t	steps;						// Detents rotated in the direction of the event
+	uint16_t	velocity;					// Estimate of the detents per second
+} event_rotation_t;
+
 typedef union {
-	uint16_t* frame;
+	uint16_t* 			frame;
+	event_rotation_t	rotation;			// EVENTS_LEFT, EVENTS_RIGHT and the volume rotations
 } event_data_t;
 
 typedef struct {
@@ -49,6 +56,26 @@ typedef struct {
 	event_data_t	data;
 } event_t;
 
+// Priority classes, each one with its own channel. A class is only dispatched when
+// every class before it is empty, so UI work can never delay the audio refill.
+typedef enum {
+	EVENTS_CLASS_AUDIO,						// Audio critical, frames to be refilled
+	EVENTS_CLASS_INPUT,						// User input
+	EVENTS_CLASS_HOUSEKEEPING,				// SD card detection
+
+	EVENTS_CLASS_COUNT
+} events_class_t;
+
+// Statistics of a class, latencies in core cycles from the interrupt raising the event to its dispatch
+typedef struct {
+	uint32_t		dispatched;				// Events dispatched
+	uint32_t		dropped;				// Events lost because the channel was full
+	uint32_t		latencyLast;
+	uint32_t		latencyMin;
+	uint32_t		latencyMax;
+	uint64_t		latencyTotal;			// Divided by dispatched gives the average latency
+} events_stats_t;
+
 /*******************************************************************************
  * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -63,10 +90,29 @@ typedef struct {
 void eventsInit(void);
 
 /*
- * @brief Returns the next event.
+ * @brief Returns the next event, from the first class with events waiting.
  */
 event_t eventsGetNextEvent(void);
 
+/*
+ * @brief Returns the next event of a class, for the task that handles it.
+ * @param eventClass	Class of the event
+ */
+event_t eventsGetNextEventOfClass(events_class_t eventClass);
+
+/*
+ * @brief Sleeps until the next interrupt, unless an event is already waiting. Any
+ * 		  interrupt raised since the caller last checked its work wakes it at once.
+ * 		  The sleep is accounted as idle by the CPU load.
+ */
+void eventsWait(void);
+
+/*
+ * @brief Returns the statistics of a class since initialization.
+ * @param eventClass	Priority class
+ */
+events_stats_t eventsGetStats(events_class_t eventClass);
+
 /*******************************************************************************
  ******************************************************************************/
 
@@ -0,0 +1,70 @@
+/*******************************************************************************
+  @file     memory_plan.h
+  @brief    Static RAM plan, budgets of each subsystem and buffer overlays
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef MEMORY_MEMORY_PLAN_H_
+#define MEMORY_MEMORY_PLAN_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+/*
+ * Working buffers are planned by their lifetime. Buffers only used during one
+ * phase of a process are declared in an arena, a union with one structure per
+ * phase, so that buffers of disjoint phases share the same memory. A buffer
+ * that lives across consecutive phases must be the first member of each of
+ * their structures, so it keeps its offset in the arena.
+ *
+ * Every subsystem has a RAM budget, in bytes. The size of each module context
+ * is checked against it when compiling. miscellaneous/Memory/ram_report.py
+ * checks the whole subsystem against the linker map, run by hand after
+ * building: the project build settings are not in the repository, so it is
+ * not a post-build step. Budgets are plain integer expressions, so that the
+ * script can evaluate them. A subsystem with a budget per configuration lists
+ * each one, and the script checks the largest.
+ */
+
+// RAM budgets of each subsystem, in bytes
+#define MEMORY_BUDGET_AUDIO                 (68 * 1024)   // source/audio, decoding and output buffers
+#define MEMORY_BUDGET_VISUALISER            (4 * 1024)    // source/visualiser, snapshots and display matrix, with the FFT source
+#define MEMORY_BUDGET_VISUALISER_FILTERBANK (7 * 1024)    // source/visualiser, with the filter bank source, its snapshots are 1024 samples
+#define MEMORY_BUDGET_DISPLAY               (1 * 1024)    // source/display
+#define MEMORY_BUDGET_SPECTRUM              (7 * 1024)    // drivers/MCAL/spectrum
+#define MEMORY_BUDGET_CFFT                  (1 * 1024)    // drivers/MCAL/cfft
+#define MEMORY_BUDGET_FILTERBANK            (1 * 1024)    // drivers/MCAL/filterbank
+#define MEMORY_BUDGET_EQUALISER             (8 * 1024)    // drivers/MCAL/equaliser, the three filter banks
+#define MEMORY_BUDGET_DECODER               (8 * 1024)    // lib/mp3decoder, encoded frame buffer
+#define MEMORY_BUDGET_HELIX                 (1 * 1024)    // lib/helix, its decoder state is allocated in the heap
+#define MEMORY_BUDGET_FATFS                 (2 * 1024)    // lib/fatfs
+#define MEMORY_BUDGET_TRACE                 (5 * 1024)    // drivers/HAL/trace, records of the trace
+
+/**
+ * @brief Fails the compilation when the memory of a module does not fit in its budget.
+ * @param size    Size of the static variables of the module, in bytes
+ * @param budget  Budget, in bytes
+ */
+#define MEMORY_CHECK_BUDGET(size, budget)   _Static_assert((size) <= (budget), #size " exceeds " #budget)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* MEMORY_MEMORY_PLAN_H_ */
@@ -0,0 +1,204 @@
+/*******************************************************************************
+  @file     scheduler.c
+  @brief    Cooperative scheduler of the main loop, with a cycle budget per task
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "scheduler.h"
+#include "drivers/MCAL/timebase/timebase.h"
+#include "drivers/MCAL/systick/systick.h"
+#include "drivers/HAL/trace/trace.h"
+#include "hardware.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+_Static_assert(SCHEDULER_MAX_TASKS <= 32, "The overrun flags of the tasks don't fit a word");
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+  scheduler_task_t    task;
+  cpu_load_slot_t     slot;
+  scheduler_stats_t   stats;
+} scheduler_entry_t;
+
+/*
+ * The tasks run to completion, one slice per call, and the highest priority one
+ * with work to do runs first. Each call starts from the highest priority again,
+ * so a task waits at most for the slice running when its work arrived, which is
+ * why the slices must stay within their budgets. The SysTick flags a slice as
+ * soon as it runs over, so a task stuck in a slice is reported while it runs.
+ */
+typedef struct {
+  scheduler_entry_t   tasks[SCHEDULER_MAX_TASKS];   // By priority
+  uint8_t             count;
+  volatile uint32_t   overruns;                     // Flags of the tasks over their budget, also set by the SysTick
+  volatile uint8_t    running;                      // Task of the slice running, SCHEDULER_INVALID_ID between slices
+  volatile bool       reported;                     // The slice running was already found over its budget
+  volatile uint64_t   sliceStart;
+  bool                alreadyInit;
+} scheduler_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Flags the slice running as soon as it is over its budget, on every SysTick.
+ */
+static void schedulerTick(void);
+
+/**
+ * @brief Sets the overrun flag of a task, shared with the SysTick.
+ * @param id        Identifier of the task
+ */
+static void schedulerFlagOverrun(scheduler_task_id_t id);
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static scheduler_context_t context;
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void schedulerInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    context.alreadyInit = true;
+
+    // Time base, for the cycles taken by the tasks, and the SysTick watching the slice running
+    timebaseInit();
+    context.running = SCHEDULER_INVALID_ID;
+    systickInit(schedulerTick);
+  }
+}
+
+scheduler_task_id_t schedulerAddTask(scheduler_task_t task, uint32_t budgetUs, cpu_load_slot_t slot)
+{
+  scheduler_task_id_t id = SCHEDULER_INVALID_ID;
+
+  if (context.count < SCHEDULER_MAX_TASKS)
+  {
+    id = context.count++;
+    context.tasks[id].task = task;
+    context.tasks[id].slot = slot;
+    context.tasks[id].stats.budgetCycles = TIMEBASE_US2CYCLES(budgetUs);
+  }
+
+  return id;
+}
+
+bool schedulerRun(void)
+{
+  scheduler_entry_t* entry;
+  uint64_t start;
+  uint32_t cycles;
+  bool ran = false;
+
+  for (uint8_t id = 0 ; !ran && (id < context.count) ; id++)
+  {
+    entry = &context.tasks[id];
+    cpuLoadSwitch(entry->slot);
+    start = timeNowCycles();
+    context.sliceStart = start;
+    context.reported = false;
+    context.running = id;
+    ran = entry->task();
+    context.running = SCHEDULER_INVALID_ID;
+
+    // Only the slices with work are measured, the others only checked for it
+    if (ran)
+    {
+      cycles = (uint32_t)(timeNowCycles() - start);
+      entry->stats.runs++;
+      entry->stats.lastCycles = cycles;
+      if (cycles > entry->stats.maxCycles)
+      {
+        entry->stats.maxCycles = cycles;
+      }
+      if (cycles > entry->stats.budgetCycles)
+      {
+        entry->stats.overruns++;
+        schedulerFlagOverrun(id);
+        TRACE_SCHEDULER(TRACE_TASK_OVERRUN, id, cycles);
+      }
+    }
+  }
+
+  return ran;
+}
+
+uint32_t schedulerTakeOverruns(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t overruns;
+
+  __disable_irq();
+  overruns = context.overruns;
+  context.overruns = 0;
+  __set_PRIMASK(primask);
+
+  return overruns;
+}
+
+scheduler_stats_t schedulerGetStats(scheduler_task_id_t id)
+{
+  return context.tasks[id].stats;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void schedulerTick(void)
+{
+  scheduler_task_id_t id = context.running;
+  uint32_t cycles;
+
+  // The start of the slice is written before its task is set as running
+  if ((id != SCHEDULER_INVALID_ID) && !context.reported)
+  {
+    cycles = (uint32_t)(timeNowCycles() - context.sliceStart);
+    if (cycles > context.tasks[id].stats.budgetCycles)
+    {
+      context.reported = true;
+      schedulerFlagOverrun(id);
+      TRACE_SCHEDULER(TRACE_TASK_OVER_BUDGET, id, cycles);
+    }
+  }
+}
+
+static void schedulerFlagOverrun(scheduler_task_id_t id)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  context.overruns |= 1UL << id;
+  __set_PRIMASK(primask);
+}
+
+/******************************************************************************/
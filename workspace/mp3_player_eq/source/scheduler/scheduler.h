@@ -0,0 +1,91 @@
+/*******************************************************************************
+  @file     scheduler.h
+  @brief    Cooperative scheduler of the main loop, with a cycle budget per task
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef SCHEDULER_SCHEDULER_H_
+#define SCHEDULER_SCHEDULER_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "cpu_load/cpu_load.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define SCHEDULER_MAX_TASKS     (8)         // Tasks that can be added, at most 32 for the overrun flags
+#define SCHEDULER_INVALID_ID    (255)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+// Runs a slice of the work of a task, to completion. Returns whether there was work to
+// do, a task with nothing to do must return at once.
+typedef bool (*scheduler_task_t)(void);
+
+typedef uint8_t scheduler_task_id_t;
+
+typedef struct {
+  uint32_t    runs;               // Slices that had work to do
+  uint32_t    overruns;           // Slices that took longer than the budget
+  uint32_t    budgetCycles;
+  uint32_t    lastCycles;
+  uint32_t    maxCycles;
+} scheduler_stats_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the scheduler, and the time base used to measure its tasks.
+ */
+void schedulerInit(void);
+
+/**
+ * @brief Adds a task to the scheduler. The priority of the tasks is the order they
+ *        are added in, the first one has the highest.
+ * @param task      Task to be run
+ * @param budgetUs  Longest a slice of the task is expected to take
+ * @param slot      Slot of the CPU load the task is accounted to
+ * @return Identifier of the task, SCHEDULER_INVALID_ID if there is no room for it
+ */
+scheduler_task_id_t schedulerAddTask(scheduler_task_t task, uint32_t budgetUs, cpu_load_slot_t slot);
+
+/**
+ * @brief Runs a slice of the highest priority task with work to do. Tasks are not
+ *        preempted, so a task waits at most for the longest slice of the others.
+ *        Called from the main loop.
+ * @return True if a task had work to do, false if the main loop can sleep
+ */
+bool schedulerRun(void);
+
+/**
+ * @brief Returns a flag for each task, by its identifier, that ran over its budget
+ *        since the last call, and clears them. A slice is flagged by the SysTick as
+ *        soon as it runs over, while it is still running.
+ */
+uint32_t schedulerTakeOverruns(void);
+
+/**
+ * @brief Returns the statistics of a task since initialization.
+ * @param id        Identifier of the task
+ */
+scheduler_stats_t schedulerGetStats(scheduler_task_id_t id);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* SCHEDULER_SCHEDULER_H_ */
@@ -11,6 +11,7 @@
 #include "ui.h"
 #include "audio/audio.h"
 #include "display/display.h"
+#include "cpu_load/cpu_load.h"
 
 #include <stdbool.h>
 #include <string.h>
@@ -19,6 +20,7 @@
 #include "drivers/MCAL/equaliser/equaliser.h"
 #include "drivers/HAL/HD44780_LCD/HD44780_LCD.h"
 #include "drivers/HAL/timer/timer.h"
+#include "drivers/HAL/trace/trace.h"
 #include "lib/fatfs/ff.h"
 
 /*******************************************************************************
@@ -34,6 +36,13 @@
 #define UI_EQUALISER_GAIN_COUNT     (8)
 #define UI_EQUALISER_BAND_COUNT     (8)
 
+// Scrolling of the file system, entries skipped per detent by the velocity of the encoder
+#define UI_SCROLL_FAST_VELOCITY     (10)        // Detents per second
+#define UI_SCROLL_FAST_GAIN         (4)
+#define UI_SCROLL_FASTER_VELOCITY   (25)        // Detents per second
+#define UI_SCROLL_FASTER_GAIN       (16)
+#define UI_SCAN_ENTRIES_PER_RUN     (8)         // Directory entries read by each run of the scan
+
 /*******************************************************************************
  * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
  ******************************************************************************/
@@ -47,12 +56,14 @@ typedef enum {
 typedef enum {
   UI_STATE_MENU,                // Displaying the main menu to the user
   UI_STATE_FILE_SYSTEM,         // Navigating the file system
-  UI_STATE_EQUALISER            // Configuring the equaliser filter
+  UI_STATE_EQUALISER,           // Configuring the equaliser filter
+  UI_STATE_DEBUG                // Showing the CPU load
 } ui_state_t;
 
 typedef enum {
   UI_OPTION_FILE_SYSTEM,        // File system menu option
   UI_OPTION_EQUALISER,          // Equaliser menu option
+  UI_OPTION_DEBUG,              // CPU load menu option
 
   UI_OPTION_COUNT
 } ui_main_menu_options_t;
@@ -77,8 +88,13 @@ typedef struct {
 
 typedef struct {  
   uint32_t  currentFileIndex;                 // Current file index
+  uint32_t  targetFileIndex;                  // Entry the scan is moving to
+  uint32_t  position;                         // Entries read since the directory was opened or rewound
+  bool      scanning;                         // Whether the directory is being read up to the target
+  bool      entering;                         // Whether an enter waits for the scan to reach the target
   char      currentPath[UI_BUFFER_SIZE];      // Path of the current directory
   FILINFO   currentFile;                      // Current file information
+  FILINFO   nextFile;                         // Entry being read, the end of the directory doesn't overwrite the current one
   FRESULT   currentError;                     // Error variable for the FatFs handler
   DIR       currentDirectory;                 // Directory of current position in file system
 } ui_file_system_context_t;
@@ -92,6 +108,10 @@ typedef struct {
   uint32_t  	eqBandGain[UI_EQUALISER_BAND_COUNT]; 	// Equaliser gains
 } ui_equaliser_context_t;
 
+typedef struct {
+  uint8_t   page;                             // Total load first, then the load of each slot
+} ui_debug_context_t;
+
 /*******************************************************************************
  * VARIABLES WITH GLOBAL SCOPE
  ******************************************************************************/
@@ -111,6 +131,39 @@ static void	uiLcdUpdate(void);
  */
 static void uiFileSystemOpenDirectory(void);
 
+/**
+ * @brief Starts moving to an entry of the current directory, or to its last entry if it
+ *        has less. The entries are read by the scan.
+ * @param index   Index of the entry
+ */
+static void uiFileSystemSeek(uint32_t index);
+
+/**
+ * @brief Reads the next entries of the directory, up to the target of the scan, and
+ *        displays the entry reached once it ends, entering it if an enter was waiting.
+ * @return True if the directory was being scanned
+ */
+static bool uiFileSystemScan(void);
+
+/**
+ * @brief Enters the current entry, opening it if it is a directory or playing it if it is a file.
+ */
+static void uiFileSystemEnter(void);
+
+/**
+ * @brief Entries of the file system scrolled by a rotation, a fast spin skips several per detent.
+ * @param rotation  Rotation of the encoder
+ */
+static uint32_t uiScrollEntries(event_rotation_t rotation);
+
+/**
+ * @brief Moves an index by the steps of a rotation, saturating at its limits.
+ * @param index   Current index
+ * @param steps   Steps to move, negative to move backwards
+ * @param count   Amount of positions
+ */
+static uint32_t uiMoveIndex(uint32_t index, int32_t steps, uint32_t count);
+
 /**
  * @brief Update the current string being displayed.
  * @param message   New string to be updated
@@ -141,6 +194,17 @@ static void uiRunFileSystem(event_t event);
  */
 static void uiRunEqualiser(event_t event);
 
+/**
+ * @brief Cycle the UI in the debug state.
+ * @param event   Next event
+ */
+static void uiRunDebug(event_t event);
+
+/**
+ * @brief Updates the page of the debug state with the last CPU load.
+ */
+static void uiDebugUpdate(void);
+
 /**
  * @brief Initializes the UI in the menu state.
  */
@@ -156,13 +220,29 @@ static void uiInitFileSystem(void);
  */
 static void uiInitEqualiser(void); 
 
+/**
+ * @brief Initializes the UI in the debug state.
+ */
+static void uiInitDebug(void);
+
 /*******************************************************************************
  * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
  ******************************************************************************/
 
 static const char*  MAIN_MENU_OPTIONS[UI_OPTION_COUNT] = {
   "Sistema de archivos",
-  "Ecualizador"
+  "Ecualizador",
+  "Uso del CPU"
+};
+
+static const char* DEBUG_PAGE_NAMES[CPU_LOAD_SLOT_COUNT] = {
+  "Reposo",
+  "Despertar",
+  "Diferido",
+  "Audio",
+  "Interfaz",
+  "Visualizador",
+  "Otros"
 };
 
 static const char* EQUALISER_MENU_OPTIONS[UI_EQUALISER_OPTION_COUNT] = {
@@ -192,6 +272,7 @@ static char               messageBuffer[UI_BUFFER_SIZE];// Buffer for message to
 static ui_menu_context_t        menuContext;            	// Context for the menu state of the UI module
 static ui_file_system_context_t fsContext;              	// Context for the file system state of the UI module
 static ui_equaliser_context_t 	eqContext;                // Context for the equalisator UI module
+static ui_debug_context_t       debugContext;             // Context for the debug state of the UI module
 
 /*******************************************************************************
  *******************************************************************************
@@ -215,13 +296,18 @@ void uiInit(void)
 
     // Initialization of the timer driver
     timerInit();
-    timerStart(timerGetId(), TIMER_MS2TICKS(UI_LCD_FPS_MS), TIM_MODE_PERIODIC, uiLcdUpdate);
+    timerStartDeferred(timerGetId(), TIMER_MS2TICKS(UI_LCD_FPS_MS), TIM_MODE_PERIODIC, uiLcdUpdate);
 
     // Initialize the internal state of the UI module
     uiSetState(UI_STATE_MENU);
   }
 }
 
+bool uiScan(void)
+{
+  return (currentState == UI_STATE_FILE_SYSTEM) && uiFileSystemScan();
+}
+
 void uiRun(event_t event)
 {
   switch (currentState)
@@ -238,6 +324,10 @@ void uiRun(event_t event)
       uiRunEqualiser(event);
       break;
 
+    case UI_STATE_DEBUG:
+      uiRunDebug(event);
+      break;
+
     default:
       break;
   }
@@ -253,10 +343,17 @@ static void	uiLcdUpdate(void)
 {
   if (HD44780LcdInitReady())
   {
+    // The debug page follows the CPU load
+    if (currentState == UI_STATE_DEBUG)
+    {
+      uiDebugUpdate();
+    }
+
     if (messageChanged)
     {
       messageChanged = false;
       HD44780WriteRotatingString(UI_LCD_LINE_NUMBER, messageBuffer, strlen(messageBuffer), UI_LCD_ROTATION_TIME_MS);
+      TRACE_UI(TRACE_UI_LCD_WRITE, UI_LCD_LINE_NUMBER, 0);
     }
   }
 }
@@ -299,6 +396,10 @@ static void uiSetState(ui_state_t state)
       uiInitEqualiser();
       break;
 
+    case UI_STATE_DEBUG:
+      uiInitDebug();
+      break;
+
     default:
       break;
   }
@@ -309,18 +410,12 @@ static void uiRunMenu(event_t event)
   switch (event.id)
   {
     case EVENTS_LEFT:
-      if (menuContext.currentOptionIndex)
-      {
-        menuContext.currentOptionIndex--;
-      }
+      menuContext.currentOptionIndex = uiMoveIndex(menuContext.currentOptionIndex, -event.data.rotation.steps, UI_OPTION_COUNT);
       uiSetDisplayString(MAIN_MENU_OPTIONS[menuContext.currentOptionIndex], UI_STRING_OTHER);
       break;
 
     case EVENTS_RIGHT:
-      if (menuContext.currentOptionIndex + 1 < UI_OPTION_COUNT)
-      {
-        menuContext.currentOptionIndex++;
-      }
+      menuContext.currentOptionIndex = uiMoveIndex(menuContext.currentOptionIndex, event.data.rotation.steps, UI_OPTION_COUNT);
       uiSetDisplayString(MAIN_MENU_OPTIONS[menuContext.currentOptionIndex], UI_STRING_OTHER);
       break;
 
@@ -335,65 +430,44 @@ static void uiRunMenu(event_t event)
 
 static void uiRunFileSystem(event_t event)
 {
+  uint32_t entries;
+  uint32_t index;
+
   switch (event.id)
   {
     case EVENTS_LEFT:
-      // Read the previous directory file
-      fsContext.currentError = f_rewinddir(&(fsContext.currentDirectory));
-      if (fsContext.currentError == FR_OK)
+      // Read the previous directory files, from the entry being scanned to,
+      // unless an enter is leaving the directory
+      if (fsContext.entering)
       {
-        for (uint32_t i = 0 ; (i < fsContext.currentFileIndex) && (fsContext.currentError == FR_OK) ; i++)
-        {
-          fsContext.currentError = f_readdir(&(fsContext.currentDirectory), &(fsContext.currentFile));
-        }
-        if (fsContext.currentError == FR_OK)
-        {
-          uiSetDisplayString(fsContext.currentFile.fname, fsContext.currentFile.fattrib == AM_DIR ? UI_STRING_FOLDER : UI_STRING_FILE);
-          if (fsContext.currentFileIndex)
-          {
-              fsContext.currentFileIndex--;
-          }
-        }
-        else
-        {
-          uiSetState(UI_STATE_MENU);
-        }      
-      }
-      else
-      {
-        uiSetState(UI_STATE_MENU);
+        break;
       }
+      entries = uiScrollEntries(event.data.rotation);
+      index = fsContext.scanning ? fsContext.targetFileIndex : fsContext.currentFileIndex;
+      uiFileSystemSeek(index > entries ? index - entries : 0);
       break;
 
     case EVENTS_RIGHT:
-      // Read the next directory file
-      fsContext.currentError = f_readdir(&(fsContext.currentDirectory), &(fsContext.currentFile));
-      if (fsContext.currentError == FR_OK)
-      {
-        if (fsContext.currentFile.fname[0])
-        {
-            uiSetDisplayString(fsContext.currentFile.fname, fsContext.currentFile.fattrib == AM_DIR ? UI_STRING_FOLDER : UI_STRING_FILE);
-            fsContext.currentFileIndex++;
-        }
-      }
-      else
+      // Read the next directory files, from the entry being scanned to,
+      // unless an enter is leaving the directory
+      if (fsContext.entering)
       {
-        uiSetState(UI_STATE_MENU);
+        break;
       }
+      entries = uiScrollEntries(event.data.rotation);
+      index = fsContext.scanning ? fsContext.targetFileIndex : fsContext.currentFileIndex;
+      uiFileSystemSeek(index + entries);
       break;
 
     case EVENTS_ENTER:
-      if (fsContext.currentFile.fattrib == AM_DIR)
+      // The entry entered is the one being scanned to, the scan enters it once reached
+      if (fsContext.scanning)
       {
-        // Appends the path
-    	  sprintf(&fsContext.currentPath[strlen(fsContext.currentPath)], "/%s", fsContext.currentFile.fname);
-
-        // Open the directory
-        uiFileSystemOpenDirectory();  
+        fsContext.entering = true;
       }
-      else if (fsContext.currentFile.fattrib == AM_ARC)
+      else
       {
-        audioSetFolder(fsContext.currentPath, fsContext.currentFile.fname, fsContext.currentFileIndex);
+        uiFileSystemEnter();
       }
       break;
 
@@ -434,18 +508,12 @@ static void uiRunEqualiser(event_t event)
     switch (event.id)
     {
       case EVENTS_LEFT:
-        if (eqContext.eqOption)
-        {
-          eqContext.eqOption--;
-        }
+        eqContext.eqOption = uiMoveIndex(eqContext.eqOption, -event.data.rotation.steps, UI_EQUALISER_OPTION_COUNT);
         uiSetDisplayString(EQUALISER_MENU_OPTIONS[eqContext.eqOption], UI_STRING_OTHER);
         break;
 
       case EVENTS_RIGHT:
-        if ((eqContext.eqOption + 1) < UI_EQUALISER_OPTION_COUNT)
-        {
-          eqContext.eqOption++;
-        }
+        eqContext.eqOption = uiMoveIndex(eqContext.eqOption, event.data.rotation.steps, UI_EQUALISER_OPTION_COUNT);
         uiSetDisplayString(EQUALISER_MENU_OPTIONS[eqContext.eqOption], UI_STRING_OTHER);
         break;
 
@@ -480,17 +548,11 @@ static void uiRunEqualiser(event_t event)
       case EVENTS_RIGHT:
         if (eqContext.hasEqBandSelected)
         {
-          if (eqContext.eqBandGain[eqContext.currentEqBandSelected])
-          {
-            eqContext.eqBandGain[eqContext.currentEqBandSelected]--;
-          }
+          eqContext.eqBandGain[eqContext.currentEqBandSelected] = uiMoveIndex(eqContext.eqBandGain[eqContext.currentEqBandSelected], -event.data.rotation.steps, UI_EQUALISER_GAIN_COUNT + 1);
         }
         else
         {
-          if (eqContext.currentEqBandSelected)
-          {
-            eqContext.currentEqBandSelected--;
-          }
+          eqContext.currentEqBandSelected = uiMoveIndex(eqContext.currentEqBandSelected, -event.data.rotation.steps, UI_EQUALISER_BAND_COUNT);
         }
         displaySelectColumn(eqContext.currentEqBandSelected, eqContext.eqBandGain[eqContext.currentEqBandSelected]);
         break;
@@ -498,17 +560,11 @@ static void uiRunEqualiser(event_t event)
       case EVENTS_LEFT:
         if (eqContext.hasEqBandSelected)
         {
-          if ((eqContext.eqBandGain[eqContext.currentEqBandSelected]) < UI_EQUALISER_GAIN_COUNT)
-          {
-            eqContext.eqBandGain[eqContext.currentEqBandSelected]++;
-          }
+          eqContext.eqBandGain[eqContext.currentEqBandSelected] = uiMoveIndex(eqContext.eqBandGain[eqContext.currentEqBandSelected], event.data.rotation.steps, UI_EQUALISER_GAIN_COUNT + 1);
         }
         else
         {
-          if ((eqContext.currentEqBandSelected + 1) < UI_EQUALISER_BAND_COUNT)
-          {
-            eqContext.currentEqBandSelected++;
-          }
+          eqContext.currentEqBandSelected = uiMoveIndex(eqContext.currentEqBandSelected, event.data.rotation.steps, UI_EQUALISER_BAND_COUNT);
         }
         displaySelectColumn(eqContext.currentEqBandSelected, eqContext.eqBandGain[eqContext.currentEqBandSelected]);
         break;
@@ -534,6 +590,50 @@ static void uiRunEqualiser(event_t event)
   }
 }
 
+static void uiRunDebug(event_t event)
+{
+  switch (event.id)
+  {
+    case EVENTS_LEFT:
+      debugContext.page = uiMoveIndex(debugContext.page, -event.data.rotation.steps, CPU_LOAD_SLOT_COUNT + 1);
+      uiDebugUpdate();
+      break;
+
+    case EVENTS_RIGHT:
+      debugContext.page = uiMoveIndex(debugContext.page, event.data.rotation.steps, CPU_LOAD_SLOT_COUNT + 1);
+      uiDebugUpdate();
+      break;
+
+    case EVENTS_EXIT:
+    case EVENTS_ENTER:
+      uiSetState(UI_STATE_MENU);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void uiDebugUpdate(void)
+{
+  char page[HD44780_COL_COUNT + 1];
+
+  if (debugContext.page)
+  {
+    snprintf(page, sizeof(page), "%-12s%3u%%", DEBUG_PAGE_NAMES[debugContext.page - 1], cpuLoadGet(debugContext.page - 1));
+  }
+  else
+  {
+    snprintf(page, sizeof(page), "%-12s%3u%%", "CPU", cpuLoadGetBusy());
+  }
+
+  // Only written when it changed, so the LCD is not refreshed every time
+  if (strcmp(page, messageBuffer))
+  {
+    uiSetDisplayString(page, UI_STRING_OTHER);
+  }
+}
+
 static void uiInitMenu(void)
 {
   // Sets the initial option of the menu state, and changes the
@@ -556,6 +656,9 @@ static void uiFileSystemOpenDirectory(void)
     {
       uiSetDisplayString(fsContext.currentFile.fname, fsContext.currentFile.fattrib == AM_DIR ? UI_STRING_FOLDER : UI_STRING_FILE);
       fsContext.currentFileIndex = 0;
+      fsContext.position = 1;
+      fsContext.scanning = false;
+      fsContext.entering = false;
     }
     else
     {
@@ -568,6 +671,120 @@ static void uiFileSystemOpenDirectory(void)
   }
 }
 
+static void uiFileSystemSeek(uint32_t index)
+{
+  // Backwards, the directory is read again from its start
+  if (index + 1 < fsContext.position)
+  {
+    fsContext.currentError = f_rewinddir(&(fsContext.currentDirectory));
+    fsContext.position = 0;
+  }
+
+  // Forwards, the entries are read by the scan
+  fsContext.targetFileIndex = index;
+  fsContext.scanning = true;
+}
+
+static bool uiFileSystemScan(void)
+{
+  bool scanning = fsContext.scanning;
+  bool ended = false;
+
+  // A few entries at a time, until the target or until the end of the directory
+  for (uint8_t i = 0 ; scanning && !ended && (i < UI_SCAN_ENTRIES_PER_RUN) ; i++)
+  {
+    if (fsContext.currentError == FR_OK)
+    {
+      if (fsContext.position > fsContext.targetFileIndex)
+      {
+        ended = true;
+      }
+      else
+      {
+        fsContext.currentError = f_readdir(&(fsContext.currentDirectory), &(fsContext.nextFile));
+        if ((fsContext.currentError == FR_OK) && fsContext.nextFile.fname[0])
+        {
+          fsContext.currentFile = fsContext.nextFile;
+          fsContext.position++;
+        }
+        else
+        {
+          ended = true;
+        }
+      }
+    }
+    else
+    {
+      ended = true;
+    }
+  }
+
+  if (ended)
+  {
+    fsContext.scanning = false;
+    if (fsContext.currentError == FR_OK)
+    {
+      if (fsContext.position)
+      {
+        uiSetDisplayString(fsContext.currentFile.fname, fsContext.currentFile.fattrib == AM_DIR ? UI_STRING_FOLDER : UI_STRING_FILE);
+        fsContext.currentFileIndex = fsContext.position - 1;
+      }
+      if (fsContext.entering)
+      {
+        fsContext.entering = false;
+        uiFileSystemEnter();
+      }
+    }
+    else
+    {
+      uiSetState(UI_STATE_MENU);
+    }
+  }
+
+  return scanning;
+}
+
+static void uiFileSystemEnter(void)
+{
+  if (fsContext.currentError == FR_OK)
+  {
+    if (fsContext.currentFile.fattrib == AM_DIR)
+    {
+      // Appends the path
+      sprintf(&fsContext.currentPath[strlen(fsContext.currentPath)], "/%s", fsContext.currentFile.fname);
+
+      // Open the directory
+      uiFileSystemOpenDirectory();
+    }
+    else if (fsContext.currentFile.fattrib == AM_ARC)
+    {
+      audioSetFolder(fsContext.currentPath, fsContext.currentFile.fname, fsContext.currentFileIndex);
+    }
+  }
+}
+
+static uint32_t uiScrollEntries(event_rotation_t rotation)
+{
+  uint32_t entries = rotation.steps;
+
+  if (rotation.velocity >= UI_SCROLL_FASTER_VELOCITY)
+  {
+    entries *= UI_SCROLL_FASTER_GAIN;
+  }
+  else if (rotation.velocity >= UI_SCROLL_FAST_VELOCITY)
+  {
+    entries *= UI_SCROLL_FAST_GAIN;
+  }
+
+  return entries;
+}
+
+static uint32_t uiMoveIndex(uint32_t index, int32_t steps, uint32_t count)
+{
+  int32_t next = (int32_t)index + steps;
+  return next < 0 ? 0 : ((uint32_t)next >= count ? count - 1 : (uint32_t)next);
+}
+
 static void uiInitFileSystem(void)
 {
   // Starts on the root directory
@@ -577,6 +794,13 @@ static void uiInitFileSystem(void)
   uiFileSystemOpenDirectory();
 }
 
+static void uiInitDebug(void)
+{
+  // Starts on the total load
+  debugContext.page = 0;
+  uiDebugUpdate();
+}
+
 static void uiInitEqualiser(void)
 {
   // Sets the initial option of the equaliser state, and changes the
@@ -13,6 +13,8 @@
 
 #include "events/events.h"
 
+#include <stdbool.h>
+
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
  ******************************************************************************/
@@ -40,6 +42,13 @@ void uiInit(void);
  */
 void uiRun(event_t event);
 
+/**
+ * @brief Cycles the scan of the directory being scrolled, reading a few of its entries.
+ *        Called when the higher priority work is done.
+ * @return True if the directory was being scanned
+ */
+bool uiScan(void);
+
 /*******************************************************************************
  ******************************************************************************/
 
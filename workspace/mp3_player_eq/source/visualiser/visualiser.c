@@ -0,0 +1,308 @@
+/*******************************************************************************
+  @file     visualiser.c
+  @brief    Spectrum visualiser, drives the RGB display from the audio being played
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include "visualiser.h"
+
+#include <string.h>
+
+#include "drivers/MCAL/spectrum/spectrum.h"
+#include "drivers/MCAL/filterbank/filterbank.h"
+#include "drivers/HAL/timer/timer.h"
+#include "drivers/MCAL/timebase/timebase.h"
+
+#include "lib/triple_buffer/triple_buffer.h"
+#include "lib/vumeter/vumeter.h"
+#include "display/display.h"
+#include "memory/memory_plan.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+#define VISUALISER_SOURCE_FFT               // Bands computed by the spectrum analyser
+// #define VISUALISER_SOURCE_FILTERBANK     // Bands computed by the octave filter bank, without the FFT
+
+#define VISUALISER_VUMETER_MODE     (BAR_MODE | LINEAR_MODE)          // Bars with peak markers
+// #define VISUALISER_VUMETER_MODE  (CENTRE_MODE | LINEAR_MODE)
+// #define VISUALISER_VUMETER_MODE  (DOT_MODE | LINEAR_MODE)
+// #define VISUALISER_VUMETER_MODE  (MIRRORED_MODE | LINEAR_MODE)
+// #define VISUALISER_VUMETER_MODE  (WATERFALL_MODE | LINEAR_MODE)
+
+// #define VISUALISER_BENCHMARK_MODE        // Cycles taken by the feed and the analysis, to compare the sources
+
+#define VISUALISER_FPS_MS           (DISPLAY_FPS_MS)  // Period of the visualiser frames
+#define VISUALISER_STALE_FRAMES     (5)               // Frames without new audio before the bars fall
+
+#define VISUALISER_FFT_SNAPSHOT_SIZE          (SPECTRUM_SNAPSHOT_SIZE)    // Decimated samples
+#define VISUALISER_FILTERBANK_SNAPSHOT_SIZE   (1024)                      // Mono samples, at the input rate
+
+#if defined(VISUALISER_SOURCE_FFT)
+#define VISUALISER_SNAPSHOT_SIZE    VISUALISER_FFT_SNAPSHOT_SIZE
+#elif defined(VISUALISER_SOURCE_FILTERBANK)
+#define VISUALISER_SNAPSHOT_SIZE    VISUALISER_FILTERBANK_SNAPSHOT_SIZE
+#endif
+
+// Size of the context with the snapshots of a source, to check both sources whichever is built
+#define VISUALISER_CONTEXT_SIZE(snapshotSize)  (sizeof(visualiser_context_t) - sizeof(((visualiser_context_t*)0)->snapshots) + 3 * (snapshotSize) * sizeof(q15_t))
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+#ifdef VISUALISER_BENCHMARK_MODE
+typedef struct {
+  uint32_t                last;
+  uint32_t                min;
+  uint32_t                max;
+  uint32_t                count;
+} visualiser_benchmark_t;
+#endif
+
+typedef struct {
+  // Snapshots of the audio, written by the audio path and read by the visualiser
+  q15_t                   snapshots[3][VISUALISER_SNAPSHOT_SIZE];
+  triple_buffer_t         snapshot;
+
+  // Frame scheduling
+  volatile bool           frameDue;       // Raised by the frame timer, cleared when the frame is drawn
+  uint8_t                 staleFrames;    // Frames drawn since the last snapshot was acquired
+
+  // Display data
+  uint32_t                bands[DISPLAY_COL_SIZE];
+  vumeter_level_t         levels[DISPLAY_COL_SIZE];
+  uint32_t                colValues[DISPLAY_COL_SIZE];
+  vumeter_t               vumeter;
+  pixel_t                 displayMatrix[DISPLAY_ROW_SIZE][DISPLAY_COL_SIZE];
+
+#ifdef VISUALISER_BENCHMARK_MODE
+  // Cycles per audio frame fed, and per snapshot analysed
+  visualiser_benchmark_t  feedBenchmark;
+  visualiser_benchmark_t  analyseBenchmark;
+#endif
+
+  bool                    alreadyInit;
+} visualiser_context_t;
+
+/*******************************************************************************
+ * VARIABLES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Computes the energy of each band of a snapshot.
+ * @param snapshot  Samples to analyse
+ */
+static void visualiserAnalyse(q15_t* snapshot);
+
+/**
+ * @brief Updates the display levels with the band energies, and fills the matrix with them.
+ */
+static void visualiserFillMatrix(void);
+
+/**
+ * @brief Callback to be called by the timer on every visualiser frame.
+ */
+static void onVisualiserFrame(void);
+
+#ifdef VISUALISER_BENCHMARK_MODE
+/**
+ * @brief Records the cycles taken since the start of a measurement.
+ * @param benchmark   Measurement to update
+ * @param startCycles Time base at the start
+ */
+static void visualiserBenchmark(visualiser_benchmark_t* benchmark, uint64_t startCycles);
+#endif
+
+/*******************************************************************************
+ * ROM CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static const pixel_t    peakPixel = {255,255,255};
+
+/*******************************************************************************
+ * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
+ ******************************************************************************/
+
+static visualiser_context_t context;
+
+MEMORY_CHECK_BUDGET(VISUALISER_CONTEXT_SIZE(VISUALISER_FFT_SNAPSHOT_SIZE), MEMORY_BUDGET_VISUALISER);
+MEMORY_CHECK_BUDGET(VISUALISER_CONTEXT_SIZE(VISUALISER_FILTERBANK_SNAPSHOT_SIZE), MEMORY_BUDGET_VISUALISER_FILTERBANK);
+
+/*******************************************************************************
+ *******************************************************************************
+                        GLOBAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+void visualiserInit(void)
+{
+  if (!context.alreadyInit)
+  {
+    // Raise the already initialized flag
+    context.alreadyInit = true;
+    context.snapshot = createTripleBuffer(context.snapshots[0], context.snapshots[1], context.snapshots[2]);
+    context.staleFrames = VISUALISER_STALE_FRAMES;
+    vumeterInit(&context.vumeter, DISPLAY_ROW_SIZE, DISPLAY_COL_SIZE, VUMETER_LEVEL_MAX, VISUALISER_VUMETER_MODE);
+
+#ifdef VISUALISER_BENCHMARK_MODE
+    // Enable the cycle counter
+    timebaseInit();
+    context.feedBenchmark.min = UINT32_MAX;
+    context.analyseBenchmark.min = UINT32_MAX;
+#endif
+
+#if defined(VISUALISER_SOURCE_FFT)
+    // Spectrum analyser initialization
+    spectrumInit();
+#elif defined(VISUALISER_SOURCE_FILTERBANK)
+    // Filter bank initialization
+    filterbankInit();
+#endif
+
+    // Frame timer
+    timerInit();
+    timerStart(timerGetId(), TIMER_MS2TICKS(VISUALISER_FPS_MS), TIM_MODE_PERIODIC, onVisualiserFrame);
+  }
+}
+
+void visualiserFeed(const int16_t* samples, uint32_t count, uint32_t stride)
+{
+  q15_t* snapshot = (q15_t*)tripleBufferWriteBuffer(&context.snapshot);
+#ifdef VISUALISER_BENCHMARK_MODE
+  uint64_t startCycles = timeNowCycles();
+#endif
+
+#if defined(VISUALISER_SOURCE_FFT)
+  // Decimate the block and copy out the latest decimated samples
+  spectrumFeed(samples, count, stride);
+  spectrumGetSnapshot(snapshot);
+#elif defined(VISUALISER_SOURCE_FILTERBANK)
+  // Copy out the latest mono samples of the block
+  if (count > VISUALISER_SNAPSHOT_SIZE)
+  {
+    samples += (count - VISUALISER_SNAPSHOT_SIZE) * stride;
+    count = VISUALISER_SNAPSHOT_SIZE;
+  }
+  for (uint32_t i = 0 ; i < count ; i++)
+  {
+    snapshot[i] = samples[i * stride];
+  }
+  memset(snapshot + count, 0, (VISUALISER_SNAPSHOT_SIZE - count) * sizeof(q15_t));
+#endif
+
+  tripleBufferPublish(&context.snapshot);
+
+#ifdef VISUALISER_BENCHMARK_MODE
+  visualiserBenchmark(&context.feedBenchmark, startCycles);
+#endif
+}
+
+bool visualiserRun(void)
+{
+  bool frameDue = context.frameDue;
+
+  if (frameDue)
+  {
+    context.frameDue = false;
+
+    if (tripleBufferAcquire(&context.snapshot))
+    {
+      // Analyse the latest snapshot, older ones have been dropped
+      context.staleFrames = 0;
+      visualiserAnalyse((q15_t*)tripleBufferReadBuffer(&context.snapshot));
+    }
+    else if (context.staleFrames < VISUALISER_STALE_FRAMES)
+    {
+      // Keep the last bands until the audio is considered stopped
+      context.staleFrames++;
+    }
+    else
+    {
+      memset(context.bands, 0, sizeof(context.bands));
+    }
+
+    visualiserFillMatrix();
+  }
+
+  return frameDue;
+}
+
+/*******************************************************************************
+ *******************************************************************************
+                        LOCAL FUNCTION DEFINITIONS
+ *******************************************************************************
+ ******************************************************************************/
+
+static void visualiserAnalyse(q15_t* snapshot)
+{
+#ifdef VISUALISER_BENCHMARK_MODE
+  uint64_t startCycles = timeNowCycles();
+#endif
+
+#if defined(VISUALISER_SOURCE_FFT)
+  spectrumAnalyse(snapshot, context.bands);
+#elif defined(VISUALISER_SOURCE_FILTERBANK)
+  filterbankAnalyse(snapshot, VISUALISER_SNAPSHOT_SIZE, context.bands);
+#endif
+
+#ifdef VISUALISER_BENCHMARK_MODE
+  visualiserBenchmark(&context.analyseBenchmark, startCycles);
+#endif
+}
+
+static void visualiserFillMatrix(void)
+{
+  vumeterUpdateLevels(&context.vumeter, context.bands, context.levels);
+  for (uint32_t i = 0 ; i < DISPLAY_COL_SIZE ; i++)
+  {
+    context.colValues[i] = context.levels[i].level;
+  }
+  vumeterDraw(&context.vumeter, (pixel_t*)context.displayMatrix, context.colValues);
+
+  // Peak markers on top of the bars
+  if((VISUALISER_VUMETER_MODE) & BAR_MODE)
+  {
+    for(int j = 0; j < DISPLAY_COL_SIZE; j++)
+    {
+      uint8_t peakRow = vumeterValueToRows(&context.vumeter, context.levels[j].peak);
+      if(peakRow)
+      {
+        context.displayMatrix[peakRow - 1][j] = peakPixel;
+      }
+    }
+  }
+  displayFlip((ws2812_pixel_t*)context.displayMatrix);
+}
+
+static void onVisualiserFrame(void)
+{
+  context.frameDue = true;
+}
+
+#ifdef VISUALISER_BENCHMARK_MODE
+static void visualiserBenchmark(visualiser_benchmark_t* benchmark, uint64_t startCycles)
+{
+  benchmark->last = timeNowCycles() - startCycles - timeOverheadCycles();
+  benchmark->min = benchmark->last < benchmark->min ? benchmark->last : benchmark->min;
+  benchmark->max = benchmark->last > benchmark->max ? benchmark->last : benchmark->max;
+  benchmark->count++;
+}
+#endif
+
+/*******************************************************************************
+ *******************************************************************************
+						            INTERRUPT SERVICE ROUTINES
+ *******************************************************************************
+ ******************************************************************************/
+
+/******************************************************************************/
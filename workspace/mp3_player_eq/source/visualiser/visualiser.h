@@ -0,0 +1,59 @@
+/*******************************************************************************
+  @file     visualiser.h
+  @brief    Spectrum visualiser, drives the RGB display from the audio being played
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef VISUALISER_VISUALISER_H_
+#define VISUALISER_VISUALISER_H_
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Initializes the visualiser.
+ */
+void visualiserInit(void);
+
+/**
+ * @brief Feeds the samples of an audio block to the visualiser, which stores and
+ *        publishes a snapshot of them. Only the cheap part of the analysis is done
+ *        here, so that it can be called from the audio path.
+ * @param samples   Decoded samples, only one of every stride samples is used
+ * @param count     Amount of samples to feed
+ * @param stride    Distance between consecutive samples, the channel count for interleaved data
+ */
+void visualiserFeed(const int16_t* samples, uint32_t count, uint32_t stride);
+
+/**
+ * @brief Cycles the visualiser. When a display frame is due, the latest snapshot is
+ *        analysed and the display is updated. Must be called when the CPU is idle,
+ *        frames not drawn in time are skipped.
+ * @return True if a display frame was due
+ */
+bool visualiserRun(void);
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* VISUALISER_VISUALISER_H_ */
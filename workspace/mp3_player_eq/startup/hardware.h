@@ -20,6 +20,7 @@
 
 #include "fsl_device_registers.h"
 #include "core_cm4.h"
+#include "sram_sections.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -0,0 +1,43 @@
+/*******************************************************************************
+  @file     sram_sections.h
+  @brief    Placement of data and code in the SRAM_L and SRAM_U banks
+  @author   G. Davidov, F. Farall, J. Gaytán, L. Kammann, N. Trozzo
+ ******************************************************************************/
+
+#ifndef _SRAM_SECTIONS_H_
+#define _SRAM_SECTIONS_H_
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+/*
+ * The K64F SRAM is split in two banks. SRAM_L (RAM2 in the MCUXpresso managed
+ * linker script) is reached by the core through the code bus, and SRAM_U (RAM)
+ * through the system bus, which is shared with the DMA. Data only the core
+ * works on goes in SRAM_L, and buffers read or written by the DMA go in SRAM_U,
+ * so that neither of them stalls the other. Hot code copied to SRAM_L runs
+ * without flash wait states.
+ *
+ * Only data is placed with these macros. The hot code, the Helix synthesis,
+ * comes from a prebuilt library, so linkscripts/main_text.ldt and data.ldt
+ * move it to SRAM_L along with its coefficient tables, whatever SRAM_PLACEMENT.
+ *
+ * Comment out SRAM_PLACEMENT to let the linker place everything in SRAM_U,
+ * to compare both layouts with AUDIO_BENCHMARK_MODE in source/audio/audio.c.
+ * Off target the macros expand to nothing.
+ */
+#define SRAM_PLACEMENT
+
+#if defined(SRAM_PLACEMENT) && defined(__arm__)
+#define __SRAM_L_BSS__      __attribute__ ((section(".bss.$RAM2")))
+#define __SRAM_U_BSS__      __attribute__ ((section(".bss.$RAM")))
+#else
+#define __SRAM_L_BSS__
+#define __SRAM_U_BSS__
+#endif
+
+/*******************************************************************************
+ ******************************************************************************/
+
+#endif /* _SRAM_SECTIONS_H_ */